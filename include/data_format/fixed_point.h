@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+using namespace std;
+// Exact decimal as written on the wire: mantissa * 10^exponent.
+struct Decimal {
+    int64_t mantissa;
+    int8_t exponent;
+    static bool parse(string_view text, Decimal &out);
+    static Decimal from_double(double value);
+    double to_double() const;
+};
+struct Price {
+    int64_t ticks;
+    bool operator==(Price other) const { return ticks == other.ticks; }
+    bool operator!=(Price other) const { return ticks != other.ticks; }
+    bool operator<(Price other) const { return ticks < other.ticks; }
+    bool operator>(Price other) const { return ticks > other.ticks; }
+};
+struct Qty {
+    int64_t lots;
+    bool operator==(Qty other) const { return lots == other.lots; }
+    bool operator!=(Qty other) const { return lots != other.lots; }
+    bool is_zero() const { return lots == 0; }
+};
+// Per-instrument scale: prices are counted in ticks and quantities in
+// contract-size lots. The default (1e-8 for both) is exact for any Deribit
+// number, so books built before the tick size is known are still correct.
+class InstrumentScale {
+public:
+    InstrumentScale(Decimal tick_size = Decimal{1, -8}, Decimal contract_size = Decimal{1, -8});
+    static InstrumentScale from_double(double tick_size, double contract_size);
+    Price to_price(Decimal value) const { return Price{rescale(value, m_tick)}; }
+    Qty to_qty(Decimal value) const { return Qty{rescale(value, m_contract)}; }
+    Price to_price(double value) const { return to_price(Decimal::from_double(value)); }
+    Qty to_qty(double value) const { return to_qty(Decimal::from_double(value)); }
+    Decimal to_decimal(Price price) const { return Decimal{price.ticks * m_tick.mantissa, m_tick.exponent}; }
+    Decimal to_decimal(Qty qty) const { return Decimal{qty.lots * m_contract.mantissa, m_contract.exponent}; }
+    double to_double(Price price) const;
+    double to_double(Qty qty) const;
+    size_t format(Price price, char *out, size_t size) const;
+    size_t format(Qty qty, char *out, size_t size) const;
+    Decimal tick_size() const { return m_tick; }
+    Decimal contract_size() const { return m_contract; }
+private:
+    static int64_t rescale(Decimal value, Decimal unit);
+    static size_t format(__int128 units, int exponent, char *out, size_t size);
+    Decimal m_tick;
+    Decimal m_contract;
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include "data_format/fixed_point.h"
+#include "data_format/symbol_table.h"
+using namespace std;
+template <size_t N>
+struct FixedString {
+    char chars[N];
+    uint8_t length;
+    void assign(string_view value) {
+        length = static_cast<uint8_t>(value.size() < N ? value.size() : N);
+        memcpy(chars, value.data(), length);
+    }
+    void clear() { length = 0; }
+    string_view view() const { return string_view(chars, length); }
+    bool empty() const { return length == 0; }
+};
+enum class ChannelKind : uint8_t {
+    Unknown,
+    PriceIndex,
+    Ticker,
+    Book,
+    Trades,
+    UserOrders,
+    UserTrades
+};
+enum class BookAction : uint8_t {
+    New,
+    Change,
+    Delete
+};
+struct PriceIndexUpdate {
+    uint32_t symbol;
+    FixedString<32> index_name;
+    int64_t timestamp;
+    double price;
+};
+struct TickerUpdate {
+    uint32_t symbol;
+    FixedString<64> instrument_name;
+    int64_t timestamp;
+    double best_bid_price;
+    double best_bid_amount;
+    double best_ask_price;
+    double best_ask_amount;
+    double last_price;
+    double mark_price;
+    double index_price;
+};
+enum class Side : uint8_t {
+    Buy,
+    Sell
+};
+struct TradeUpdate {
+    uint32_t symbol;
+    FixedString<64> instrument_name;
+    FixedString<32> trade_id;
+    FixedString<32> order_id;
+    int64_t timestamp;
+    double price;
+    double amount;
+    Side direction;
+};
+struct OrderUpdate {
+    uint32_t symbol;
+    FixedString<64> instrument_name;
+    FixedString<32> order_id;
+    FixedString<16> order_state;
+    int64_t timestamp;
+    double price;
+    double amount;
+    double filled_amount;
+    double average_price;
+    Side direction;
+};
+struct BookLevelUpdate {
+    BookAction action;
+    Decimal price;
+    Decimal amount;
+};
+struct BookUpdateHeader {
+    uint32_t symbol;
+    FixedString<64> instrument_name;
+    int64_t timestamp;
+    int64_t change_id;
+    int64_t prev_change_id;
+    bool is_snapshot;
+};
+struct MarketDataFrame {
+    ChannelKind kind;
+    uint32_t channel_id;
+    FixedString<64> channel;
+    PriceIndexUpdate index;
+    TickerUpdate ticker;
+    BookUpdateHeader book;
+    vector<BookLevelUpdate> bids;
+    vector<BookLevelUpdate> asks;
+    vector<TradeUpdate> trades;
+    vector<OrderUpdate> orders;
+};
+// CycleClock ticks taken as a frame is handed along the pipeline; zero when
+// instrumentation is compiled out.
+struct PipelineTrace {
+    uint64_t received;
+    uint64_t decoded;
+    uint64_t published;
+};
+struct MarketEvent {
+    ChannelKind kind;
+    int connection_id;
+    PipelineTrace trace;
+    PriceIndexUpdate index;
+    TickerUpdate ticker;
+    TradeUpdate trade;
+};
+namespace market_data {
+    ChannelKind classifyChannel(string_view channel);
+    bool decodeSubscription(string_view payload, MarketDataFrame &frame);
+}
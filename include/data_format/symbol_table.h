@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+// Interns instrument, index and channel names into dense 32-bit ids. Lookups of
+// names that are already interned take no lock and allocate nothing, so the
+// decoder can resolve ids on the socket thread while other threads read names.
+// Ids are never reused and names stay valid for the life of the process.
+class SymbolTable {
+public:
+    static constexpr uint32_t INVALID = 0xFFFFFFFFu;
+    static constexpr uint32_t MAX_SYMBOLS = 1u << 16;
+    SymbolTable();
+    uint32_t intern(string_view name);
+    uint32_t find(string_view name) const;
+    string_view name(uint32_t id) const;
+    size_t size() const { return m_count.load(memory_order_acquire); }
+private:
+    static constexpr uint32_t BUCKETS = MAX_SYMBOLS * 2;
+    static uint32_t hash(string_view name);
+    uint32_t probe(string_view name, uint32_t& bucket) const;
+    unique_ptr<atomic<uint32_t>[]> m_buckets;
+    unique_ptr<atomic<const string*>[]> m_names;
+    vector<unique_ptr<string>> m_storage;
+    atomic<uint32_t> m_count{0};
+    mutex m_insert_mutex;
+};
+SymbolTable& getSymbolTable();
@@ -1,32 +1,38 @@
 #pragma once
 #include "data_format/json_parser.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <vector>
 using namespace std;
 using json = nlohmann::json;
 extern bool AUTHENTICATION_SENT;
+extern bool REQUEST_SERVED_LOCALLY;
 extern vector<string> AVAILABLE_CURRENCIES;
-extern vector<string> channelSubscriptions;
+inline long next_request_id() {
+    static atomic<long> request_counter{1};
+    return request_counter.fetch_add(1, memory_order_relaxed);
+}
 class jsonrpc_request : public json {
     public:
         jsonrpc_request(){
             (*this)["jsonrpc"] = "2.0";
-            srand( time(NULL) );
-            long requestId = rand();
-            (*this)["id"] = requestId;
+            (*this)["id"] = next_request_id();
         }
         jsonrpc_request(const string& methodName){
             (*this)["jsonrpc"] = "2.0";
             (*this)["method"] = methodName;
-            srand( time(NULL) );
-            long requestId = rand();
-            (*this)["id"] = requestId;
+            (*this)["id"] = next_request_id();
         }
 };
 namespace api {
     vector<string> getActiveSubscription();
     bool is_valid_instrument_name(const string& instrument);
-    void registerSubscription(const string &index_name);
+    bool is_known_currency(const string& currency);
+    // Bookkeeping only: records an index subscription the exchange has already
+    // confirmed. Commands go through subscribe, which settles on the reply.
+    void registerSubscription(const string &index_name, int connection_id = 0);
     bool removeActiveSubscription(const string &index_name);
     string processRequest(const string &input);
     string authenticateUser(const string &cmd);
@@ -38,7 +44,11 @@ namespace api {
     string cancelAllOrders(const string &input);
     string fetchPositions(const string &input);
     string fetchOrderbook(const string &input);
+    string fetchInstruments(const string &input);
+    bool serveOrderbookLocally(const string &instrument, int depth);
     string subscribeChannel(const string &input);
     string unsubscribeChannel(const string &input);
     string unsubscribeAllChannels(const string &input);
+    string subscribeOrderBook(const string &input);
+    string unsubscribeOrderBook(const string &input);
 }
@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+using namespace std;
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity is rounded up to a power of two so indices can be masked instead of wrapped.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity = 4096) : m_slots(roundUp(capacity)), m_mask(m_slots.size() - 1) {}
+
+    bool try_push(const T& item) {
+        size_t tail = m_tail.load(memory_order_relaxed);
+        if (tail - m_head_cache == m_slots.size()) {
+            m_head_cache = m_head.load(memory_order_acquire);
+            if (tail - m_head_cache == m_slots.size()) {
+                return false;
+            }
+        }
+        m_slots[tail & m_mask] = item;
+        m_tail.store(tail + 1, memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& item) {
+        size_t head = m_head.load(memory_order_relaxed);
+        if (head == m_tail_cache) {
+            m_tail_cache = m_tail.load(memory_order_acquire);
+            if (head == m_tail_cache) {
+                return false;
+            }
+        }
+        item = m_slots[head & m_mask];
+        m_head.store(head + 1, memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return m_tail.load(memory_order_acquire) - m_head.load(memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return m_slots.size(); }
+
+private:
+    static size_t roundUp(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        return size;
+    }
+
+    vector<T> m_slots;
+    const size_t m_mask;
+    alignas(64) atomic<size_t> m_head{0};
+    size_t m_tail_cache = 0;
+    alignas(64) atomic<size_t> m_tail{0};
+    size_t m_head_cache = 0;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "network/socket_client.h"
+#include "market_data/market_data_manager.h"
+using namespace std;
+class StreamRenderer {
+public:
+    // Pipeline stages are recorded into the first source's monitor.
+    explicit StreamRenderer(vector<ConnectionDetails::ptr> sources, int refresh_hz = 20);
+    ~StreamRenderer();
+    void start();
+    void stop();
+    bool running() const { return m_running.load(); }
+    size_t drain();
+    const MarketDataManager::InstrumentState* stats(const string& name) const { return m_market_data.find(name); }
+    size_t instrument_count() const { return m_market_data.size(); }
+    vector<string> compose(int width) const;
+    static string diff(const vector<string>& previous, const vector<string>& next);
+private:
+    void run();
+    void render();
+    struct PendingTrace {
+        ChannelKind kind;
+        uint64_t received;
+        uint64_t applied;
+    };
+    vector<ConnectionDetails::ptr> m_sources;
+    PerformanceMonitor& m_monitor;
+    int m_refresh_hz;
+    atomic<bool> m_running{false};
+    thread m_render_thread;
+    MarketDataManager m_market_data;
+    vector<string> m_screen;
+    int m_screen_width = 0;
+    bool m_dirty = false;
+    // Applied events waiting for the next frame, to time the render stage.
+    vector<PendingTrace> m_pending_traces;
+};
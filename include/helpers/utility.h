@@ -6,7 +6,10 @@
 #include <unistd.h>
 #include <map>
 #include <vector>
+#include "data_format/json_parser.hpp"
+#include "market_data/order_book.h"
 using namespace std;
+using json = nlohmann::json;
 namespace utils {
     long long getCurrentTimestamp();
     string generateRandomString(const int len);
@@ -23,8 +26,12 @@ namespace utils {
     void printinfo(string const &str);
     void printwarning(string const &str);
     void printOrderbook(const string &instrument, const string &data, int depth = 10);
+    void printOrderbook(const string &instrument, const json &orderbook, int depth = 10);
+    void printOrderbook(const OrderBookManager::TopOfBook &book, int depth = 10);
     void printPositions(const string &data);
+    void printPositions(const json &positions_data);
     void printOpenOrders(const string &data);
+    void printOpenOrders(const json &orders_data);
     void printTradeConfirmation(const string &data);
     void printSubscriptionStatus(const vector<string> &subscriptions);
     void printLatencyReport(const map<string, double> &latencyData);
@@ -0,0 +1,71 @@
+#ifndef INSTRUMENT_REGISTRY_H
+#define INSTRUMENT_REGISTRY_H
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "data_format/fixed_point.h"
+#include "data_format/symbol_table.h"
+using json = nlohmann::json;
+using namespace std;
+// Instrument metadata from public/get_instruments, keyed by symbol id. A compact
+// binary cache lets the next start validate names and scale books before any
+// request has been answered.
+class InstrumentRegistry {
+public:
+    enum Kind : uint8_t {
+        FUTURE,
+        OPTION,
+        SPOT,
+        FUTURE_COMBO,
+        OPTION_COMBO,
+        UNKNOWN
+    };
+    struct InstrumentInfo {
+        uint32_t symbol = SymbolTable::INVALID;
+        string name;
+        string base_currency;
+        Kind kind = UNKNOWN;
+        double tick_size = 0.0;
+        double contract_size = 0.0;
+        double min_trade_amount = 0.0;
+        int64_t expiration_timestamp = 0;
+        InstrumentScale scale() const;
+    };
+    enum SaveResult : uint8_t {
+        NOTHING_PENDING,
+        SAVED,
+        SAVE_FAILED
+    };
+    static const char* const DEFAULT_CACHE_PATH;
+    // Older caches are ignored so listings and delistings are picked up.
+    static constexpr chrono::hours CACHE_MAX_AGE{24};
+    size_t load(const json& instruments);
+    bool add(const InstrumentInfo& info);
+    bool contains(string_view name) const;
+    bool find(string_view name, InstrumentInfo& info) const;
+    bool is_currency(string_view currency) const;
+    vector<string> currencies() const;
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    bool save(const string& path) const;
+    // Queues a save for flush_pending_save() so callers on the socket thread do no file I/O.
+    void schedule_save(const string& path);
+    SaveResult flush_pending_save(string& path);
+    size_t load_cache(const string& path, chrono::milliseconds max_age = CACHE_MAX_AGE);
+    void clear();
+    static Kind kind_from_string(const string& kind);
+    static const char* kind_name(Kind kind);
+private:
+    const InstrumentInfo* lookup(uint32_t symbol) const;
+    mutable mutex m_mutex;
+    vector<InstrumentInfo> m_instruments;
+    vector<uint32_t> m_slot_of_symbol;
+    vector<string> m_currencies;
+    string m_pending_save;
+};
+InstrumentRegistry& getInstrumentRegistry();
+#endif
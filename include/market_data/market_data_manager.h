@@ -0,0 +1,58 @@
+#ifndef MARKET_DATA_MANAGER_H
+#define MARKET_DATA_MANAGER_H
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "data_format/market_data_decoder.h"
+using namespace std;
+// Per-instrument streaming state kept in one contiguous slot table. Each index
+// or instrument gets a slot the first time its symbol id is seen; after that,
+// applying an event is an array lookup plus a fixed amount of work on that
+// slot. Owned by a single consumer thread (the one draining the event rings).
+class MarketDataManager {
+public:
+    static constexpr size_t HISTORY_LENGTH = 30;
+    struct PriceHistory {
+        array<double, HISTORY_LENGTH> values;
+        size_t head = 0;
+        size_t count = 0;
+        void push(double price);
+        size_t size() const { return count; }
+        double operator[](size_t oldest_first) const {
+            return values[(head + HISTORY_LENGTH - count + oldest_first) % HISTORY_LENGTH];
+        }
+    };
+    struct InstrumentState {
+        uint32_t symbol = SymbolTable::INVALID;
+        string_view name;
+        ChannelKind kind = ChannelKind::Unknown;
+        int64_t timestamp = 0;
+        double price = 0.0;
+        double previous_price = 0.0;
+        double high_price = 0.0;
+        double low_price = 0.0;
+        double open_price = 0.0;
+        double best_bid_price = 0.0;
+        double best_ask_price = 0.0;
+        double last_trade_price = 0.0;
+        double traded_volume = 0.0;
+        uint64_t trade_count = 0;
+        uint64_t update_count = 0;
+        PriceHistory price_history;
+    };
+    uint32_t resolve(uint32_t symbol, ChannelKind kind);
+    bool apply(const MarketEvent& event);
+    const InstrumentState* find(uint32_t symbol) const;
+    const InstrumentState* find(string_view name) const;
+    const InstrumentState& slot(uint32_t id) const { return m_slots[id]; }
+    const vector<InstrumentState>& slots() const { return m_slots; }
+    size_t size() const { return m_slots.size(); }
+    void clear();
+private:
+    void update(InstrumentState& state, int64_t timestamp, double price);
+    vector<InstrumentState> m_slots;
+    vector<uint32_t> m_slot_of_symbol;
+};
+#endif
@@ -0,0 +1,96 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "data_format/fixed_point.h"
+#include "data_format/market_data_decoder.h"
+#include "data_format/symbol_table.h"
+using namespace std;
+// L2 book kept as two sorted flat arrays with the best level at the back, so
+// top-of-book reads are O(1) and most deltas touch the hot end of the array.
+// Prices and amounts are integer ticks/lots in the instrument's scale.
+class OrderBook {
+public:
+    struct Level {
+        Price price;
+        Qty amount;
+    };
+    enum ApplyResult {
+        APPLIED,
+        SNAPSHOT_APPLIED,
+        AWAITING_SNAPSHOT,
+        SEQUENCE_GAP
+    };
+    explicit OrderBook(const string& instrument = "", InstrumentScale scale = InstrumentScale());
+    ApplyResult apply(const BookUpdateHeader& header, const vector<BookLevelUpdate>& bids,
+                      const vector<BookLevelUpdate>& asks);
+    void reset();
+    void rescale(InstrumentScale scale);
+    const string& instrument() const { return m_instrument; }
+    const InstrumentScale& scale() const { return m_scale; }
+    bool is_synced() const { return m_synced; }
+    int64_t change_id() const { return m_change_id; }
+    int64_t timestamp() const { return m_timestamp; }
+    chrono::steady_clock::time_point updated_at() const { return m_updated_at; }
+    uint64_t updates_applied() const { return m_updates; }
+    uint64_t gaps_detected() const { return m_gaps; }
+    bool best_bid(Level& level) const;
+    bool best_ask(Level& level) const;
+    size_t bid_depth() const { return m_bids.size(); }
+    size_t ask_depth() const { return m_asks.size(); }
+    Level bid(size_t rank) const { return m_bids[m_bids.size() - 1 - rank]; }
+    Level ask(size_t rank) const { return m_asks[m_asks.size() - 1 - rank]; }
+    void top_levels(size_t depth, vector<Level>& bids, vector<Level>& asks) const;
+private:
+    void apply_levels(vector<Level>& side, const vector<BookLevelUpdate>& updates, bool ascending);
+    string m_instrument;
+    InstrumentScale m_scale;
+    vector<Level> m_bids;
+    vector<Level> m_asks;
+    int64_t m_change_id;
+    int64_t m_timestamp;
+    chrono::steady_clock::time_point m_updated_at;
+    bool m_synced;
+    uint64_t m_updates;
+    uint64_t m_gaps;
+};
+class OrderBookManager {
+public:
+    // The top of a book and its sync state, copied under the manager's lock so
+    // readers never touch a book the socket thread is updating.
+    struct TopOfBook {
+        string instrument;
+        InstrumentScale scale;
+        vector<OrderBook::Level> bids;
+        vector<OrderBook::Level> asks;
+        int64_t change_id = 0;
+        int64_t timestamp = 0;
+        chrono::steady_clock::time_point updated_at;
+        bool synced = false;
+        uint64_t updates_applied = 0;
+        uint64_t gaps_detected = 0;
+    };
+    OrderBook::ApplyResult apply(const MarketDataFrame& frame);
+    bool snapshot(const string& instrument, OrderBook& book);
+    bool best_bid(const string& instrument, OrderBook::Level& level);
+    bool best_ask(const string& instrument, OrderBook::Level& level);
+    bool top_levels(const string& instrument, size_t depth, TopOfBook& top);
+    void set_scale(const string& instrument, InstrumentScale scale);
+    // Drops a book's levels and waits for the next snapshot, e.g. when its feed disconnects.
+    void unsync(const string& instrument);
+    void remove(const string& instrument);
+    vector<string> instruments();
+    void clear();
+private:
+    OrderBook* book_for(uint32_t symbol);
+    mutex m_mutex;
+    vector<unique_ptr<OrderBook>> m_books;
+    unordered_map<uint32_t, InstrumentScale> m_scales;
+};
+OrderBookManager& getOrderBookManager();
+#endif
@@ -0,0 +1,84 @@
+#ifndef FRAME_JOURNAL_H
+#define FRAME_JOURNAL_H
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "network/message_history.h"
+using namespace std;
+// On-disk layout: a JournalFileHeader followed by 8-byte aligned records, each a
+// JournalRecordHeader and the raw frame bytes. The file is preallocated, so a
+// zeroed record header marks the end of a journal that was never closed.
+struct JournalFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t data_end;
+};
+struct JournalRecordHeader {
+    int64_t timestamp_ns;
+    uint32_t length;
+    uint16_t connection_id;
+    uint8_t direction;
+    uint8_t reserved;
+};
+struct JournalFrame {
+    int64_t timestamp_ns;
+    int connection_id;
+    MessageHistory::Direction direction;
+    string_view payload;
+};
+// append() only copies into memory, so it is safe on the socket thread;
+// flush() does the file I/O and is driven by the request reaper.
+class FrameJournalWriter {
+public:
+    static constexpr size_t DEFAULT_PREALLOCATION = 64 * 1024 * 1024;
+    // Frames beyond this much unflushed data are dropped rather than stall the caller.
+    static constexpr size_t MAX_BUFFERED_BYTES = 64 * 1024 * 1024;
+    FrameJournalWriter();
+    ~FrameJournalWriter();
+    bool open(const string& path, size_t preallocate = DEFAULT_PREALLOCATION);
+    // Connection ids outside the record's 16-bit field are counted as dropped.
+    void append(MessageHistory::Direction direction, int connection_id, string_view payload);
+    void append(MessageHistory::Direction direction, int connection_id, string_view payload, int64_t timestamp_ns);
+    void flush();
+    void close();
+    bool is_open() const;
+    string path() const;
+    uint64_t frames_written() const;
+    uint64_t bytes_written() const;
+    uint64_t frames_dropped() const;
+    uint64_t write_failures() const;
+private:
+    bool write_pending(int fd);
+    bool reserve(int fd, uint64_t end);
+    mutable mutex m_mutex;
+    mutex m_io_mutex;
+    int m_fd;
+    string m_path;
+    vector<char> m_buffer;
+    vector<char> m_writing;
+    uint64_t m_buffered_frames;
+    uint64_t m_offset;
+    uint64_t m_allocated;
+    uint64_t m_frames;
+    uint64_t m_dropped;
+    uint64_t m_write_failures;
+};
+class FrameJournalReader {
+public:
+    FrameJournalReader();
+    ~FrameJournalReader();
+    bool open(const string& path);
+    void close();
+    bool next(JournalFrame& frame);
+    void rewind();
+    bool is_open() const { return m_data != nullptr; }
+private:
+    const char* m_data;
+    size_t m_size;
+    size_t m_end;
+    size_t m_cursor;
+};
+#endif
@@ -0,0 +1,59 @@
+#ifndef MESSAGE_HISTORY_H
+#define MESSAGE_HISTORY_H
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+// Bounded ring of recent frames. Evicted entries are only queued in memory on
+// the recording thread; flush_spill() appends them to the spill file and runs
+// on the request reaper, so the socket thread never does file I/O.
+class MessageHistory {
+public:
+    static constexpr size_t MAX_SPILL_BYTES = 16 * 1024 * 1024;
+    enum Direction : uint8_t {
+        SENT,
+        RECEIVED
+    };
+    struct Entry {
+        Direction direction;
+        string payload;
+    };
+    explicit MessageHistory(size_t capacity = 1024);
+    ~MessageHistory();
+    void record(Direction direction, string_view payload);
+    void resize(size_t capacity);
+    bool spill_to(const string& path);
+    void stop_spill();
+    void flush_spill();
+    void clear();
+    void for_each(const function<void(const Entry&)>& visit) const;
+    vector<string> snapshot() const;
+    size_t size() const;
+    size_t capacity() const;
+    size_t evicted() const;
+    // Evicted entries lost because more than MAX_SPILL_BYTES was waiting for a flush.
+    size_t spill_dropped() const;
+    size_t memory_usage() const;
+    string spill_path() const;
+    static string format(const Entry& entry);
+private:
+    void evict(Entry& entry);
+    void write_spill();
+    mutable mutex m_mutex;
+    vector<Entry> m_slots;
+    size_t m_head;
+    size_t m_count;
+    size_t m_evicted;
+    size_t m_spill_dropped;
+    string m_spill_path;
+    string m_spill_buffer;
+    // Guards the file and the buffer being written; taken before m_mutex.
+    mutex m_io_mutex;
+    ofstream m_spill;
+    string m_spill_writing;
+};
+#endif
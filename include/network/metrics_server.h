@@ -0,0 +1,34 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <ixwebsocket/IXHttpServer.h>
+#include "network/socket_client.h"
+#include "performance/latency_histogram.h"
+using namespace std;
+// Serves GET /metrics in the Prometheus text exposition format. Every scrape
+// snapshots the monitor's histograms and the connections' counters on the
+// HTTP thread; nothing is added to the message path.
+class MetricsServer {
+public:
+    static constexpr int DEFAULT_PORT = 9464;
+    explicit MetricsServer(SocketEndpoint& endpoint);
+    ~MetricsServer();
+    bool start(int port = DEFAULT_PORT, const string& host = "127.0.0.1");
+    void stop();
+    bool running() const;
+    int port() const;
+    string error() const;
+    string scrape() const;
+    static void append_histogram(string& out, const string& name, const string& labels,
+                                 const LatencyHistogram::Snapshot& snapshot);
+private:
+    SocketEndpoint& m_endpoint;
+    mutable mutex m_mutex;
+    unique_ptr<ix::HttpServer> m_server;
+    int m_port;
+    string m_error;
+};
+#endif
@@ -0,0 +1,34 @@
+#ifndef REPLAY_DRIVER_H
+#define REPLAY_DRIVER_H
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "network/frame_journal.h"
+#include "network/socket_client.h"
+using namespace std;
+class ReplayDriver {
+public:
+    enum Pace {
+        MAX_SPEED,
+        REALTIME
+    };
+    struct Stats {
+        uint64_t frames_replayed = 0;
+        uint64_t frames_skipped = 0;
+        uint64_t bytes_replayed = 0;
+        chrono::nanoseconds elapsed{0};
+        chrono::nanoseconds recorded_span{0};
+        chrono::nanoseconds handler_time{0};
+        chrono::nanoseconds max_handler_time{0};
+        double frames_per_second() const;
+        double megabytes_per_second() const;
+        chrono::nanoseconds average_handler_time() const;
+    };
+    explicit ReplayDriver(ConnectionDetails& target);
+    bool open(const string& path);
+    Stats run(Pace pace);
+private:
+    ConnectionDetails& m_target;
+    FrameJournalReader m_reader;
+};
+#endif
@@ -0,0 +1,50 @@
+#ifndef REQUEST_REGISTRY_H
+#define REQUEST_REGISTRY_H
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+using namespace std;
+class RequestTimeout : public runtime_error {
+public:
+    explicit RequestTimeout(const string& method)
+        : runtime_error("Request timed out: " + method) {}
+};
+class ConnectionClosed : public runtime_error {
+public:
+    explicit ConnectionClosed(const string& reason)
+        : runtime_error("Connection closed: " + reason) {}
+};
+class RequestRegistry {
+public:
+    typedef function<void(const json&)> CompletionHandler;
+    typedef function<void(const string&)> TimeoutHandler;
+    typedef function<void(const exception_ptr&)> FailureHandler;
+    struct PendingRequest {
+        string method;
+        chrono::steady_clock::time_point sent_at;
+        chrono::steady_clock::time_point deadline;
+        CompletionHandler on_complete;
+        TimeoutHandler on_timeout;
+        FailureHandler on_failure;
+    };
+    void register_request(long request_id, const string& method, CompletionHandler handler,
+                          chrono::milliseconds timeout = chrono::seconds(10),
+                          TimeoutHandler on_timeout = nullptr, FailureHandler on_failure = nullptr);
+    bool complete(long request_id, PendingRequest& request);
+    size_t expire(chrono::steady_clock::time_point now);
+    // Drops every pending request, handing error to those with a failure handler.
+    size_t fail_all(const exception_ptr& error);
+    size_t pending_count();
+    void clear();
+private:
+    mutex registry_mutex;
+    unordered_map<long, PendingRequest> pending_requests;
+};
+#endif
@@ -1,56 +1,171 @@
 #ifndef SOCKET_CLIENT_H
 #define SOCKET_CLIENT_H
 #include <map>
+#include <unordered_map>
 #include <string>
+#include <string_view>
 #include <mutex>
 #include <condition_variable>
 #include <vector>
 #include <thread>
 #include <memory>
+#include <future>
+#include <chrono>
+#include <atomic>
 #include <ixwebsocket/IXWebSocket.h>
 #include <ixwebsocket/IXNetSystem.h>
 #include <nlohmann/json.hpp>
+#include "network/request_registry.h"
+#include "network/message_history.h"
+#include "network/frame_journal.h"
+#include "network/subscription_manager.h"
+#include "data_format/market_data_decoder.h"
+#include "helpers/spsc_ring.h"
+#include "performance/latency_histogram.h"
 using json = nlohmann::json;
 using namespace std;
 extern bool AUTHENTICATION_SENT;
-extern bool isDataStreaming;
 class SocketEndpoint;
+class OrderBookManager;
+class PerformanceMonitor;
+class FlightRecorder;
 class ConnectionDetails {
+public:
+    enum State : uint8_t {
+        CONNECTING,
+        CONNECTED,
+        CONNECTION_ERROR,
+        CLOSED
+    };
 private:
     int m_connection_id;
-    string m_connection_status;
+    // Written by the IX thread, read by the CLI, reaper and metrics threads.
+    atomic<State> m_state;
     string m_endpoint_uri;
     string m_server_info;
     string m_error_message;
-    vector<string> m_transaction_logs;
+    MessageHistory m_message_history;
+    MessageHistory m_transaction_logs;
+    shared_ptr<FrameJournalWriter> m_journal;
+    shared_ptr<const json> m_auth_request;
     std::unique_ptr<ix::WebSocket> m_webSocketClient;
     SocketEndpoint* m_endpoint_controller;
+    OrderBookManager& m_books;
+    PerformanceMonitor& m_monitor;
+    FlightRecorder& m_flight;
+    RequestRegistry m_pending_requests;
+    MarketDataFrame m_market_frame;
+    SpscRing<MarketEvent> m_market_events;
+    atomic<uint64_t> m_dropped_events{0};
+    atomic<bool> m_streaming{false};
+    atomic<uint64_t> m_book_resyncs{0};
+    int64_t m_received_us = 0;
+    PipelineTrace m_trace{};
+    atomic<uint64_t> m_messages_received{0};
+    atomic<uint64_t> m_bytes_received{0};
+    atomic<uint64_t> m_messages_sent{0};
+    atomic<uint64_t> m_bytes_sent{0};
+    atomic<uint64_t> m_opens{0};
+    atomic<uint64_t> m_request_timeouts{0};
+    LatencyHistogram m_request_rtt;
+    atomic<long> m_clock_sync_request{0};
+    atomic<int64_t> m_last_clock_sync{0};
+    long track_request(string const &message, RequestRegistry::CompletionHandler on_response,
+                       RequestRegistry::TimeoutHandler on_timeout, chrono::milliseconds timeout,
+                       RequestRegistry::FailureHandler on_failure);
+    void fail_pending_requests(const string& reason);
+    void dispatch_response(json const &response);
+    void publish_market_events();
+    void record_private_updates();
+    void record_exchange_latency();
+    void record_pipeline(bool queued);
+    void resnapshot_book(const string& channel);
+    void unsync_books();
+    void restore_subscriptions();
 public:
     typedef shared_ptr<ConnectionDetails> ptr;
-    mutex connection_mutex;
-    condition_variable connection_cv;
-    vector<string> m_received_data;
-    bool DATA_PROCESSED;
-    ConnectionDetails(int id, string uri, SocketEndpoint* endpoint = nullptr);
+    typedef RequestRegistry::CompletionHandler ResponseHandler;
+    typedef RequestRegistry::TimeoutHandler TimeoutHandler;
+    typedef RequestRegistry::FailureHandler FailureHandler;
+    static constexpr chrono::seconds CLOCK_SYNC_INTERVAL{10};
+    struct TrafficStats {
+        uint64_t messages_received;
+        uint64_t bytes_received;
+        uint64_t messages_sent;
+        uint64_t bytes_sent;
+        uint64_t reconnects;
+        uint64_t request_timeouts;
+    };
+    // books, monitor and flight default to the process-wide instances; replay
+    // passes its own so recorded traffic never reaches live books, histograms
+    // or flight-recorder dumps.
+    ConnectionDetails(int id, string uri, SocketEndpoint* endpoint = nullptr,
+                      OrderBookManager* books = nullptr, PerformanceMonitor* monitor = nullptr,
+                      FlightRecorder* flight = nullptr);
     ~ConnectionDetails();
     int get_id();
-    string get_status();
+    State state() const { return m_state.load(memory_order_acquire); }
+    bool connected() const { return state() == CONNECTED; }
+    string get_status() const { return state_name(state()); }
+    static const char* state_name(State state);
     string get_uri() const { return m_endpoint_uri; }
     string get_server() const { return m_server_info; }
     string get_error_reason() const { return m_error_message; }
     void record_sent_message(string const &message);
     void record_summary(string const &message, string const &sent);
+    MessageHistory& history() { return m_message_history; }
+    void set_history_capacity(size_t capacity);
+    bool start_capture(const string& path);
+    void stop_capture();
+    shared_ptr<FrameJournalWriter> capture_journal() const { return atomic_load(&m_journal); }
     void setup_websocket();
+    // received_us is the wall-clock receive time; 0 means now.
+    // Takes a view so replay can pass frames straight from the mapped journal.
+    void handle_message(string_view payload, int64_t received_us = 0);
     void close(uint16_t code = 1000, const string& reason = "");
     bool send(const string& message);
+    // on_failure runs if the connection errors or closes before the response.
+    long send_request(const string& message, ResponseHandler on_response, TimeoutHandler on_timeout,
+                      chrono::milliseconds timeout = chrono::seconds(10), FailureHandler on_failure = nullptr);
+    size_t expire_requests(chrono::steady_clock::time_point now);
+    size_t pending_requests();
+    bool sync_clock();
+    bool sync_clock_if_due(chrono::steady_clock::time_point now);
+    SpscRing<MarketEvent>& market_events() { return m_market_events; }
+    // While a StreamRenderer drains this connection, market events go to its
+    // ring instead of the message history.
+    void set_streaming(bool streaming) { m_streaming.store(streaming, memory_order_relaxed); }
+    bool streaming() const { return m_streaming.load(memory_order_relaxed); }
+    OrderBookManager& books() const { return m_books; }
+    PerformanceMonitor& monitor() const { return m_monitor; }
+    FlightRecorder& flight() const { return m_flight; }
+    uint64_t dropped_events() const { return m_dropped_events.load(); }
+    uint64_t book_resyncs() const { return m_book_resyncs.load(); }
+    TrafficStats traffic() const;
+    void request_rtt(LatencyHistogram::Snapshot& snapshot) const { m_request_rtt.snapshot_into(snapshot); }
     ix::WebSocket* get_websocket();
     friend ostream &operator<< (ostream &out, ConnectionDetails const &data);
 };
 class SocketEndpoint {
+public:
+    enum ShardPolicy : uint8_t {
+        SHARD_BY_INSTRUMENT,
+        SHARD_BY_RATE
+    };
+    static constexpr size_t MAX_POOL_SIZE = 16;
 private:
     typedef map<int, ConnectionDetails::ptr> connection_list;
     connection_list m_active_connections;
     int m_next_id;
+    mutable mutex m_connections_mutex;
+    mutable mutex m_pool_mutex;
+    vector<int> m_pool;
+    ShardPolicy m_shard_policy;
+    mutex m_reaper_mutex;
+    condition_variable m_reaper_cv;
+    bool m_reaper_stopping;
+    thread m_timeout_reaper;
+    void expire_requests();
 public:
     SocketEndpoint();
     ~SocketEndpoint();
@@ -58,6 +173,19 @@ public:
     ConnectionDetails::ptr get_metadata(int id) const;
     void close(int id, uint16_t code = 1000, string reason = "");
     int send(int id, string message);
-    int streamSubscriptions(const vector<string>& connections);
+    long send_async(int id, const string& message, ConnectionDetails::ResponseHandler on_response,
+                    ConnectionDetails::TimeoutHandler on_timeout,
+                    chrono::milliseconds timeout = chrono::seconds(10),
+                    ConnectionDetails::FailureHandler on_failure = nullptr);
+    future<json> send_async(int id, const string& message, chrono::milliseconds timeout = chrono::seconds(10));
+    vector<ConnectionDetails::ptr> connections() const;
+    vector<int> open_pool(const string& uri, size_t size, ShardPolicy policy = SHARD_BY_RATE);
+    vector<int> pool() const;
+    double pool_load(int id) const;
+    // Router for the SubscriptionManager, which owns the channel assignments.
+    int shard_for(const string& channel, const vector<SubscriptionManager::Subscription>& current);
+    bool send_subscription(int id, const string& request, vector<future<json>>& responses,
+                           chrono::milliseconds timeout = chrono::seconds(10));
+    int streamSubscriptions(const vector<string>& connections, int refresh_hz = 20);
 };
 #endif 
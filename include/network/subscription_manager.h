@@ -0,0 +1,72 @@
+#ifndef SUBSCRIPTION_MANAGER_H
+#define SUBSCRIPTION_MANAGER_H
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "data_format/market_data_decoder.h"
+using namespace std;
+// Reference-counted view of every channel the client wants to receive. CLI
+// commands and internal consumers (local order books, the stream view) acquire
+// and release channels independently; only the transitions 0 -> 1 and 1 -> 0
+// reach the exchange, so callers send the returned diff and nothing else.
+class SubscriptionManager {
+public:
+    static constexpr int ANY_CONNECTION = -1;
+    struct Subscription {
+        uint32_t channel;
+        ChannelKind kind;
+        int connection_id;
+        uint32_t ref_count;
+    };
+    // Picks the connection a newly acquired channel should live on, given the
+    // current subscriptions; installed by a SocketEndpoint that shards channels
+    // across a connection pool. Runs under the manager's lock.
+    typedef function<int(const string& channel, const vector<Subscription>& current)> Router;
+    // Channels that cannot be interned (symbol table full) and book channels for
+    // an instrument whose book is already subscribed at another interval are
+    // not tracked; they are reported through rejected when it is given. Both
+    // intervals would feed one local book with interleaved change ids.
+    void acquire(int connection_id, const vector<string>& channels, vector<string>& added,
+                 vector<string>* rejected = nullptr);
+    size_t release(const vector<string>& channels, vector<string>& dropped);
+    // Reconciles a subscribe or unsubscribe with the exchange's reply. Channels
+    // missing from confirmed are dropped again (subscribe) or put back on
+    // connection_id (unsubscribe), whatever references were taken meanwhile.
+    void settle(bool unsubscribing, int connection_id, const vector<string>& channels,
+                const vector<string>& confirmed);
+    void release_all(int connection_id, vector<string>& dropped);
+    bool contains(string_view channel) const;
+    uint32_t ref_count(string_view channel) const;
+    vector<string> channels() const;
+    vector<string> channels_for(int connection_id) const;
+    // The book.<instrument>.* channel currently tracked, or an empty string.
+    string book_channel(string_view instrument) const;
+    // Connection a live channel is on, or ANY_CONNECTION.
+    int owner_of(string_view channel) const;
+    // While routed, the owner of a channel whose last reference was dropped is
+    // kept until its unsubscribe has been routed; this returns and forgets it.
+    int take_released_owner(string_view channel);
+    vector<Subscription> subscriptions() const;
+    size_t size() const;
+    void clear();
+    void set_router(Router router);
+    bool routed() const;
+    static bool is_private(string_view channel);
+    static string_view instrument_of(string_view channel);
+    static double estimated_rate(string_view channel);
+    static string subscribe_request(const vector<string>& channels);
+    static string unsubscribe_request(const vector<string>& channels);
+private:
+    vector<Subscription>::iterator locate(uint32_t channel);
+    vector<Subscription>::const_iterator locate_book(string_view instrument) const;
+    void remember_released(const Subscription& subscription);
+    mutable mutex m_mutex;
+    vector<Subscription> m_subscriptions;
+    vector<Subscription> m_released;
+    Router m_router;
+};
+SubscriptionManager& getSubscriptionManager();
+#endif
@@ -0,0 +1,51 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+using namespace std;
+// Estimates how far the exchange clock is ahead of the local wall clock from
+// public/get_time round trips, NTP style. Each sample assumes the reply was
+// stamped halfway through its round trip, so its error is at most half the
+// RTT; the estimate in use is the recent sample with the smallest RTT.
+// Samples are added from socket threads; the estimate is read lock-free.
+class ClockSync {
+public:
+    static constexpr size_t WINDOW = 8;
+    struct Sample {
+        int64_t offset_us;
+        int64_t rtt_us;
+    };
+    ClockSync();
+    // Timestamps in microseconds since the Unix epoch. server_in/server_out
+    // are the exchange's receive and send times (usIn/usOut), or both the
+    // get_time result when those are missing.
+    void add_sample(int64_t sent_us, int64_t server_in_us, int64_t server_out_us, int64_t received_us);
+    bool synchronized() const { return m_rtt_us.load(memory_order_acquire) >= 0; }
+    int64_t offset_us() const { return m_offset_us.load(memory_order_relaxed); }
+    int64_t rtt_us() const { return m_rtt_us.load(memory_order_relaxed); }
+    size_t samples() const;
+    // Local receive time minus the exchange's event time, corrected for the
+    // clock offset. Negative values mean the offset estimate is off by more
+    // than the real latency.
+    int64_t exchange_to_local_us(int64_t exchange_ms, int64_t received_us) const {
+        return received_us + offset_us() - exchange_ms * 1000;
+    }
+    string describe() const;
+    void reset();
+    static int64_t wall_clock_us() {
+        return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+private:
+    mutable mutex m_mutex;
+    array<Sample, WINDOW> m_samples;
+    size_t m_next;
+    size_t m_count;
+    atomic<int64_t> m_offset_us;
+    atomic<int64_t> m_rtt_us;
+};
+ClockSync& getClockSync();
+#endif
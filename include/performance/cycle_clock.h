@@ -0,0 +1,45 @@
+#ifndef CYCLE_CLOCK_H
+#define CYCLE_CLOCK_H
+#include <chrono>
+#include <cstdint>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+using namespace std;
+// Timestamp source for the latency monitor. Reads the invariant TSC when the
+// CPU has one (a few cycles, no syscall or vDSO) and converts tick deltas to
+// nanoseconds with a multiplier calibrated against CLOCK_MONOTONIC on first
+// use. Without an invariant TSC it falls back to steady_clock, whose ticks
+// already are nanoseconds.
+class CycleClock {
+public:
+    enum Source : uint8_t {
+        TSC,
+        STEADY_CLOCK
+    };
+    struct Calibration {
+        Source source;
+        uint64_t multiplier;
+        double ticks_per_nanosecond;
+    };
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        if (calibration().source == TSC) {
+            return __rdtsc();
+        }
+#endif
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count());
+    }
+    static uint64_t to_nanos(uint64_t ticks) {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(ticks) * calibration().multiplier) >> 32);
+    }
+    static uint64_t elapsed_nanos(uint64_t begin, uint64_t end) {
+        return end > begin ? to_nanos(end - begin) : 0;
+    }
+    static const Calibration& calibration();
+    static string describe();
+    static bool has_invariant_tsc();
+};
+#endif
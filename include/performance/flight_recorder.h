@@ -0,0 +1,117 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+using namespace std;
+// Always-on black box. Every thread appends fixed-size binary events to its
+// own ring with plain relaxed stores; nothing is formatted or allocated until
+// a dump. A trigger (slow callback, request timeout, reconnect, book gap,
+// parse error) only flags a dump, which flush_pending() writes from a
+// background thread, so the thread that saw the anomaly never touches disk.
+class FlightRecorder {
+public:
+    enum EventType : uint8_t {
+        FRAME_DECODED,
+        REQUEST_SENT,
+        RESPONSE_RECEIVED,
+        REQUEST_TIMEOUT,
+        SEQUENCE_GAP,
+        PARSE_ERROR,
+        SLOW_CALLBACK,
+        CONNECTION_OPEN,
+        RECONNECT,
+        CONNECTION_CLOSED,
+        CONNECTION_ERROR
+    };
+    enum Trigger : uint8_t {
+        TRIGGER_SLOW_CALLBACK,
+        TRIGGER_TIMEOUT,
+        TRIGGER_RECONNECT,
+        TRIGGER_SEQUENCE_GAP,
+        TRIGGER_PARSE_ERROR,
+        TRIGGER_MANUAL
+    };
+    static constexpr size_t TRIGGERS = 6;
+    static constexpr size_t CAPACITY = 4096;
+    static constexpr size_t PAYLOAD_BYTES = 24;
+    static constexpr uint32_t NO_CHANNEL = 0xFFFFFFFFu;
+    static constexpr chrono::seconds DUMP_COOLDOWN{1};
+    static constexpr chrono::seconds MAX_SLOW_CALLBACK{60};
+    struct Event {
+        uint64_t ticks;
+        uint64_t value;
+        int64_t id;
+        uint32_t channel;
+        int16_t connection;
+        EventType type;
+        uint8_t length;
+        char payload[PAYLOAD_BYTES];
+        string_view text() const { return string_view(payload, length); }
+    };
+    struct Record {
+        size_t thread_index;
+        Event event;
+    };
+    FlightRecorder();
+    void record(EventType type, int connection, int64_t id = 0, uint64_t value = 0,
+                uint32_t channel = NO_CHANNEL, string_view payload = string_view());
+    // Flags a dump if the trigger is enabled; returns whether it was flagged.
+    bool trigger(Trigger trigger);
+    bool enabled(Trigger trigger) const { return m_enabled[trigger].load(memory_order_relaxed); }
+    void set_enabled(Trigger trigger, bool enabled) { m_enabled[trigger].store(enabled, memory_order_relaxed); }
+    // 0 disables the slow-callback trigger; thresholds are capped at MAX_SLOW_CALLBACK.
+    void set_slow_callback(chrono::nanoseconds threshold);
+    uint64_t slow_callback_ns() const { return m_slow_callback_ns.load(memory_order_relaxed); }
+    bool is_slow(uint64_t nanos) const {
+        uint64_t threshold = slow_callback_ns();
+        return threshold != 0 && nanos >= threshold;
+    }
+    void set_dump_directory(const string& directory);
+    string dump_directory() const;
+    // Writes a flagged dump once the cooldown since the last one has passed.
+    // Returns the file written, or an empty string.
+    string flush_pending();
+    string dump(const string& path, Trigger reason = TRIGGER_MANUAL);
+    vector<Record> collect() const;
+    uint64_t dumps() const { return m_dumps.load(memory_order_relaxed); }
+    bool pending() const { return m_pending.load(memory_order_acquire) != 0; }
+    static const char* event_name(EventType type);
+    static const char* trigger_name(Trigger trigger);
+private:
+    static constexpr size_t WORDS = sizeof(Event) / sizeof(uint64_t);
+    // A slot's sequence is odd while it is being written and 2 * (index + 1)
+    // once event index has landed, so a reader can spot torn or stale slots.
+    struct Slot {
+        atomic<uint64_t> sequence{0};
+        array<atomic<uint64_t>, WORDS> words;
+    };
+    struct Ring {
+        thread::id owner;
+        size_t thread_index;
+        atomic<uint64_t> head{0};
+        array<Slot, CAPACITY> slots;
+    };
+    Ring& local_ring();
+    const uint64_t instance_id;
+    mutable mutex m_rings_mutex;
+    vector<unique_ptr<Ring>> m_rings;
+    array<atomic<bool>, TRIGGERS> m_enabled;
+    atomic<uint64_t> m_slow_callback_ns{0};
+    atomic<uint8_t> m_pending{0};
+    atomic<uint64_t> m_dumps{0};
+    chrono::steady_clock::time_point m_last_dump;
+    mutable mutex m_dump_mutex;
+    string m_dump_directory;
+    const uint64_t m_base_ticks;
+    const int64_t m_base_wall_us;
+};
+FlightRecorder& getFlightRecorder();
+#endif
@@ -0,0 +1,42 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+using namespace std;
+// Fixed-size log-linear histogram of nanosecond latencies (HDR style). Values
+// below 64 ns get exact buckets; above that every power of two is split into
+// 32 linear sub-buckets, so any recorded value is reported within ~3%.
+// Recording is a handful of relaxed atomic adds and never allocates.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+    struct Snapshot {
+        array<uint64_t, BUCKETS> counts{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = UINT64_MAX;
+        uint64_t max = 0;
+        void merge(const Snapshot& other);
+        bool empty() const { return count == 0; }
+        double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+        uint64_t percentile(double fraction) const;
+    };
+    LatencyHistogram();
+    void record(uint64_t nanos);
+    void reset();
+    void snapshot_into(Snapshot& snapshot) const;
+    static size_t bucket_of(uint64_t nanos);
+    static uint64_t bucket_floor(size_t bucket);
+    static uint64_t bucket_width(size_t bucket);
+private:
+    array<atomic<uint64_t>, BUCKETS> m_counts;
+    atomic<uint64_t> m_count;
+    atomic<uint64_t> m_sum;
+    atomic<uint64_t> m_min;
+    atomic<uint64_t> m_max;
+};
+#endif
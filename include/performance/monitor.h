@@ -1,38 +1,114 @@
 #ifndef PERFORMANCE_MONITOR_H
 #define PERFORMANCE_MONITOR_H
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <map>
+#include <memory>
 #include <vector>
 #include <mutex>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 #include <algorithm>
 #include <numeric>
 #include <iomanip>
+#include "performance/latency_histogram.h"
+#include "performance/cycle_clock.h"
+#include "data_format/market_data_decoder.h"
 using namespace std;
+// Latencies are recorded into per-thread histograms, so the hot path never
+// takes a lock or allocates; generate_report() and snapshot() merge them.
+// Timestamps come from CycleClock and are converted to nanoseconds on record.
+// A measurement must be started and stopped on the same thread.
+// Alongside the lifetime histograms each thread keeps a ring of per-second
+// and per-ten-second histograms, so the last 1s/10s/60s can be reported
+// without retaining samples.
 class PerformanceMonitor {
 public:
     enum MeasurementType {
         ORDER_EXECUTION,
         MARKET_DATA_HANDLING,
         WEBSOCKET_COMMUNICATION,
-        TRADING_CYCLE_FULL
+        TRADING_CYCLE_FULL,
+        FRAME_DECODE,
+        BOOK_UPDATE
     };
-    struct TimingData {
-        chrono::high_resolution_clock::time_point begin_time;
-        chrono::high_resolution_clock::time_point finish_time;
-        chrono::nanoseconds elapsed_time{0};
-        bool is_complete{false};
+    static constexpr size_t MEASUREMENT_TYPES = 6;
+    enum Window {
+        LIFETIME,
+        LAST_1S,
+        LAST_10S,
+        LAST_60S
     };
+    // Hand-offs a market-data frame goes through, each timed from the
+    // previous one: decoded, book/state updated or queued for the consumer,
+    // applied by the consumer, drawn on screen. TOTAL runs from receive to
+    // the last stage the frame reaches.
+    enum PipelineStage {
+        STAGE_DECODE,
+        STAGE_DISPATCH,
+        STAGE_NOTIFY,
+        STAGE_RENDER,
+        STAGE_TOTAL
+    };
+    static constexpr size_t PIPELINE_STAGES = 5;
+    static constexpr size_t CHANNEL_KINDS = 7;
+    PerformanceMonitor();
     void start_measurement(MeasurementType type, const string& unique_id = "");
     void stop_measurement(MeasurementType type, const string& unique_id = "");
+    void record(MeasurementType type, chrono::nanoseconds elapsed);
+    void record_interval(MeasurementType type, uint64_t begin_ticks, uint64_t end_ticks);
+    LatencyHistogram::Snapshot snapshot(MeasurementType type, Window window = LIFETIME);
+    // Exchange-to-client latency, keyed by interned channel id.
+    void record_channel(uint32_t channel_id, chrono::nanoseconds elapsed);
+    LatencyHistogram::Snapshot channel_snapshot(uint32_t channel_id);
+    vector<uint32_t> channels();
+    void record_stage(PipelineStage stage, ChannelKind kind, uint64_t begin_ticks, uint64_t end_ticks);
+    LatencyHistogram::Snapshot stage_snapshot(PipelineStage stage, ChannelKind kind);
     string generate_report();
-    map<MeasurementType, vector<TimingData>> get_raw_metrics();
+    string generate_window_report();
     void reset();
 private:
-    mutex metrics_mutex;
-    map<MeasurementType, vector<TimingData>> performance_data;
-    map<string, TimingData> ongoing_measurements;
+    static constexpr size_t OPEN_MEASUREMENTS = 16;
+    static constexpr size_t SECOND_SLOTS = 11;
+    static constexpr size_t DECADE_SLOTS = 7;
+    static constexpr uint64_t NO_EPOCH = UINT64_MAX;
+    struct WindowSlot {
+        atomic<uint64_t> epoch{NO_EPOCH};
+        LatencyHistogram histogram;
+    };
+    // Slot i of each ring holds the second (or ten-second span) whose index
+    // is congruent to i; a recorder reclaims a stale slot on first use.
+    struct RollingWindows {
+        array<WindowSlot, SECOND_SLOTS> seconds;
+        array<WindowSlot, DECADE_SLOTS> decades;
+    };
+    struct ThreadRecorder {
+        thread::id owner;
+        array<LatencyHistogram, MEASUREMENT_TYPES> histograms;
+        // Allocated on the first sample of a type and published for readers.
+        array<atomic<RollingWindows*>, MEASUREMENT_TYPES> windows;
+        // Unkeyed starts are matched first-in, first-out per type.
+        array<array<uint64_t, OPEN_MEASUREMENTS>, MEASUREMENT_TYPES> open;
+        array<size_t, MEASUREMENT_TYPES> open_head{};
+        array<size_t, MEASUREMENT_TYPES> open_count{};
+        unordered_map<string, uint64_t> keyed;
+        // Only the owner inserts; it holds the lock to do so, readers to iterate.
+        mutex channels_mutex;
+        unordered_map<uint32_t, unique_ptr<LatencyHistogram>> channels;
+        // Indexed by stage * CHANNEL_KINDS + kind; allocated on first use.
+        array<atomic<LatencyHistogram*>, PIPELINE_STAGES * CHANNEL_KINDS> stages;
+        ThreadRecorder();
+        ~ThreadRecorder();
+    };
+    ThreadRecorder& local_recorder();
+    static void record_sample(ThreadRecorder& recorder, MeasurementType type, uint64_t nanos, uint64_t now_ticks);
+    static void record_window(WindowSlot& slot, uint64_t epoch, uint64_t nanos);
+    const uint64_t instance_id;
+    mutex recorders_mutex;
+    vector<unique_ptr<ThreadRecorder>> recorders;
 };
 PerformanceMonitor& getPerformanceMonitor();
 #endif 
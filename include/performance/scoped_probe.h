@@ -0,0 +1,41 @@
+#ifndef SCOPED_PROBE_H
+#define SCOPED_PROBE_H
+#include "performance/monitor.h"
+#include "performance/cycle_clock.h"
+using namespace std;
+#ifndef DERIBIT_INSTRUMENTATION
+#define DERIBIT_INSTRUMENTATION 1
+#endif
+// Times the enclosing scope and records it under a stage fixed at compile
+// time. The start timestamp lives in the probe itself and the result goes
+// straight into the calling thread's histogram: no strings, no map, no heap.
+template <PerformanceMonitor::MeasurementType Stage>
+class ScopedProbe {
+public:
+    ScopedProbe() : ScopedProbe(getPerformanceMonitor()) {}
+    explicit ScopedProbe(PerformanceMonitor& monitor) : m_monitor(monitor), m_begin(CycleClock::now()) {}
+    ~ScopedProbe() {
+        m_monitor.record_interval(Stage, m_begin, CycleClock::now());
+    }
+    ScopedProbe(const ScopedProbe&) = delete;
+    ScopedProbe& operator=(const ScopedProbe&) = delete;
+private:
+    PerformanceMonitor& m_monitor;
+    uint64_t m_begin;
+};
+#define DERIBIT_PROBE_JOIN_(a, b) a##b
+#define DERIBIT_PROBE_JOIN(a, b) DERIBIT_PROBE_JOIN_(a, b)
+// DERIBIT_TRACE_STAMP() timestamps a pipeline hand-off; a zero stamp tells
+// record_stage() that tracing is compiled out.
+#if DERIBIT_INSTRUMENTATION
+#define DERIBIT_PROBE(stage) \
+    ScopedProbe<PerformanceMonitor::stage> DERIBIT_PROBE_JOIN(deribit_probe_, __LINE__)
+#define DERIBIT_PROBE_ON(monitor, stage) \
+    ScopedProbe<PerformanceMonitor::stage> DERIBIT_PROBE_JOIN(deribit_probe_, __LINE__)(monitor)
+#define DERIBIT_TRACE_STAMP() CycleClock::now()
+#else
+#define DERIBIT_PROBE(stage) static_cast<void>(PerformanceMonitor::stage)
+#define DERIBIT_PROBE_ON(monitor, stage) static_cast<void>(PerformanceMonitor::stage)
+#define DERIBIT_TRACE_STAMP() uint64_t(0)
+#endif
+#endif
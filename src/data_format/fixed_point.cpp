@@ -0,0 +1,154 @@
+#include "data_format/fixed_point.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+using namespace std;
+namespace {
+    const int64_t POW10[] = {
+        1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+        1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+        100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+        1000000000000000000LL
+    };
+    constexpr int MAX_DIGITS = 18;
+}
+bool Decimal::parse(string_view text, Decimal &out) {
+    const char* pos = text.data();
+    const char* end = pos + text.size();
+    bool negative = pos < end && *pos == '-';
+    if (negative) ++pos;
+
+    int64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool any = false;
+    for (; pos < end && *pos >= '0' && *pos <= '9'; ++pos, any = true) {
+        if (digits < MAX_DIGITS) {
+            mantissa = mantissa * 10 + (*pos - '0');
+            if (mantissa != 0) ++digits;
+        } else {
+            ++exponent;
+        }
+    }
+    if (pos < end && *pos == '.') {
+        for (++pos; pos < end && *pos >= '0' && *pos <= '9'; ++pos, any = true) {
+            if (digits < MAX_DIGITS) {
+                mantissa = mantissa * 10 + (*pos - '0');
+                if (mantissa != 0) ++digits;
+                --exponent;
+            }
+        }
+    }
+    if (!any) return false;
+    if (pos < end && (*pos == 'e' || *pos == 'E')) {
+        ++pos;
+        if (pos < end && *pos == '+') ++pos;
+        int scientific = 0;
+        auto result = from_chars(pos, end, scientific);
+        if (result.ec != errc()) return false;
+        pos = result.ptr;
+        exponent += scientific;
+    }
+    if (pos != end) return false;
+    while (mantissa != 0 && mantissa % 10 == 0) {
+        mantissa /= 10;
+        ++exponent;
+    }
+    if (exponent < -MAX_DIGITS || exponent > MAX_DIGITS) return false;
+    out.mantissa = negative ? -mantissa : mantissa;
+    out.exponent = static_cast<int8_t>(mantissa == 0 ? 0 : exponent);
+    return true;
+}
+Decimal Decimal::from_double(double value) {
+    char buffer[32];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+    Decimal decimal{0, 0};
+    parse(string_view(buffer, result.ptr - buffer), decimal);
+    return decimal;
+}
+double Decimal::to_double() const {
+    return exponent >= 0 ? static_cast<double>(mantissa) * POW10[exponent]
+                         : static_cast<double>(mantissa) / POW10[-exponent];
+}
+InstrumentScale::InstrumentScale(Decimal tick_size, Decimal contract_size)
+    : m_tick(tick_size.mantissa > 0 ? tick_size : Decimal{1, -8}),
+      m_contract(contract_size.mantissa > 0 ? contract_size : Decimal{1, -8}) {}
+InstrumentScale InstrumentScale::from_double(double tick_size, double contract_size) {
+    return InstrumentScale(Decimal::from_double(tick_size), Decimal::from_double(contract_size));
+}
+int64_t InstrumentScale::rescale(Decimal value, Decimal unit) {
+    // value / unit rounded to the nearest unit, computed on integers only.
+    int shift = value.exponent - unit.exponent;
+    if (shift > MAX_DIGITS || shift < -MAX_DIGITS) {
+        return shift > 0 ? INT64_MAX : 0;
+    }
+    int64_t narrow_numerator = value.mantissa;
+    int64_t narrow_denominator = unit.mantissa;
+    if (!__builtin_mul_overflow(narrow_numerator, shift >= 0 ? POW10[shift] : 1, &narrow_numerator) &&
+        !__builtin_mul_overflow(narrow_denominator, shift < 0 ? POW10[-shift] : 1, &narrow_denominator)) {
+        int64_t half = narrow_denominator / 2;
+        return narrow_numerator >= 0 ? (narrow_numerator + half) / narrow_denominator
+                                     : (narrow_numerator - half) / narrow_denominator;
+    }
+    __int128 numerator = value.mantissa;
+    __int128 denominator = unit.mantissa;
+    if (shift >= 0) {
+        numerator *= POW10[shift];
+    } else {
+        denominator *= POW10[-shift];
+    }
+    __int128 half = denominator / 2;
+    __int128 quotient = numerator >= 0 ? (numerator + half) / denominator : (numerator - half) / denominator;
+    return static_cast<int64_t>(quotient);
+}
+double InstrumentScale::to_double(Price price) const {
+    return static_cast<double>(price.ticks) * m_tick.to_double();
+}
+double InstrumentScale::to_double(Qty qty) const {
+    return static_cast<double>(qty.lots) * m_contract.to_double();
+}
+size_t InstrumentScale::format(__int128 units, int exponent, char *out, size_t size) {
+    // The product of two int64 values has at most 39 digits; a parsed exponent
+    // adds at most MAX_DIGITS zeros on either side of the point.
+    char digits[39 + MAX_DIGITS + 1];
+    bool negative = units < 0;
+    if (negative) units = -units;
+    size_t count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + static_cast<int>(units % 10));
+        units /= 10;
+    } while (units != 0 && count < sizeof(digits));
+    while (exponent > 0 && count < sizeof(digits)) {
+        memmove(digits + 1, digits, count++);
+        digits[0] = '0';
+        --exponent;
+    }
+    size_t decimals = exponent < 0 ? min(static_cast<size_t>(-exponent), sizeof(digits) - 1) : 0;
+    while (count <= decimals) {
+        digits[count++] = '0';
+    }
+    size_t length = 0;
+    auto put = [&](char c) {
+        if (length + 1 < size) out[length] = c;
+        ++length;
+    };
+    if (negative) put('-');
+    for (size_t i = count; i > decimals; --i) put(digits[i - 1]);
+    size_t trailing = 0;
+    while (trailing < decimals && digits[trailing] == '0') {
+        ++trailing;
+    }
+    if (trailing < decimals) {
+        put('.');
+        for (size_t i = decimals; i > trailing; --i) put(digits[i - 1]);
+    }
+    if (size > 0) out[length < size ? length : size - 1] = '\0';
+    return length < size ? length : size - 1;
+}
+size_t InstrumentScale::format(Price price, char *out, size_t size) const {
+    return format(static_cast<__int128>(price.ticks) * m_tick.mantissa, m_tick.exponent, out, size);
+}
+size_t InstrumentScale::format(Qty qty, char *out, size_t size) const {
+    return format(static_cast<__int128>(qty.lots) * m_contract.mantissa, m_contract.exponent, out, size);
+}
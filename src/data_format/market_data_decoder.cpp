@@ -0,0 +1,389 @@
+#include "data_format/market_data_decoder.h"
+#include <charconv>
+using namespace std;
+namespace {
+    class Scanner {
+    public:
+        Scanner(const char* begin, const char* end) : pos(begin), end(end) {}
+
+        const char* position() const { return pos; }
+
+        void skip_ws() {
+            while (pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) {
+                ++pos;
+            }
+        }
+
+        bool consume(char c) {
+            skip_ws();
+            if (pos < end && *pos == c) {
+                ++pos;
+                return true;
+            }
+            return false;
+        }
+
+        bool peek(char c) {
+            skip_ws();
+            return pos < end && *pos == c;
+        }
+
+        bool read_string(string_view &out) {
+            if (!consume('"')) return false;
+            const char* start = pos;
+            while (pos < end && *pos != '"') {
+                if (*pos == '\\') ++pos;
+                ++pos;
+            }
+            if (pos >= end) return false;
+            out = string_view(start, pos - start);
+            ++pos;
+            return true;
+        }
+
+        bool read_double(double &out) {
+            skip_ws();
+            if (skip_null()) {
+                out = 0.0;
+                return true;
+            }
+            auto result = from_chars(pos, end, out);
+            if (result.ec != errc()) return false;
+            pos = result.ptr;
+            return true;
+        }
+
+        bool read_int(int64_t &out) {
+            skip_ws();
+            if (skip_null()) {
+                out = 0;
+                return true;
+            }
+            const char* start = pos;
+            auto result = from_chars(pos, end, out);
+            if (result.ec != errc()) return false;
+            pos = result.ptr;
+            if (pos < end && (*pos == '.' || *pos == 'e' || *pos == 'E')) {
+                double value;
+                auto fractional = from_chars(start, end, value);
+                if (fractional.ec != errc()) return false;
+                out = static_cast<int64_t>(value);
+                pos = fractional.ptr;
+            }
+            return true;
+        }
+
+        bool read_decimal(Decimal &out) {
+            skip_ws();
+            if (skip_null()) {
+                out = Decimal{0, 0};
+                return true;
+            }
+            const char* start = pos;
+            while (pos < end && (*pos == '-' || *pos == '+' || *pos == '.' || *pos == 'e' || *pos == 'E' ||
+                                 (*pos >= '0' && *pos <= '9'))) {
+                ++pos;
+            }
+            return Decimal::parse(string_view(start, pos - start), out);
+        }
+
+        bool skip_value() {
+            skip_ws();
+            if (pos >= end) return false;
+            if (*pos == '"') {
+                string_view ignored;
+                return read_string(ignored);
+            }
+            if (*pos == '{' || *pos == '[') {
+                int depth = 0;
+                while (pos < end) {
+                    char c = *pos;
+                    if (c == '"') {
+                        string_view ignored;
+                        if (!read_string(ignored)) return false;
+                        continue;
+                    }
+                    ++pos;
+                    if (c == '{' || c == '[') {
+                        ++depth;
+                    } else if (c == '}' || c == ']') {
+                        if (--depth == 0) return true;
+                    }
+                }
+                return false;
+            }
+            while (pos < end && *pos != ',' && *pos != '}' && *pos != ']' &&
+                   *pos != ' ' && *pos != '\n' && *pos != '\r' && *pos != '\t') {
+                ++pos;
+            }
+            return true;
+        }
+
+        template <typename OnKey>
+        bool for_each_member(OnKey on_key) {
+            if (!consume('{')) return false;
+            if (consume('}')) return true;
+            do {
+                string_view key;
+                if (!read_string(key) || !consume(':')) return false;
+                if (!on_key(key)) return false;
+            } while (consume(','));
+            return consume('}');
+        }
+
+    private:
+        bool skip_null() {
+            if (end - pos >= 4 && memcmp(pos, "null", 4) == 0) {
+                pos += 4;
+                return true;
+            }
+            return false;
+        }
+
+        const char* pos;
+        const char* end;
+    };
+
+    bool decodePriceIndex(Scanner &scanner, PriceIndexUpdate &index) {
+        index.symbol = SymbolTable::INVALID;
+        index.index_name.clear();
+        index.timestamp = 0;
+        index.price = 0.0;
+        return scanner.for_each_member([&](string_view key) {
+            if (key == "price") return scanner.read_double(index.price);
+            if (key == "timestamp") return scanner.read_int(index.timestamp);
+            if (key == "index_name") {
+                string_view name;
+                if (!scanner.read_string(name)) return false;
+                index.index_name.assign(name);
+                index.symbol = getSymbolTable().intern(name);
+                return true;
+            }
+            return scanner.skip_value();
+        });
+    }
+
+    bool decodeTicker(Scanner &scanner, TickerUpdate &ticker) {
+        ticker = TickerUpdate{};
+        ticker.symbol = SymbolTable::INVALID;
+        return scanner.for_each_member([&](string_view key) {
+            if (key == "instrument_name") {
+                string_view name;
+                if (!scanner.read_string(name)) return false;
+                ticker.instrument_name.assign(name);
+                ticker.symbol = getSymbolTable().intern(name);
+                return true;
+            }
+            if (key == "timestamp") return scanner.read_int(ticker.timestamp);
+            if (key == "best_bid_price") return scanner.read_double(ticker.best_bid_price);
+            if (key == "best_bid_amount") return scanner.read_double(ticker.best_bid_amount);
+            if (key == "best_ask_price") return scanner.read_double(ticker.best_ask_price);
+            if (key == "best_ask_amount") return scanner.read_double(ticker.best_ask_amount);
+            if (key == "last_price") return scanner.read_double(ticker.last_price);
+            if (key == "mark_price") return scanner.read_double(ticker.mark_price);
+            if (key == "index_price") return scanner.read_double(ticker.index_price);
+            return scanner.skip_value();
+        });
+    }
+
+    template <size_t N>
+    bool readFixedString(Scanner &scanner, FixedString<N> &out) {
+        string_view value;
+        if (!scanner.read_string(value)) return false;
+        out.assign(value);
+        return true;
+    }
+
+    bool readPrice(Scanner &scanner, double &price) {
+        // Market orders report "market_price" instead of a number.
+        if (scanner.peek('"')) {
+            price = 0.0;
+            return scanner.skip_value();
+        }
+        return scanner.read_double(price);
+    }
+
+    bool readSide(Scanner &scanner, Side &side) {
+        string_view direction;
+        if (!scanner.read_string(direction)) return false;
+        side = direction == "sell" ? Side::Sell : Side::Buy;
+        return true;
+    }
+
+    bool decodeTrade(Scanner &scanner, TradeUpdate &trade) {
+        trade = TradeUpdate{};
+        trade.symbol = SymbolTable::INVALID;
+        return scanner.for_each_member([&](string_view key) {
+            if (key == "instrument_name") {
+                if (!readFixedString(scanner, trade.instrument_name)) return false;
+                trade.symbol = getSymbolTable().intern(trade.instrument_name.view());
+                return true;
+            }
+            if (key == "trade_id") return readFixedString(scanner, trade.trade_id);
+            if (key == "order_id") return readFixedString(scanner, trade.order_id);
+            if (key == "timestamp") return scanner.read_int(trade.timestamp);
+            if (key == "price") return scanner.read_double(trade.price);
+            if (key == "amount") return scanner.read_double(trade.amount);
+            if (key == "direction") return readSide(scanner, trade.direction);
+            return scanner.skip_value();
+        });
+    }
+
+    bool decodeOrder(Scanner &scanner, OrderUpdate &order) {
+        order = OrderUpdate{};
+        order.symbol = SymbolTable::INVALID;
+        return scanner.for_each_member([&](string_view key) {
+            if (key == "instrument_name") {
+                if (!readFixedString(scanner, order.instrument_name)) return false;
+                order.symbol = getSymbolTable().intern(order.instrument_name.view());
+                return true;
+            }
+            if (key == "order_id") return readFixedString(scanner, order.order_id);
+            if (key == "order_state") return readFixedString(scanner, order.order_state);
+            if (key == "last_update_timestamp") return scanner.read_int(order.timestamp);
+            if (key == "price") return readPrice(scanner, order.price);
+            if (key == "amount") return scanner.read_double(order.amount);
+            if (key == "filled_amount") return scanner.read_double(order.filled_amount);
+            if (key == "average_price") return scanner.read_double(order.average_price);
+            if (key == "direction") return readSide(scanner, order.direction);
+            return scanner.skip_value();
+        });
+    }
+
+    // Trades always arrive as an array; user.orders sends a single object on
+    // raw channels and an array on aggregated ones.
+    template <typename T, typename Decode>
+    bool decodeList(Scanner &scanner, vector<T> &items, Decode decode) {
+        items.clear();
+        if (scanner.peek('{')) {
+            items.emplace_back();
+            return decode(scanner, items.back());
+        }
+        if (!scanner.consume('[')) return false;
+        if (scanner.consume(']')) return true;
+        do {
+            items.emplace_back();
+            if (!decode(scanner, items.back())) return false;
+        } while (scanner.consume(','));
+        return scanner.consume(']');
+    }
+
+    bool decodeBookLevels(Scanner &scanner, vector<BookLevelUpdate> &levels) {
+        levels.clear();
+        if (!scanner.consume('[')) return false;
+        if (scanner.consume(']')) return true;
+        do {
+            if (!scanner.consume('[')) return false;
+            BookLevelUpdate level{BookAction::New, Decimal{0, 0}, Decimal{0, 0}};
+            if (scanner.peek('"')) {
+                string_view action;
+                if (!scanner.read_string(action) || !scanner.consume(',')) return false;
+                if (action == "change") level.action = BookAction::Change;
+                else if (action == "delete") level.action = BookAction::Delete;
+            }
+            if (!scanner.read_decimal(level.price) || !scanner.consume(',') ||
+                !scanner.read_decimal(level.amount) || !scanner.consume(']')) {
+                return false;
+            }
+            levels.push_back(level);
+        } while (scanner.consume(','));
+        return scanner.consume(']');
+    }
+
+    bool decodeBook(Scanner &scanner, MarketDataFrame &frame) {
+        BookUpdateHeader &book = frame.book;
+        book.symbol = SymbolTable::INVALID;
+        book.instrument_name.clear();
+        book.timestamp = 0;
+        book.change_id = 0;
+        book.prev_change_id = 0;
+        book.is_snapshot = false;
+        frame.bids.clear();
+        frame.asks.clear();
+        return scanner.for_each_member([&](string_view key) {
+            if (key == "type") {
+                string_view type;
+                if (!scanner.read_string(type)) return false;
+                book.is_snapshot = type == "snapshot";
+                return true;
+            }
+            if (key == "instrument_name") {
+                string_view name;
+                if (!scanner.read_string(name)) return false;
+                book.instrument_name.assign(name);
+                book.symbol = getSymbolTable().intern(name);
+                return true;
+            }
+            if (key == "timestamp") return scanner.read_int(book.timestamp);
+            if (key == "change_id") return scanner.read_int(book.change_id);
+            if (key == "prev_change_id") return scanner.read_int(book.prev_change_id);
+            if (key == "bids") return decodeBookLevels(scanner, frame.bids);
+            if (key == "asks") return decodeBookLevels(scanner, frame.asks);
+            return scanner.skip_value();
+        });
+    }
+}
+ChannelKind market_data::classifyChannel(string_view channel) {
+    if (channel.compare(0, 20, "deribit_price_index.") == 0) return ChannelKind::PriceIndex;
+    if (channel.compare(0, 7, "ticker.") == 0) return ChannelKind::Ticker;
+    if (channel.compare(0, 5, "book.") == 0) return ChannelKind::Book;
+    if (channel.compare(0, 7, "trades.") == 0) return ChannelKind::Trades;
+    if (channel.compare(0, 12, "user.orders.") == 0) return ChannelKind::UserOrders;
+    if (channel.compare(0, 12, "user.trades.") == 0) return ChannelKind::UserTrades;
+    return ChannelKind::Unknown;
+}
+bool market_data::decodeSubscription(string_view payload, MarketDataFrame &frame) {
+    Scanner scanner(payload.data(), payload.data() + payload.size());
+    bool is_subscription = false;
+    string_view channel;
+    const char* data_begin = nullptr;
+    const char* data_end = nullptr;
+    bool parsed = scanner.for_each_member([&](string_view key) {
+        if (key == "method") {
+            string_view method;
+            if (!scanner.read_string(method)) return false;
+            is_subscription = method == "subscription";
+            return is_subscription;
+        }
+        if (key == "result" || key == "error") {
+            return false;
+        }
+        if (key == "params") {
+            return scanner.for_each_member([&](string_view param) {
+                if (param == "channel") return scanner.read_string(channel);
+                if (param == "data") {
+                    scanner.skip_ws();
+                    data_begin = scanner.position();
+                    if (!scanner.skip_value()) return false;
+                    data_end = scanner.position();
+                    return true;
+                }
+                return scanner.skip_value();
+            });
+        }
+        return scanner.skip_value();
+    });
+    if (!parsed || !is_subscription || channel.empty() || data_begin == nullptr) {
+        return false;
+    }
+
+    frame.channel.assign(channel);
+    frame.channel_id = getSymbolTable().intern(channel);
+    frame.kind = classifyChannel(channel);
+    Scanner data(data_begin, data_end);
+    switch (frame.kind) {
+        case ChannelKind::PriceIndex:
+            return decodePriceIndex(data, frame.index);
+        case ChannelKind::Ticker:
+            return decodeTicker(data, frame.ticker);
+        case ChannelKind::Book:
+            return decodeBook(data, frame);
+        case ChannelKind::Trades:
+        case ChannelKind::UserTrades:
+            return decodeList(data, frame.trades, decodeTrade);
+        case ChannelKind::UserOrders:
+            return decodeList(data, frame.orders, decodeOrder);
+        default:
+            return true;
+    }
+}
@@ -0,0 +1,64 @@
+#include "data_format/symbol_table.h"
+using namespace std;
+SymbolTable::SymbolTable()
+    : m_buckets(new atomic<uint32_t>[BUCKETS]), m_names(new atomic<const string*>[MAX_SYMBOLS]) {
+    for (uint32_t i = 0; i < BUCKETS; ++i) {
+        m_buckets[i].store(INVALID, memory_order_relaxed);
+    }
+    for (uint32_t i = 0; i < MAX_SYMBOLS; ++i) {
+        m_names[i].store(nullptr, memory_order_relaxed);
+    }
+}
+uint32_t SymbolTable::hash(string_view name) {
+    uint32_t value = 2166136261u;
+    for (char c : name) {
+        value = (value ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return value;
+}
+uint32_t SymbolTable::probe(string_view name, uint32_t& bucket) const {
+    bucket = hash(name) & (BUCKETS - 1);
+    while (true) {
+        uint32_t id = m_buckets[bucket].load(memory_order_acquire);
+        if (id == INVALID || *m_names[id].load(memory_order_acquire) == name) {
+            return id;
+        }
+        bucket = (bucket + 1) & (BUCKETS - 1);
+    }
+}
+uint32_t SymbolTable::find(string_view name) const {
+    uint32_t bucket;
+    return probe(name, bucket);
+}
+uint32_t SymbolTable::intern(string_view name) {
+    uint32_t bucket;
+    uint32_t id = probe(name, bucket);
+    if (id != INVALID) {
+        return id;
+    }
+
+    lock_guard<mutex> lock(m_insert_mutex);
+    id = probe(name, bucket);
+    if (id != INVALID) {
+        return id;
+    }
+    id = m_count.load(memory_order_relaxed);
+    if (id >= MAX_SYMBOLS) {
+        return INVALID;
+    }
+    m_storage.push_back(make_unique<string>(name));
+    m_names[id].store(m_storage.back().get(), memory_order_release);
+    m_buckets[bucket].store(id, memory_order_release);
+    m_count.store(id + 1, memory_order_release);
+    return id;
+}
+string_view SymbolTable::name(uint32_t id) const {
+    if (id >= size()) {
+        return string_view();
+    }
+    return *m_names[id].load(memory_order_acquire);
+}
+SymbolTable& getSymbolTable() {
+    static SymbolTable table;
+    return table;
+}
@@ -11,37 +11,60 @@
 #include <set>
 #include <fmt/color.h>
 #include "performance/monitor.h"
+#include "market_data/order_book.h"
+#include "data_format/symbol_table.h"
+#include "market_data/instrument_registry.h"
+#include "network/subscription_manager.h"
 using namespace std;
 using json = nlohmann::json;
 bool AUTHENTICATION_SENT = false;
+bool REQUEST_SERVED_LOCALLY = false;
 vector<string> AVAILABLE_CURRENCIES = {"BTC", "ETH", "SOL", "XRP", "MATIC",
                                         "USDC", "USDT", "JPY", "CAD", "AUD", "GBP",
                                         "EUR", "USD", "CHF", "BRL", "MXN", "COP",
                                         "CLP", "PEN", "ECS", "ARS",
                                     };
-vector<string> channelSubscriptions;
+namespace {
+    // Bare names ("BTC", "btc_usd") keep meaning a price index; anything with a
+    // dot is taken as a full channel name such as trades.BTC-PERPETUAL.100ms.
+    string channelFor(const string& name) {
+        return name.find('.') == string::npos ? "deribit_price_index." + name : name;
+    }
+    string joinChannels(const vector<string>& channels) {
+        string joined;
+        for (const string& channel : channels) {
+            if (!joined.empty()) joined += ", ";
+            joined += channel;
+        }
+        return joined;
+    }
+}
 vector<string> api::getActiveSubscription(){
-    return channelSubscriptions;
+    return getSubscriptionManager().channels();
 }
-void api::registerSubscription(const string &index_name) {
-    string subscription = "deribit_price_index." + index_name;
-    if (find(channelSubscriptions.begin(), channelSubscriptions.end(), subscription) == channelSubscriptions.end()) {
-        channelSubscriptions.push_back(subscription);
-    }
+void api::registerSubscription(const string &index_name, int connection_id) {
+    vector<string> added;
+    getSubscriptionManager().acquire(connection_id, {"deribit_price_index." + index_name}, added);
 }
 bool api::removeActiveSubscription(const string &index_name) {
-    string subscription_to_remove = "deribit_price_index." + index_name;
-    auto it = find(channelSubscriptions.begin(), channelSubscriptions.end(), subscription_to_remove);
-    if (it != channelSubscriptions.end()) {
-        channelSubscriptions.erase(it);
-        return 1;
-    }
-    return 0;
+    vector<string> dropped;
+    return getSubscriptionManager().release({"deribit_price_index." + index_name}, dropped) > 0;
 }
+// The registry may only hold the currencies that were loaded, so a miss falls
+// back to the syntactic check and leaves the final word to the server.
 bool api::is_valid_instrument_name(const string& instrument) {
-    regex instrument_pattern(R"(^[A-Z]{3,4}(-)(PERPETUAL|[0-9]{2}[A-Z]{3}[0-9]{2})$)");
+    if (getInstrumentRegistry().contains(instrument)) {
+        return true;
+    }
+    static const regex instrument_pattern(R"(^[A-Z]{3,4}(-)(PERPETUAL|[0-9]{2}[A-Z]{3}[0-9]{2})$)");
     return regex_match(instrument, instrument_pattern);
 }
+bool api::is_known_currency(const string& currency) {
+    if (getInstrumentRegistry().is_currency(currency)) {
+        return true;
+    }
+    return find(AVAILABLE_CURRENCIES.begin(), AVAILABLE_CURRENCIES.end(), currency) != AVAILABLE_CURRENCIES.end();
+}
 string api::processRequest(const string &input) {
     map<string, function<string(string)>> action_map =
     {
@@ -56,12 +79,16 @@ string api::processRequest(const string &input) {
         {"orderbook", api::fetchOrderbook},
         {"subscribe", api::subscribeChannel},
         {"unsubscribe", api::unsubscribeChannel},
-        {"unsubscribe_all", api::unsubscribeAllChannels}
+        {"unsubscribe_all", api::unsubscribeAllChannels},
+        {"subscribe_book", api::subscribeOrderBook},
+        {"unsubscribe_book", api::unsubscribeOrderBook},
+        {"load_instruments", api::fetchInstruments}
     };
     istringstream s(input.substr(8));
     int id;
     string cmd;
     s >> id >> cmd;
+    REQUEST_SERVED_LOCALLY = false;
     auto find = action_map.find(cmd);
     if (find == action_map.end()) {
         utils::printerr("ERROR: Unrecognized command. Please enter 'help' to see available commands.\n");
@@ -597,7 +624,7 @@ string api::cancelAllOrders(const string &input) {
         j["method"] = "private/cancel_all";
         content.push_back({"Type", "All orders on account"});
     }
-    else if (find(AVAILABLE_CURRENCIES.begin(), AVAILABLE_CURRENCIES.end(), option) == AVAILABLE_CURRENCIES.end()) {
+    else if (!is_known_currency(option)) {
         j["method"] = "private/cancel_all_by_instrument";
         j["params"]["instrument"] = option;
         title = "CANCEL ORDERS BY INSTRUMENT";
@@ -667,7 +694,7 @@ string api::fetchOpenOrders(const string &input) {
         j["method"] = "private/get_open_orders";
         content.push_back({"Query Type", "All open orders"});
     }
-    else if (find(AVAILABLE_CURRENCIES.begin(), AVAILABLE_CURRENCIES.end(), opt1) == AVAILABLE_CURRENCIES.end()) {
+    else if (!is_known_currency(opt1)) {
         j["method"] = "private/get_open_orders_by_instrument";
         j["params"] = {{"instrument_name", opt1}, {"access_token", access_token}};
         content.push_back({"Query Type", "By instrument"});
@@ -720,15 +747,23 @@ string api::fetchPositions(const string &input) {
     string icon = "📊";
     fmt::rgb boxColor = fmt::rgb(102, 204, 255);
     if (!currency.empty()) {
-        static const set<string> valid_currencies = {
+        static const vector<string> default_currencies = {
             "BTC", "ETH", "USDC", "USDT", "EURR"
         };
-        if (valid_currencies.find(currency) == valid_currencies.end()) {
+        vector<string> valid_currencies = getInstrumentRegistry().currencies();
+        if (valid_currencies.empty()) {
+            valid_currencies = default_currencies;
+        }
+        if (find(valid_currencies.begin(), valid_currencies.end(), currency) == valid_currencies.end()) {
+            string supported;
+            for (const string& valid : valid_currencies) {
+                supported += (supported.empty() ? "" : ", ") + valid;
+            }
             vector<pair<string, string>> errorContent = {
                 {"Status", "Failed"},
                 {"Error", "Invalid currency format"},
                 {"", ""},
-                {"Message", "Please use one of the supported currencies: BTC, ETH, USDC, USDT, EURR"}
+                {"Message", "Please use one of the supported currencies: " + supported}
             };
             utils::displayBox("INVALID CURRENCY", errorContent,
                            fmt::rgb(255, 69, 0), "❌");
@@ -783,8 +818,9 @@ string api::fetchOrderbook(const string &input) {
     string cmd;
     string instrument;
     string depth_str;
+    string source;
     int depth = 10;
-    is >> id >> cmd >> instrument >> depth_str;
+    is >> id >> cmd >> instrument >> depth_str >> source;
     if (instrument.empty()) {
         vector<pair<string, string>> errorContent = {
             {"Status", "Failed"},
@@ -805,6 +841,11 @@ string api::fetchOrderbook(const string &input) {
         } catch (...) {
         }
     }
+    if (source != "remote" && depth_str != "remote" && serveOrderbookLocally(instrument, depth)) {
+        getPerformanceMonitor().stop_measurement(PerformanceMonitor::MARKET_DATA_HANDLING);
+        REQUEST_SERVED_LOCALLY = true;
+        return "";
+    }
     vector<pair<string, string>> content = {
         {"Instrument", instrument},
         {"Depth", to_string(depth)},
@@ -825,80 +866,137 @@ string api::fetchOrderbook(const string &input) {
     fmt::print(fg(fmt::rgb(255, 215, 0)) | fmt::emphasis::bold, "\n🔍 Querying orderbook information for {}... Results will appear below when received.\n\n", instrument);
     return json_request;
 }
+// A quiet instrument can go seconds without a delta, so freshness is not a
+// matter of age: a book is current while its feed is subscribed and synced.
+// Connections unsync their books when they drop, and a gap unsyncs the book
+// until the next snapshot.
+bool api::serveOrderbookLocally(const string &instrument, int depth) {
+    if (getSubscriptionManager().book_channel(instrument).empty()) {
+        return false;
+    }
+    OrderBookManager::TopOfBook book;
+    if (!getOrderBookManager().top_levels(instrument, static_cast<size_t>(max(depth, 0)), book) || !book.synced) {
+        return false;
+    }
+    auto age = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - book.updated_at);
+    long long exchange_age = utils::getCurrentTimestamp() - book.timestamp;
+    utils::printOrderbook(book, depth);
+    fmt::print(fg(fmt::rgb(150, 150, 150)), "📡 Local book | change_id {} | last update {:.1f} ms ago | exchange time {} ms ago\n\n",
+               book.change_id, age.count() / 1000.0, exchange_age);
+    return true;
+}
 string api::subscribeChannel(const string &input) {
     istringstream is(input);
     int id;
     string cmd;
-    string index_name;
-    is >> id >> cmd >> index_name;
-    if (index_name.empty()) {
+    string name;
+    vector<string> channels;
+    is >> id >> cmd;
+    while (is >> name) {
+        channels.push_back(channelFor(name));
+    }
+    if (channels.empty()) {
+        vector<pair<string, string>> errorContent = {
+            {"Status", "Failed"},
+            {"Error", "Missing channel"},
+            {"", ""},
+            {"Message", "Specify an index (BTC, eth_usd) or channels such as trades.BTC-PERPETUAL.100ms"}
+        };
+        utils::displayBox("SUBSCRIPTION FAILED", errorContent,
+                         fmt::rgb(255, 69, 0), "❌");
+        return "";
+    }
+    SubscriptionManager& subscriptions = getSubscriptionManager();
+    vector<string> added, rejected;
+    subscriptions.acquire(id, channels, added, &rejected);
+    if (rejected.size() == channels.size()) {
         vector<pair<string, string>> errorContent = {
             {"Status", "Failed"},
-            {"Error", "Missing index name"},
+            {"Error", "Channels rejected"},
+            {"Channels", joinChannels(rejected)},
             {"", ""},
-            {"Message", "Please specify an index name to subscribe to (e.g., BTC, ETH)"}
+            {"Message", "Only one book interval per instrument, and the symbol table may be full"}
         };
         utils::displayBox("SUBSCRIPTION FAILED", errorContent,
                          fmt::rgb(255, 69, 0), "❌");
         return "";
     }
-    registerSubscription(index_name);
     vector<pair<string, string>> content = {
-        {"Index Name", index_name},
-        {"Channel", "deribit_price_index." + index_name},
+        {"Channels", joinChannels(channels)},
+        {"Newly Subscribed", added.empty() ? "none (already active)" : joinChannels(added)},
         {"", ""},
-        {"Status", "Successfully subscribed to price updates"}
+        {"Active Subscriptions", to_string(subscriptions.size())}
     };
+    if (!rejected.empty()) {
+        content.insert(content.begin() + 2, {"Rejected", joinChannels(rejected)});
+    }
     utils::displayBox("SUBSCRIPTION SUCCESSFUL", content,
                      fmt::rgb(0, 255, 127), "📊");
-    return "";
+    if (added.empty()) {
+        REQUEST_SERVED_LOCALLY = true;
+        return "";
+    }
+    return SubscriptionManager::subscribe_request(added);
 }
 string api::unsubscribeChannel(const string &input) {
     istringstream is(input);
     int id;
     string cmd;
-    string index_name;
-    is >> id >> cmd >> index_name;
-    if (index_name.empty()) {
+    string name;
+    vector<string> channels;
+    is >> id >> cmd;
+    while (is >> name) {
+        channels.push_back(channelFor(name));
+    }
+    if (channels.empty()) {
         vector<pair<string, string>> errorContent = {
             {"Status", "Failed"},
-            {"Error", "Missing index name"},
+            {"Error", "Missing channel"},
             {"", ""},
-            {"Message", "Please specify an index name to unsubscribe from"}
+            {"Message", "Please specify an index or channel to unsubscribe from"}
         };
         utils::displayBox("UNSUBSCRIPTION FAILED", errorContent,
                          fmt::rgb(255, 69, 0), "❌");
         return "";
     }
-    if(!removeActiveSubscription(index_name)) {
+    SubscriptionManager& subscriptions = getSubscriptionManager();
+    vector<string> dropped;
+    if (subscriptions.release(channels, dropped) == 0) {
         vector<pair<string, string>> errorContent = {
             {"Status", "Failed"},
-            {"Error", "Not subscribed to this index"},
-            {"Index Name", index_name},
+            {"Error", "Not subscribed to this channel"},
+            {"Channels", joinChannels(channels)},
             {"", ""},
-            {"Message", "You can only unsubscribe from indexes you are subscribed to"}
+            {"Message", "You can only unsubscribe from channels you are subscribed to"}
         };
         utils::displayBox("UNSUBSCRIPTION FAILED", errorContent,
                          fmt::rgb(255, 69, 0), "❌");
-    } else {
-        vector<pair<string, string>> content = {
-            {"Index Name", index_name},
-            {"Channel", "deribit_price_index." + index_name},
-            {"", ""},
-            {"Status", "Successfully unsubscribed from price updates"},
-            {"Remaining Subscriptions", to_string(channelSubscriptions.size())}
-        };
-        utils::displayBox("UNSUBSCRIPTION SUCCESSFUL", content,
-                         fmt::rgb(255, 215, 0), "🔕");
+        return "";
     }
-    return "";
+    vector<pair<string, string>> content = {
+        {"Channels", joinChannels(channels)},
+        {"Unsubscribed", dropped.empty() ? "none (still referenced)" : joinChannels(dropped)},
+        {"", ""},
+        {"Remaining Subscriptions", to_string(subscriptions.size())}
+    };
+    utils::displayBox("UNSUBSCRIPTION SUCCESSFUL", content,
+                     fmt::rgb(255, 215, 0), "🔕");
+    if (dropped.empty()) {
+        REQUEST_SERVED_LOCALLY = true;
+        return "";
+    }
+    return SubscriptionManager::unsubscribe_request(dropped);
 }
 string api::unsubscribeAllChannels(const string &input) {
     istringstream is(input);
     int id;
     string cmd;
-    int previous_count = channelSubscriptions.size();
-    if (previous_count == 0) {
+    is >> id >> cmd;
+    // With a sharded pool the channels are spread over every pooled connection.
+    SubscriptionManager& subscriptions = getSubscriptionManager();
+    vector<string> dropped;
+    subscriptions.release_all(subscriptions.routed() ? SubscriptionManager::ANY_CONNECTION : id, dropped);
+    if (dropped.empty()) {
         vector<pair<string, string>> infoContent = {
             {"Status", "No action taken"},
             {"", ""},
@@ -906,16 +1004,116 @@ string api::unsubscribeAllChannels(const string &input) {
         };
         utils::displayBox("NO ACTIVE SUBSCRIPTIONS", infoContent,
                          fmt::rgb(64, 224, 208), "ℹ️");
+        REQUEST_SERVED_LOCALLY = true;
         return "";
     }
-    channelSubscriptions = {};
     vector<pair<string, string>> content = {
-        {"Previous Subscriptions", to_string(previous_count)},
-        {"Current Subscriptions", "0"},
+        {"Previous Subscriptions", to_string(dropped.size())},
+        {"Current Subscriptions", to_string(subscriptions.size())},
         {"", ""},
-        {"Status", "Successfully unsubscribed from all price updates"}
+        {"Status", "Successfully unsubscribed from all channels"}
     };
     utils::displayBox("ALL SUBSCRIPTIONS REMOVED", content,
                      fmt::rgb(255, 165, 0), "🧹");
-    return "";
-}
\ No newline at end of file
+    return SubscriptionManager::unsubscribe_request(dropped);
+}
+string api::subscribeOrderBook(const string &input) {
+    istringstream is(input);
+    int id;
+    string cmd;
+    string instrument;
+    string interval{"100ms"};
+    is >> id >> cmd >> instrument >> interval;
+    if (!is_valid_instrument_name(instrument) || (interval != "raw" && interval != "100ms")) {
+        vector<pair<string, string>> errorContent = {
+            {"Status", "Failed"},
+            {"Error", "Invalid instrument or interval"},
+            {"", ""},
+            {"Message", "Usage: deribit <id> subscribe_book <instrument> [raw|100ms]"}
+        };
+        utils::displayBox("BOOK SUBSCRIPTION FAILED", errorContent,
+                         fmt::rgb(255, 69, 0), "❌");
+        return "";
+    }
+    string channel = "book." + instrument + "." + interval;
+    string active = getSubscriptionManager().book_channel(instrument);
+    if (!active.empty() && active != channel) {
+        vector<pair<string, string>> errorContent = {
+            {"Status", "Failed"},
+            {"Error", "Book already subscribed at another interval"},
+            {"Channel", active},
+            {"", ""},
+            {"Message", "Unsubscribe it first; both intervals would feed the same local book"}
+        };
+        utils::displayBox("BOOK SUBSCRIPTION FAILED", errorContent,
+                         fmt::rgb(255, 69, 0), "❌");
+        return "";
+    }
+    vector<string> added, rejected;
+    getSubscriptionManager().acquire(id, {channel}, added, &rejected);
+    if (!rejected.empty()) {
+        vector<pair<string, string>> errorContent = {
+            {"Status", "Failed"},
+            {"Error", "Symbol table full"},
+            {"Channel", channel},
+            {"", ""},
+            {"Message", "No more channels can be tracked in this session"}
+        };
+        utils::displayBox("BOOK SUBSCRIPTION FAILED", errorContent,
+                         fmt::rgb(255, 69, 0), "❌");
+        return "";
+    }
+    vector<pair<string, string>> content = {
+        {"Instrument", instrument},
+        {"Channel", channel},
+        {"", ""},
+        {"Status", added.empty() ? "Already subscribed" : "Local book will build from the first snapshot"}
+    };
+    utils::displayBox("BOOK SUBSCRIPTION", content,
+                     fmt::rgb(0, 255, 127), "📚");
+    if (added.empty()) {
+        REQUEST_SERVED_LOCALLY = true;
+        return "";
+    }
+    return SubscriptionManager::subscribe_request(added);
+}
+string api::unsubscribeOrderBook(const string &input) {
+    istringstream is(input);
+    int id;
+    string cmd;
+    string instrument;
+    string interval{"100ms"};
+    is >> id >> cmd >> instrument >> interval;
+    if (instrument.empty()) {
+        utils::printerr("Usage: deribit <id> unsubscribe_book <instrument> [raw|100ms]\n");
+        return "";
+    }
+    vector<string> dropped;
+    if (getSubscriptionManager().release({"book." + instrument + "." + interval}, dropped) == 0) {
+        utils::printerr("Not subscribed to book." + instrument + "." + interval + "\n");
+        return "";
+    }
+    if (dropped.empty()) {
+        REQUEST_SERVED_LOCALLY = true;
+        return "";
+    }
+    return SubscriptionManager::unsubscribe_request(dropped);
+}
+string api::fetchInstruments(const string &input) {
+    istringstream is(input);
+    int id;
+    string cmd;
+    string currency{"any"};
+    is >> id >> cmd >> currency;
+    jsonrpc_request json_request("public/get_instruments");
+    json_request["params"] = {{"currency", currency}, {"expired", false}};
+    vector<pair<string, string>> content = {
+        {"Currency", currency},
+        {"Cached Instruments", to_string(getInstrumentRegistry().size())},
+        {"", ""},
+        {"Status", "Requesting instrument metadata..."}
+    };
+    utils::displayBox("LOADING INSTRUMENTS", content,
+                     fmt::rgb(64, 224, 208), "🗃️");
+    return json_request.dump();
+}
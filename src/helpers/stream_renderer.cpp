@@ -0,0 +1,248 @@
+#include "helpers/stream_renderer.h"
+#include "helpers/utility.h"
+#include "performance/scoped_probe.h"
+#include <fmt/color.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+using namespace std;
+namespace {
+    const fmt::rgb GAIN_COLOR(0, 255, 127);
+    const fmt::rgb LOSS_COLOR(255, 69, 0);
+    const fmt::rgb NEUTRAL_COLOR(255, 215, 0);
+    const fmt::rgb LABEL_COLOR(200, 200, 200);
+    const fmt::rgb RULE_COLOR(100, 100, 120);
+
+    typedef MarketDataManager::PriceHistory PriceHistory;
+    typedef MarketDataManager::InstrumentState InstrumentState;
+
+    string trendOf(const PriceHistory& history, fmt::rgb& color) {
+        if (history.size() < 5) {
+            color = fmt::rgb(150, 150, 150);
+            return "❓ WAITING";
+        }
+        int up_count = 0;
+        int down_count = 0;
+        for (size_t i = history.size() - 5; i < history.size() - 1; ++i) {
+            if (history[i+1] > history[i]) up_count++;
+            else if (history[i+1] < history[i]) down_count++;
+        }
+        if (up_count > down_count) {
+            color = GAIN_COLOR;
+            return "↗️  BULLISH";
+        }
+        if (down_count > up_count) {
+            color = LOSS_COLOR;
+            return "↘️  BEARISH";
+        }
+        color = NEUTRAL_COLOR;
+        return "↔️  SIDEWAYS";
+    }
+
+    double volatilityOf(const PriceHistory& history) {
+        if (history.size() < 10) {
+            return 0.0;
+        }
+        double sum = 0.0;
+        for (size_t i = history.size() - 10; i < history.size() - 1; ++i) {
+            sum += fabs(history[i+1] - history[i]);
+        }
+        return sum / 9.0;
+    }
+}
+StreamRenderer::StreamRenderer(vector<ConnectionDetails::ptr> sources, int refresh_hz)
+    : m_sources(move(sources)),
+      m_monitor(m_sources.empty() ? getPerformanceMonitor() : m_sources.front()->monitor()),
+      m_refresh_hz(refresh_hz > 0 ? min(refresh_hz, 240) : 20) {}
+StreamRenderer::~StreamRenderer() {
+    stop();
+}
+void StreamRenderer::start() {
+    if (m_running.exchange(true)) {
+        return;
+    }
+    for (const auto& source : m_sources) {
+        source->set_streaming(true);
+    }
+    m_render_thread = thread([this] { run(); });
+}
+void StreamRenderer::stop() {
+    m_running = false;
+    if (m_render_thread.joinable()) {
+        m_render_thread.join();
+    }
+    for (const auto& source : m_sources) {
+        source->set_streaming(false);
+    }
+    if (!m_screen.empty()) {
+        fmt::print("\033[{};1H\n", m_screen.size());
+        fflush(stdout);
+        m_screen.clear();
+    }
+}
+void StreamRenderer::run() {
+    const auto frame_interval = chrono::microseconds(1000000 / m_refresh_hz);
+    auto next_frame = chrono::steady_clock::now();
+    bool first_frame = true;
+    while (m_running.load()) {
+        drain();
+        auto now = chrono::steady_clock::now();
+        if ((m_dirty || first_frame) && now >= next_frame) {
+            render();
+            m_dirty = false;
+            first_frame = false;
+            next_frame = now + frame_interval;
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+size_t StreamRenderer::drain() {
+    size_t drained = 0;
+    MarketEvent event;
+    for (auto& source : m_sources) {
+        while (source->market_events().try_pop(event)) {
+            bool changed = m_market_data.apply(event);
+            m_dirty |= changed;
+            ++drained;
+            if (event.trace.published == 0) continue;
+            uint64_t applied = DERIBIT_TRACE_STAMP();
+            m_monitor.record_stage(PerformanceMonitor::STAGE_NOTIFY, event.kind, event.trace.published, applied);
+            if (changed) {
+                m_pending_traces.push_back({event.kind, event.trace.received, applied});
+            } else {
+                m_monitor.record_stage(PerformanceMonitor::STAGE_TOTAL, event.kind, event.trace.received, applied);
+            }
+        }
+    }
+    return drained;
+}
+vector<string> StreamRenderer::compose(int width) const {
+    vector<string> lines;
+    string separator(width, '-');
+    string thin_separator(width, '.');
+
+    lines.push_back(fmt::format(fg(fmt::rgb(0, 120, 212)) | bg(fmt::rgb(20, 20, 30)) | fmt::emphasis::bold,
+        "{:^{}}", "💹 LIVE MARKET DATA STREAM", width));
+    lines.push_back(fmt::format(fg(RULE_COLOR), "{}", separator));
+
+    if (m_market_data.size() == 0) {
+        lines.push_back(fmt::format(fg(fmt::rgb(150, 150, 150)), " Waiting for market data..."));
+    }
+
+    for (const InstrumentState& stats : m_market_data.slots()) {
+        double change = stats.price - stats.previous_price;
+        double percent = stats.previous_price != 0 ? (change / stats.previous_price) * 100 : 0;
+        fmt::rgb price_color = change >= 0 ? GAIN_COLOR : LOSS_COLOR;
+
+        time_t t = stats.timestamp / 1000;
+        char time_buf[64];
+        strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", localtime(&t));
+
+        lines.push_back(
+            fmt::format(fg(fmt::rgb(255, 255, 255)) | fmt::emphasis::bold, " 🎯 ") +
+            fmt::format(fg(NEUTRAL_COLOR) | fmt::emphasis::bold, "{:<20} ", stats.name) +
+            fmt::format(fg(fmt::rgb(120, 200, 255)), "⏰ {}  ", time_buf) +
+            fmt::format(fg(LABEL_COLOR), "Updates: ") +
+            fmt::format(fg(NEUTRAL_COLOR) | fmt::emphasis::bold, "{}", stats.update_count));
+
+        string price_line =
+            fmt::format(fg(fmt::rgb(255, 255, 255)) | fmt::emphasis::bold, " 💰 PRICE: ") +
+            fmt::format(fg(price_color) | fmt::emphasis::bold, "${:.2f} {} ${:.2f} ({:.2f}%)",
+                        stats.price, change >= 0 ? "▲" : "▼", fabs(change), percent);
+        if (stats.kind == ChannelKind::Ticker) {
+            price_line += fmt::format(fg(LABEL_COLOR), "  Bid: ") +
+                          fmt::format(fg(GAIN_COLOR), "${:.2f} ", stats.best_bid_price) +
+                          fmt::format(fg(LABEL_COLOR), "Ask: ") +
+                          fmt::format(fg(LOSS_COLOR), "${:.2f}", stats.best_ask_price);
+        }
+        if (stats.trade_count > 0) {
+            price_line += fmt::format(fg(LABEL_COLOR), "  Last: ") +
+                          fmt::format(fg(NEUTRAL_COLOR), "${:.2f} ", stats.last_trade_price) +
+                          fmt::format(fg(LABEL_COLOR), "Vol: ") +
+                          fmt::format(fg(NEUTRAL_COLOR), "{:.0f}", stats.traded_volume);
+        }
+        lines.push_back(price_line);
+
+        lines.push_back(
+            fmt::format(fg(LABEL_COLOR), " 📊 Open: ") +
+            fmt::format(fg(fmt::rgb(100, 200, 255)) | fmt::emphasis::bold, "${:.2f} ", stats.open_price) +
+            fmt::format(fg(LABEL_COLOR), "High: ") +
+            fmt::format(fg(GAIN_COLOR) | fmt::emphasis::bold, "${:.2f} ", stats.high_price) +
+            fmt::format(fg(LABEL_COLOR), "Low: ") +
+            fmt::format(fg(LOSS_COLOR) | fmt::emphasis::bold, "${:.2f} ", stats.low_price) +
+            fmt::format(fg(LABEL_COLOR), "Range: ${:.2f}", stats.high_price - stats.low_price));
+
+        fmt::rgb trend_color;
+        string trend = trendOf(stats.price_history, trend_color);
+        double volatility = volatilityOf(stats.price_history);
+        string volatility_level = "HIGH";
+        fmt::rgb volatility_color = LOSS_COLOR;
+        if (volatility < 0.0001 * stats.price) {
+            volatility_level = "LOW";
+            volatility_color = GAIN_COLOR;
+        } else if (volatility < 0.001 * stats.price) {
+            volatility_level = "MEDIUM";
+            volatility_color = NEUTRAL_COLOR;
+        }
+        double session_change = stats.price - stats.open_price;
+        double session_percent = stats.open_price != 0 ? (session_change / stats.open_price) * 100 : 0;
+
+        lines.push_back(
+            fmt::format(fg(LABEL_COLOR), " Trend: ") +
+            fmt::format(fg(trend_color) | fmt::emphasis::bold, "{}  ", trend) +
+            fmt::format(fg(LABEL_COLOR), "Volatility: ") +
+            fmt::format(fg(volatility_color) | fmt::emphasis::bold, "{} ", volatility_level) +
+            fmt::format("(${:.6f})  ", volatility) +
+            fmt::format(fg(LABEL_COLOR), "Session: ") +
+            fmt::format(fg(session_change >= 0 ? GAIN_COLOR : LOSS_COLOR) | fmt::emphasis::bold,
+                        "${:.2f} ({:.2f}%)", session_change, session_percent));
+
+        lines.push_back(fmt::format(fg(RULE_COLOR), "{}", thin_separator));
+    }
+
+    uint64_t dropped = 0;
+    for (const auto& source : m_sources) {
+        dropped += source->dropped_events();
+    }
+    lines.push_back(fmt::format(fg(fmt::rgb(180, 180, 180)) | fmt::emphasis::italic,
+        " {} instrument(s) | {} Hz | dropped events: {} | Press 'q' to stop streaming",
+        m_market_data.size(), m_refresh_hz, dropped));
+    return lines;
+}
+string StreamRenderer::diff(const vector<string>& previous, const vector<string>& next) {
+    string out;
+    size_t rows = max(previous.size(), next.size());
+    for (size_t row = 0; row < rows; ++row) {
+        if (row >= next.size()) {
+            out += fmt::format("\033[{};1H\033[K", row + 1);
+        } else if (row >= previous.size() || previous[row] != next[row]) {
+            out += fmt::format("\033[{};1H", row + 1);
+            out += next[row];
+            out += "\033[K";
+        }
+    }
+    return out;
+}
+void StreamRenderer::render() {
+    int width = utils::getTerminalWidth();
+    vector<string> frame = compose(width);
+    string out;
+    if (width != m_screen_width) {
+        out = "\033[2J";
+        m_screen.clear();
+        m_screen_width = width;
+    }
+    out += diff(m_screen, frame);
+    if (!out.empty()) {
+        fwrite(out.data(), 1, out.size(), stdout);
+        fflush(stdout);
+    }
+    m_screen = move(frame);
+    uint64_t rendered = DERIBIT_TRACE_STAMP();
+    for (const PendingTrace& trace : m_pending_traces) {
+        m_monitor.record_stage(PerformanceMonitor::STAGE_RENDER, trace.kind, trace.applied, rendered);
+        m_monitor.record_stage(PerformanceMonitor::STAGE_TOTAL, trace.kind, trace.received, rendered);
+    }
+    m_pending_traces.clear();
+}
@@ -14,6 +14,8 @@
 #include <unistd.h>
 #endif
 #include <fcntl.h>
+#include <cstring>
+#include <fmt/format.h>
 using namespace std;
 using json = nlohmann::json;
 int utils::getTerminalWidth() {
@@ -58,14 +60,26 @@ void utils::printHelp() {
     fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "🔍 Displays metadata for the specified connection");
     fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> show_messages <id>");
     fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📋 Lists all messages sent and received on the specified connection");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> set_history <id> <n> [file]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "🗂️ Keeps the last n messages, spilling older ones to file (or 'off')");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> capture <id> start <file>|stop");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "🎞️ Records every raw frame of the connection to a binary journal");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> replay <file> [realtime] [view]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "⏯️ Replays a captured journal through the message handler offline");
     fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> send <id> <message>");
     fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📤 Sends a message to the specified connection");
     fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> view_subscriptions");
     fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📊 Displays the list of subscribed symbols for orderbook updates");
-    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> view_stream");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> view_stream [hz]");
     fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📈 Displays the stream of orderbook updates for subscribed symbols");
-    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> show_latency_report");
-    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "⏱️ Generates a performance latency report for the current session");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> show_book <instrument> [depth]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📚 Prints the locally maintained order book for the instrument");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> show_latency_report [live]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "⏱️ Lifetime and last 1s/10s/60s latency; 'live' refreshes every second");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> metrics_server [start [port]|stop]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📡 Serves Prometheus metrics on 127.0.0.1 (default port 9464)");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> flight_recorder [dump|slow|...]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "🛩️ Shows the event recorder; dump [file], slow <us>, dir <path>, enable|disable <trigger>");
     fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<30} : ", "> reset_report");
     fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n\n", "🔄 Clears the latency report data for the current session");
     fmt::print(fg(fmt::rgb(153, 120, 89)) | fmt::emphasis::bold, "💹 DERIBIT API COMMANDS:\n");
@@ -91,15 +105,23 @@ void utils::printHelp() {
     fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📋 Retrieve open orders with optional filtering");
     fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> positions [currency] [kind]");
     fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "💼 Fetch current open positions, optionally filtered by currency or instrument type");
-    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> orderbook <instrument> [depth]");
-    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n\n", "📈 View current buy and sell orders for an instrument, with optional depth limit");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> orderbook <instrument> [depth] [remote]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📈 View current buy and sell orders; served from the local book when fresh, 'remote' forces the RPC");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> load_instruments [currency|any]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n\n", "🗃️ Load tick sizes and contract specs into the instrument registry and cache file");
     fmt::print(fg(fmt::rgb(153, 133, 89)) | fmt::emphasis::bold, "  📡 Symbol Subscription:\n");
-    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> subscribe [symbol]");
-    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📥 Subscribes to that symbol to stream continuous orderbook updates");
-    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> unsubscribe [symbol]");
-    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📤 Unsubscribes to that symbol stream continuous orderbook updates");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit connect_pool <size> [rate|instrument]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "🧵 Opens a pool of testnet sockets and shards new subscriptions across them");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> subscribe <symbol|channel>...");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📥 Subscribes to index, ticker, trades, book or user.* channels; stays active across commands");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> unsubscribe <symbol|channel>...");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📤 Releases the channels; the exchange is told once nothing else holds them");
     fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> unsubscribe_all");
     fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "🚫 Unsubscribes to all symbols that have been subscribed to stream real time data");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> subscribe_book <instrument> [raw|100ms]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "📚 Maintains a local L2 book from book.<instrument> deltas");
+    fmt::print(fg(fmt::rgb(220, 220, 220)) | fmt::emphasis::bold, "  {:<60} : ", "> Deribit <id> unsubscribe_book <instrument> [raw|100ms]");
+    fmt::print(fg(fmt::rgb(79, 134, 140)), "{}\n", "🗑️ Stops the book subscription and drops the local book");
     fmt::print(fg(fmt::rgb(204, 153, 0)) | fmt::emphasis::bold, "\n{}\n\n", separator);
 }
 void utils::printcmd(string const &str){
@@ -225,8 +247,6 @@ bool utils::is_key_pressed(char key) {
     return false;
 }
 void utils::printOrderbook(const string &instrument, const string &data, int depth) {
-    int terminal_width = utils::getTerminalWidth();
-    string separator(terminal_width, '-');
     json orderbook;
     try {
         orderbook = json::parse(data);
@@ -234,111 +254,132 @@ void utils::printOrderbook(const string &instrument, const string &data, int dep
         printerr("❌ Error parsing orderbook data: " + string(e.what()) + "\n");
         return;
     }
-    fmt::print(fg(fmt::rgb(240, 240, 240)) | bg(fmt::rgb(51, 102, 153)) | fmt::emphasis::bold, "\n{:^{}}\n",
-               "📊 ORDERBOOK: " + instrument, terminal_width);
-    fmt::print(fg(fmt::rgb(150, 150, 150)), "{}\n", separator);
-    string timestamp = "";
-    if (orderbook.contains("timestamp")) {
-        if (orderbook["timestamp"].is_string()) {
-            timestamp = orderbook["timestamp"].get<string>();
-        } else if (orderbook["timestamp"].is_number()) {
-            timestamp = to_string(orderbook["timestamp"].get<int64_t>());
-        }
-        if (!timestamp.empty()) {
-            auto ts = stoull(timestamp);
-            auto tp = chrono::time_point<chrono::system_clock>(chrono::milliseconds(ts));
+    printOrderbook(instrument, orderbook, depth);
+}
+namespace {
+    typedef char LevelText[32];
+
+    void printOrderbookHeader(const string &instrument, int64_t timestamp_ms, int terminal_width) {
+        string separator(terminal_width, '-');
+        fmt::print(fg(fmt::rgb(240, 240, 240)) | bg(fmt::rgb(51, 102, 153)) | fmt::emphasis::bold, "\n{:^{}}\n",
+                   "📊 ORDERBOOK: " + instrument, terminal_width);
+        fmt::print(fg(fmt::rgb(150, 150, 150)), "{}\n", separator);
+        string timestamp = "";
+        if (timestamp_ms > 0) {
+            auto tp = chrono::time_point<chrono::system_clock>(chrono::milliseconds(timestamp_ms));
             auto time = chrono::system_clock::to_time_t(tp);
             timestamp = string(ctime(&time));
             timestamp.pop_back();
         }
+        fmt::print(fg(fmt::rgb(150, 150, 150)), "⏰ Time: ");
+        fmt::print(fg(fmt::rgb(204, 173, 0)), "{}\n\n", timestamp);
+        int column_width = terminal_width / 4;
+        fmt::print(fg(fmt::rgb(240, 240, 240)) | fmt::emphasis::bold,
+                   "{:^{}} | {:^{}} | {:^{}} | {:^{}}\n",
+                   "💰 BID AMOUNT", column_width,
+                   "📊 BID PRICE", column_width,
+                   "📈 ASK PRICE", column_width,
+                   "💵 ASK AMOUNT", column_width);
+        fmt::print(fg(fmt::rgb(150, 150, 150)), "{}\n", separator);
+    }
+
+    void printOrderbookRow(const char *bid_amount, const char *bid_price, const char *ask_price,
+                           const char *ask_amount, int column_width) {
+        if (bid_price) {
+            fmt::print(fg(fmt::rgb(102, 153, 204)), "{:^{}}", bid_amount, column_width);
+            fmt::print(" | ");
+            fmt::print(fg(fmt::rgb(102, 153, 102)) | fmt::emphasis::bold, "{:^{}}", bid_price, column_width);
+        } else {
+            fmt::print("{:^{}}", "", column_width);
+            fmt::print(" | ");
+            fmt::print("{:^{}}", "", column_width);
+        }
+        if (ask_price) {
+            fmt::print(" | ");
+            fmt::print(fg(fmt::rgb(153, 51, 51)) | fmt::emphasis::bold, "{:^{}}", ask_price, column_width);
+            fmt::print(" | ");
+            fmt::print(fg(fmt::rgb(102, 153, 204)), "{:^{}}", ask_amount, column_width);
+        } else {
+            fmt::print(" | ");
+            fmt::print("{:^{}}", "", column_width);
+            fmt::print(" | ");
+            fmt::print("{:^{}}", "", column_width);
+        }
+        fmt::print("\n");
     }
-    fmt::print(fg(fmt::rgb(150, 150, 150)), "⏰ Time: ");
-    fmt::print(fg(fmt::rgb(204, 173, 0)), "{}\n\n", timestamp);
+
+    const char* formatLevelValue(const json &value, LevelText &out) {
+        if (value.is_string()) {
+            const string &text = value.get_ref<const string&>();
+            size_t length = min(text.size(), sizeof(out) - 1);
+            memcpy(out, text.data(), length);
+            out[length] = '\0';
+        } else if (value.is_number()) {
+            auto result = fmt::format_to_n(out, sizeof(out) - 1, "{}", value.get<double>());
+            *result.out = '\0';
+        } else {
+            return "N/A";
+        }
+        return out;
+    }
+}
+void utils::printOrderbook(const string &instrument, const json &orderbook, int depth) {
+    int terminal_width = utils::getTerminalWidth();
+    int64_t timestamp_ms = 0;
+    if (orderbook.contains("timestamp")) {
+        if (orderbook["timestamp"].is_string()) {
+            timestamp_ms = stoll(orderbook["timestamp"].get<string>());
+        } else if (orderbook["timestamp"].is_number()) {
+            timestamp_ms = orderbook["timestamp"].get<int64_t>();
+        }
+    }
+    printOrderbookHeader(instrument, timestamp_ms, terminal_width);
     int column_width = terminal_width / 4;
-    fmt::print(fg(fmt::rgb(240, 240, 240)) | fmt::emphasis::bold,
-               "{:^{}} | {:^{}} | {:^{}} | {:^{}}\n",
-               "💰 BID AMOUNT", column_width,
-               "📊 BID PRICE", column_width,
-               "📈 ASK PRICE", column_width,
-               "💵 ASK AMOUNT", column_width);
-    fmt::print(fg(fmt::rgb(150, 150, 150)), "{}\n", separator);
-    vector<vector<string>> bids;
-    vector<vector<string>> asks;
     if (orderbook.contains("result") &&
         orderbook["result"].contains("bids") &&
         orderbook["result"].contains("asks")) {
-        for (const auto& bid : orderbook["result"]["bids"]) {
-            if (bids.size() >= depth) break;
-            string price;
-            if (bid[0].is_string()) {
-                price = bid[0].get<string>();
-            } else if (bid[0].is_number()) {
-                price = to_string(bid[0].get<double>());
-            } else {
-                price = "N/A";
-            }
-            string amount;
-            if (bid[1].is_string()) {
-                amount = bid[1].get<string>();
-            } else if (bid[1].is_number()) {
-                amount = to_string(bid[1].get<double>());
-            } else {
-                amount = "N/A";
-            }
-            bids.push_back({price, amount});
-        }
-        for (const auto& ask : orderbook["result"]["asks"]) {
-            if (asks.size() >= depth) break;
-            string price;
-            if (ask[0].is_string()) {
-                price = ask[0].get<string>();
-            } else if (ask[0].is_number()) {
-                price = to_string(ask[0].get<double>());
-            } else {
-                price = "N/A";
-            }
-            string amount;
-            if (ask[1].is_string()) {
-                amount = ask[1].get<string>();
-            } else if (ask[1].is_number()) {
-                amount = to_string(ask[1].get<double>());
-            } else {
-                amount = "N/A";
-            }
-            asks.push_back({price, amount});
-        }
-        size_t max_rows = max(bids.size(), asks.size());
+        const json &bids = orderbook["result"]["bids"];
+        const json &asks = orderbook["result"]["asks"];
+        size_t max_rows = min(static_cast<size_t>(max(depth, 0)), max(bids.size(), asks.size()));
+        LevelText bid_amount, bid_price, ask_price, ask_amount;
         for (size_t i = 0; i < max_rows; i++) {
-            if (i < bids.size()) {
-                fmt::print(fg(fmt::rgb(102, 153, 204)), "{:^{}}", bids[i][1], column_width);
-                fmt::print(" | ");
-                fmt::print(fg(fmt::rgb(102, 153, 102)) | fmt::emphasis::bold, "{:^{}}", bids[i][0], column_width);
-            } else {
-                fmt::print("{:^{}}", "", column_width);
-                fmt::print(" | ");
-                fmt::print("{:^{}}", "", column_width);
-            }
-            if (i < asks.size()) {
-                fmt::print(" | ");
-                fmt::print(fg(fmt::rgb(153, 51, 51)) | fmt::emphasis::bold, "{:^{}}", asks[i][0], column_width);
-                fmt::print(" | ");
-                fmt::print(fg(fmt::rgb(102, 153, 204)), "{:^{}}", asks[i][1], column_width);
-            } else {
-                fmt::print(" | ");
-                fmt::print("{:^{}}", "", column_width);
-                fmt::print(" | ");
-                fmt::print("{:^{}}", "", column_width);
-            }
-            fmt::print("\n");
+            bool has_bid = i < bids.size();
+            bool has_ask = i < asks.size();
+            printOrderbookRow(has_bid ? formatLevelValue(bids[i][1], bid_amount) : nullptr,
+                              has_bid ? formatLevelValue(bids[i][0], bid_price) : nullptr,
+                              has_ask ? formatLevelValue(asks[i][0], ask_price) : nullptr,
+                              has_ask ? formatLevelValue(asks[i][1], ask_amount) : nullptr,
+                              column_width);
         }
     } else {
         printerr("❌ Invalid orderbook format or empty orderbook\n");
     }
-    fmt::print(fg(fmt::rgb(180, 180, 180)), "{}\n", separator);
+    fmt::print(fg(fmt::rgb(180, 180, 180)), "{}\n", string(terminal_width, '-'));
 }
-void utils::printPositions(const string &data) {
+void utils::printOrderbook(const OrderBookManager::TopOfBook &book, int depth) {
     int terminal_width = utils::getTerminalWidth();
-    string separator(terminal_width, '-');
+    printOrderbookHeader(book.instrument, book.timestamp, terminal_width);
+    int column_width = terminal_width / 4;
+    const InstrumentScale &scale = book.scale;
+    size_t max_rows = min(static_cast<size_t>(max(depth, 0)), max(book.bids.size(), book.asks.size()));
+    LevelText bid_amount, bid_price, ask_price, ask_amount;
+    for (size_t i = 0; i < max_rows; i++) {
+        bool has_bid = i < book.bids.size();
+        bool has_ask = i < book.asks.size();
+        if (has_bid) {
+            scale.format(book.bids[i].amount, bid_amount, sizeof(bid_amount));
+            scale.format(book.bids[i].price, bid_price, sizeof(bid_price));
+        }
+        if (has_ask) {
+            scale.format(book.asks[i].price, ask_price, sizeof(ask_price));
+            scale.format(book.asks[i].amount, ask_amount, sizeof(ask_amount));
+        }
+        printOrderbookRow(has_bid ? bid_amount : nullptr, has_bid ? bid_price : nullptr,
+                          has_ask ? ask_price : nullptr, has_ask ? ask_amount : nullptr, column_width);
+    }
+    fmt::print(fg(fmt::rgb(180, 180, 180)), "{}\n", string(terminal_width, '-'));
+}
+void utils::printPositions(const string &data) {
     json positions_data;
     try {
         positions_data = json::parse(data);
@@ -346,6 +387,11 @@ void utils::printPositions(const string &data) {
         printerr("❌ Error parsing positions data: " + string(e.what()) + "\n");
         return;
     }
+    printPositions(positions_data);
+}
+void utils::printPositions(const json &positions_data) {
+    int terminal_width = utils::getTerminalWidth();
+    string separator(terminal_width, '-');
     fmt::print(fg(fmt::rgb(240, 240, 240)) | bg(fmt::rgb(51, 102, 153)) | fmt::emphasis::bold, "\n{:^{}}\n",
                "📊 POSITIONS SUMMARY", terminal_width);
     fmt::print(fg(fmt::rgb(150, 150, 150)), "{}\n", separator);
@@ -410,8 +456,6 @@ void utils::printPositions(const string &data) {
     fmt::print(fg(fmt::rgb(180, 180, 180)), "{}\n", separator);
 }
 void utils::printOpenOrders(const string &data) {
-    int terminal_width = utils::getTerminalWidth();
-    string separator(terminal_width, '-');
     json orders_data;
     try {
         orders_data = json::parse(data);
@@ -419,6 +463,11 @@ void utils::printOpenOrders(const string &data) {
         printerr("Error parsing orders data: " + string(e.what()) + "\n");
         return;
     }
+    printOpenOrders(orders_data);
+}
+void utils::printOpenOrders(const json &orders_data) {
+    int terminal_width = utils::getTerminalWidth();
+    string separator(terminal_width, '-');
     fmt::print(fg(fmt::rgb(240, 240, 240)) | bg(fmt::rgb(51, 102, 153)) | fmt::emphasis::bold, "\n{:^{}}\n",
                "OPEN ORDERS", terminal_width);
     fmt::print(fg(fmt::rgb(150, 150, 150)), "{}\n", separator);
@@ -1,12 +1,23 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <charconv>
 #include <vector>
 #include <chrono>
+#include <future>
+#include <thread>
 #include <fmt/color.h>
 #include <readline/readline.h>
 #include <readline/history.h>
 #include "network/socket_client.h"
+#include "network/replay_driver.h"
+#include "helpers/stream_renderer.h"
+#include "market_data/order_book.h"
+#include "market_data/instrument_registry.h"
+#include "network/subscription_manager.h"
+#include "network/metrics_server.h"
+#include "performance/flight_recorder.h"
 #include "exchange_interface/market_api.h"
 #include "helpers/utility.h"
 #include "performance/monitor.h"
@@ -18,7 +29,14 @@ int main() {
     bool done = false;
     char* input;
     SocketEndpoint endpoint;
+    MetricsServer metrics_server(endpoint);
+    srand(time(NULL));
     utils::printHeader();
+    size_t cached_instruments = getInstrumentRegistry().load_cache(InstrumentRegistry::DEFAULT_CACHE_PATH);
+    if (cached_instruments > 0) {
+        utils::printinfo(fmt::format("Loaded {} instruments from {}\n", cached_instruments,
+                                     InstrumentRegistry::DEFAULT_CACHE_PATH));
+    }
     while (!done) {
         input = readline(fmt::format(fg(fmt::color::blue), "tradexderibit> ").c_str());
         if (!input) {
@@ -66,12 +84,12 @@ int main() {
             } else {
                 ConnectionDetails::ptr metadata = endpoint.get_metadata(id);
                 if (metadata) {
-                    if (metadata->m_received_data.empty()) {
+                    if (metadata->history().size() == 0) {
                         fmt::print(fg(fmt::color::yellow), "> No messages for connection {}\n", id);
                     } else {
-                        for (const auto& msg : metadata->m_received_data) {
-                            cout << msg << "\n\n";
-                        }
+                        metadata->history().for_each([](const MessageHistory::Entry& entry) {
+                            cout << MessageHistory::format(entry) << "\n\n";
+                        });
                     }
                 } else {
                     fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
@@ -79,12 +97,264 @@ int main() {
                 }
             }
         }
+        else if (command.substr(0, 11) == "set_history") {
+            stringstream ss(command);
+            string cmd;
+            int id;
+            size_t capacity;
+            string spill_file;
+            ss >> cmd >> id >> capacity;
+            if (ss.fail() || capacity == 0) {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                           "Error: Usage: set_history <connection_id> <capacity> [spill_file|off]\n");
+            } else {
+                ss >> spill_file;
+                ConnectionDetails::ptr metadata = endpoint.get_metadata(id);
+                if (!metadata) {
+                    fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                               "> Unknown connection id {}\n", id);
+                } else {
+                    metadata->set_history_capacity(capacity);
+                    if (spill_file == "off") {
+                        metadata->history().stop_spill();
+                    } else if (!spill_file.empty() && !metadata->history().spill_to(spill_file)) {
+                        fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                                   "> Could not open spill file {}\n", spill_file);
+                    }
+                    fmt::print(fg(fmt::color::green),
+                               "> History for connection {} now keeps the last {} messages\n", id, capacity);
+                }
+            }
+        }
+        else if (command.substr(0, 8) == "capture ") {
+            stringstream ss(command);
+            string cmd;
+            int id;
+            string action;
+            string path;
+            ss >> cmd >> id >> action;
+            ConnectionDetails::ptr metadata = ss.fail() ? nullptr : endpoint.get_metadata(id);
+            ss >> path;
+            if (!metadata) {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                           "Error: Usage: capture <connection_id> start <file> | capture <connection_id> stop\n");
+            } else if (action == "start" && !path.empty()) {
+                if (metadata->start_capture(path)) {
+                    fmt::print(fg(fmt::color::green), "> Capturing frames of connection {} to {}\n", id, path);
+                } else {
+                    fmt::print(fg(fmt::color::red) | fmt::emphasis::bold, "> Could not open journal {}\n", path);
+                }
+            } else if (action == "stop") {
+                auto journal = metadata->capture_journal();
+                if (journal) {
+                    metadata->stop_capture();
+                    fmt::print(fg(fmt::color::green), "> Capture stopped: {} frames written to {}\n",
+                               journal->frames_written(), journal->path());
+                    if (journal->frames_dropped() > 0) {
+                        fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                                   "> {} frames dropped, {} failed writes\n",
+                                   journal->frames_dropped(), journal->write_failures());
+                    }
+                } else {
+                    fmt::print(fg(fmt::color::yellow), "> Connection {} is not capturing\n", id);
+                }
+            } else {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                           "Error: Usage: capture <connection_id> start <file> | capture <connection_id> stop\n");
+            }
+        }
+        else if (command.substr(0, 7) == "replay ") {
+            stringstream ss(command);
+            string cmd;
+            string path;
+            string option;
+            bool realtime = false;
+            bool view = false;
+            ss >> cmd >> path;
+            while (ss >> option) {
+                realtime = realtime || option == "realtime";
+                view = view || option == "view";
+            }
+            // Replay gets its own books, histograms and flight recorder so recorded
+            // frames never overwrite live books, skew the live latency report or
+            // trigger live anomaly dumps.
+            OrderBookManager replay_books;
+            PerformanceMonitor replay_monitor;
+            FlightRecorder replay_flight;
+            auto target = make_shared<ConnectionDetails>(-1, "replay://" + path, nullptr,
+                                                         &replay_books, &replay_monitor, &replay_flight);
+            ReplayDriver driver(*target);
+            if (!driver.open(path)) {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                           "> Could not open frame journal {}\n", path);
+            } else {
+                StreamRenderer renderer({target});
+                if (view) {
+                    renderer.start();
+                }
+                ReplayDriver::Stats stats = driver.run(realtime ? ReplayDriver::REALTIME : ReplayDriver::MAX_SPEED);
+                if (view) {
+                    renderer.stop();
+                }
+
+                vector<pair<string, string>> content = {
+                    {"Journal", path},
+                    {"Pace", realtime ? "Wall clock" : "Max speed"},
+                    {"Frames Replayed", to_string(stats.frames_replayed)},
+                    {"Outbound Skipped", to_string(stats.frames_skipped)},
+                    {"Bytes", to_string(stats.bytes_replayed)},
+                    {"Elapsed", fmt::format("{:.3f} ms", stats.elapsed.count() / 1e6)},
+                    {"Recorded Span", fmt::format("{:.3f} ms", stats.recorded_span.count() / 1e6)},
+                    {"Throughput", fmt::format("{:.0f} frames/s, {:.2f} MiB/s",
+                                               stats.frames_per_second(), stats.megabytes_per_second())},
+                    {"Handler Avg/Max", fmt::format("{} ns / {} ns", stats.average_handler_time().count(),
+                                                    stats.max_handler_time.count())},
+                    {"Books Rebuilt", to_string(replay_books.instruments().size())},
+                    {"Dropped Stream Events", to_string(target->dropped_events())}
+                };
+                utils::displayBox("REPLAY COMPLETE", content, fmt::rgb(0, 191, 255), "⏯️");
+            }
+        }
         else if (command.substr(0, 19) == "show_latency_report") {
-            cout << getPerformanceMonitor().generate_report() << endl;
+            stringstream ss(command);
+            string cmd;
+            string mode;
+            ss >> cmd >> mode;
+            if (mode == "live") {
+                // Redraw the rolling windows once a second until 'q'.
+                bool watching = true;
+                while (watching) {
+                    cout << "\033[H\033[2J" << getPerformanceMonitor().generate_window_report();
+                    fmt::print(fmt::fg(fmt::color::blue) | fmt::emphasis::bold, "> Live latency... Press 'q' to quit.\n");
+                    cout << flush;
+                    for (int tick = 0; tick < 20 && watching; ++tick) {
+                        watching = !utils::is_key_pressed('q');
+                        this_thread::sleep_for(chrono::milliseconds(50));
+                    }
+                }
+            } else {
+                cout << getPerformanceMonitor().generate_report() << endl;
+                cout << getPerformanceMonitor().generate_window_report() << endl;
+            }
+        }
+        else if (command.substr(0, 14) == "metrics_server") {
+            stringstream ss(command);
+            string cmd;
+            string action;
+            int port = MetricsServer::DEFAULT_PORT;
+            ss >> cmd >> action;
+            if (action == "start") {
+                if (!(ss >> port)) {
+                    port = MetricsServer::DEFAULT_PORT;
+                }
+                if (metrics_server.start(port)) {
+                    fmt::print(fg(fmt::color::green) | fmt::emphasis::bold,
+                               "> Serving Prometheus metrics on http://127.0.0.1:{}/metrics\n", port);
+                } else {
+                    fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                               "> Could not start metrics server: {}\n", metrics_server.error());
+                }
+            } else if (action == "stop") {
+                metrics_server.stop();
+                fmt::print(fg(fmt::color::cyan), "> Metrics server stopped.\n");
+            } else if (action.empty()) {
+                if (metrics_server.running()) {
+                    fmt::print(fg(fmt::color::cyan), "> Metrics server listening on port {}\n", metrics_server.port());
+                } else {
+                    fmt::print(fg(fmt::color::yellow), "> Metrics server is not running.\n");
+                }
+            } else {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                           "Error: Usage: metrics_server [start [port]|stop]\n");
+            }
+        }
+        else if (command.substr(0, 15) == "flight_recorder") {
+            stringstream ss(command);
+            string cmd;
+            string action;
+            string argument;
+            ss >> cmd >> action >> argument;
+            FlightRecorder& flight = getFlightRecorder();
+            if (action.empty()) {
+                vector<pair<string, string>> content = {
+                    {"Buffered Events", to_string(flight.collect().size())},
+                    {"Slow Callback", flight.slow_callback_ns() ? fmt::format("{} µs", flight.slow_callback_ns() / 1000)
+                                                                : string("off")},
+                    {"Dump Directory", flight.dump_directory()},
+                    {"Dumps Written", to_string(flight.dumps())}
+                };
+                for (size_t trigger = 0; trigger < FlightRecorder::TRIGGER_MANUAL; ++trigger) {
+                    auto type = static_cast<FlightRecorder::Trigger>(trigger);
+                    content.push_back({fmt::format("Trigger {}", FlightRecorder::trigger_name(type)),
+                                       flight.enabled(type) ? "on" : "off"});
+                }
+                utils::displayBox("FLIGHT RECORDER", content, fmt::rgb(0, 191, 255), "🛩️");
+            } else if (action == "dump") {
+                if (argument.empty()) {
+                    argument = flight.dump_directory() + "/flight-manual.log";
+                }
+                string path = flight.dump(argument);
+                if (path.empty()) {
+                    fmt::print(fg(fmt::color::red) | fmt::emphasis::bold, "> Could not write {}\n", argument);
+                } else {
+                    fmt::print(fg(fmt::color::green), "> Flight recorder dumped to {}\n", path);
+                }
+            } else if (action == "slow" && !argument.empty()) {
+                constexpr int64_t max_us = chrono::microseconds(FlightRecorder::MAX_SLOW_CALLBACK).count();
+                int64_t threshold_us = -1;
+                auto parsed = from_chars(argument.data(), argument.data() + argument.size(), threshold_us);
+                if (parsed.ec != errc() || parsed.ptr != argument.data() + argument.size() ||
+                    threshold_us < 0 || threshold_us > max_us) {
+                    fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                               "> Invalid threshold {}. Use 0 to {} µs\n", argument, max_us);
+                } else {
+                    flight.set_slow_callback(chrono::microseconds(threshold_us));
+                    fmt::print(fg(fmt::color::green), "> Slow callback trigger {}\n",
+                               threshold_us ? "set to " + argument + " µs" : string("disabled"));
+                }
+            } else if (action == "dir" && !argument.empty()) {
+                flight.set_dump_directory(argument);
+                fmt::print(fg(fmt::color::green), "> Dumps will be written to {}\n", argument);
+            } else if ((action == "enable" || action == "disable") && !argument.empty()) {
+                bool found = false;
+                for (size_t trigger = 0; trigger < FlightRecorder::TRIGGER_MANUAL; ++trigger) {
+                    auto type = static_cast<FlightRecorder::Trigger>(trigger);
+                    if (argument == FlightRecorder::trigger_name(type)) {
+                        flight.set_enabled(type, action == "enable");
+                        found = true;
+                    }
+                }
+                if (found) {
+                    fmt::print(fg(fmt::color::green), "> Trigger {} {}d\n", argument, action);
+                } else {
+                    fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                               "> Unknown trigger {}. Use slow_callback, timeout, reconnect, sequence_gap or parse_error\n",
+                               argument);
+                }
+            } else {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                           "Error: Usage: flight_recorder [dump [file]|slow <us>|dir <path>|enable <trigger>|disable <trigger>]\n");
+            }
         }
         else if (command.substr(0, 12) == "reset_report") {
             getPerformanceMonitor().reset();
         }
+        else if (command.substr(0, 10) == "show_book ") {
+            stringstream ss(command);
+            string cmd;
+            string instrument;
+            int depth = 10;
+            ss >> cmd >> instrument >> depth;
+            OrderBookManager::TopOfBook book;
+            if (!getOrderBookManager().top_levels(instrument, static_cast<size_t>(max(depth, 0)), book)) {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                           "> No local book for {}. Use 'deribit <id> subscribe_book {}' first.\n", instrument, instrument);
+            } else {
+                utils::printOrderbook(book, depth);
+                fmt::print(fg(fmt::color::white), "Change ID: {} | {} | {} updates, {} gaps\n\n", book.change_id,
+                           book.synced ? "synced" : "awaiting snapshot", book.updates_applied, book.gaps_detected);
+            }
+        }
         else if (command.substr(0, 4) == "show") {
             int id = atoi(command.substr(5).c_str());
             ConnectionDetails::ptr metadata = endpoint.get_metadata(id);
@@ -94,7 +364,19 @@ int main() {
                 fmt::print(fg(fmt::color::yellow), "Status: {}\n", metadata->get_status());
                 fmt::print(fg(fmt::color::white), "URI: {}\n", metadata->get_uri());
                 fmt::print(fg(fmt::color::white), "Server: {}\n", metadata->get_server());
-                fmt::print(fg(fmt::color::magenta), "Messages Count: {}\n", metadata->m_received_data.size());
+                MessageHistory& history = metadata->history();
+                fmt::print(fg(fmt::color::magenta), "Messages Count: {}\n", history.size());
+                fmt::print(fg(fmt::color::magenta), "History: {}/{} messages, {:.1f} KiB, {} evicted\n",
+                           history.size(), history.capacity(), history.memory_usage() / 1024.0, history.evicted());
+                if (!history.spill_path().empty()) {
+                    fmt::print(fg(fmt::color::white), "Spill File: {} ({} dropped)\n", history.spill_path(),
+                               history.spill_dropped());
+                }
+                if (auto journal = metadata->capture_journal()) {
+                    fmt::print(fg(fmt::color::white), "Capture: {} ({} frames, {} bytes, {} dropped, {} failed writes)\n",
+                               journal->path(), journal->frames_written(), journal->bytes_written(),
+                               journal->frames_dropped(), journal->write_failures());
+                }
                 if (!metadata->get_error_reason().empty()) {
                     fmt::print(fg(fmt::color::red), "Error: {}\n", metadata->get_error_reason());
                 }
@@ -121,10 +403,17 @@ int main() {
             string message = "";
             ss >> cmd >> id;
             getline(ss, message);
-            endpoint.send(id, message);
-            unique_lock<mutex> lock(endpoint.get_metadata(id)->connection_mutex);
-            endpoint.get_metadata(id)->connection_cv.wait(lock, [&] { return endpoint.get_metadata(id)->DATA_PROCESSED; });
-            endpoint.get_metadata(id)->DATA_PROCESSED = false;
+            future<json> response = endpoint.send_async(id, message);
+            try {
+                response.get();
+            } catch (const RequestTimeout& e) {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                          "> Request timed out. The server did not respond in time.\n");
+            } catch (const ConnectionClosed& e) {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold, "> {}\n", e.what());
+            } catch (const exception& e) {
+                // send failures are already reported by send_async
+            }
         }
         else if (command == "deribit connect" || command == "Deribit connect") {
             const string uri = "wss://test.deribit.com/ws/api/v2";
@@ -140,37 +429,66 @@ int main() {
                            "> Failed to create connection to Deribit TESTNET.\n");
             }
         }
-        else if(command == "view_stream"){
+        else if (command.substr(0, 20) == "deribit connect_pool" || command.substr(0, 20) == "Deribit connect_pool") {
+            stringstream ss(command);
+            string cmd, sub, policy_name{"rate"};
+            int size = 4;
+            ss >> cmd >> sub;
+            if (!(ss >> ws).eof() && !(ss >> size)) {
+                size = 0;
+            }
+            ss >> policy_name;
+            if (size < 1 || size > static_cast<int>(SocketEndpoint::MAX_POOL_SIZE) ||
+                (policy_name != "rate" && policy_name != "instrument")) {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                           "Usage: deribit connect_pool <size 1-{}> [rate|instrument]\n", SocketEndpoint::MAX_POOL_SIZE);
+                continue;
+            }
+            SocketEndpoint::ShardPolicy policy = policy_name == "instrument" ? SocketEndpoint::SHARD_BY_INSTRUMENT
+                                                                             : SocketEndpoint::SHARD_BY_RATE;
+            vector<int> ids = endpoint.open_pool("wss://test.deribit.com/ws/api/v2", size, policy);
+            if (ids.empty()) {
+                fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                           "> A connection pool is already open.\n");
+            } else {
+                fmt::print(fg(fmt::color::green) | fmt::emphasis::bold,
+                           "> Opened {} pooled connections to Deribit TESTNET, sharding by {}.\n", ids.size(), policy_name);
+                fmt::print(fg(fmt::color::cyan), "> Connection IDs: {}-{}\n", ids.front(), ids.back());
+                fmt::print(fmt::fg(fmt::color::white), "> Subscriptions on any pooled id are spread across the pool\n");
+            }
+        }
+        else if(command == "view_stream" || command.substr(0, 12) == "view_stream "){
+            int refresh_hz = 20;
+            stringstream ss(command);
+            string cmd;
+            ss >> cmd >> refresh_hz;
             vector<string> connections = api::getActiveSubscription();
             if(connections.size()){
-                endpoint.streamSubscriptions(connections);
+                endpoint.streamSubscriptions(connections, refresh_hz);
             } else {
                 fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
-                           "> No Subscriptions. Use 'Deribit <id> subscribe <symbol>' to add a subscription.\n");
+                           "> No Subscriptions. Use 'Deribit <id> subscribe <symbol|channel>' to add a subscription.\n");
             }
         }
         else if(command == "view_subscriptions"){
-            vector<string> connections = api::getActiveSubscription();
-            if(!connections.empty()){
+            vector<SubscriptionManager::Subscription> subscriptions = getSubscriptionManager().subscriptions();
+            if(!subscriptions.empty()){
                 fmt::print(fg(fmt::color::cyan) | fmt::emphasis::bold,
                            "\n=== Active Market Subscriptions ===\n\n");
                 int count = 1;
-                for(const auto& connection : connections){
-                    size_t prefix_pos = connection.find("deribit_price_index.");
-                    if(prefix_pos != string::npos){
-                        string index_name = connection.substr(prefix_pos + strlen("deribit_price_index."));
-                        fmt::print(fg(fmt::color::green) | fmt::emphasis::bold,
-                           "[{}] ", count++);
-                        fmt::print(fg(fmt::color::white),
-                           "{}\n", index_name);
-                    }
+                for(const auto& subscription : subscriptions){
+                    fmt::print(fg(fmt::color::green) | fmt::emphasis::bold,
+                       "[{}] ", count++);
+                    fmt::print(fg(fmt::color::white),
+                       "{:<40} conn {}  refs {}\n", getSymbolTable().name(subscription.channel),
+                       subscription.connection_id, subscription.ref_count);
                 }
                 fmt::print("\n");
             } else {
                 fmt::print(fg(fmt::color::yellow) | fmt::emphasis::bold,
                            "\n=== No Active Subscriptions ===\n");
                 fmt::print(fg(fmt::color::white),
-                           "Use 'Deribit <id> subscribe <symbol>' to add a subscription.\n\n");
+                           "Use 'Deribit <id> subscribe <symbol|channel>' to add a subscription.\n\n");
             }
         }
         else if (command.substr(0, 7) == "deribit" || command.substr(0,7) == "Deribit") {
@@ -180,24 +498,24 @@ int main() {
             ss >> cmd >> id;
             string msg = api::processRequest(command);
             if (msg != "") {
-                int success = endpoint.send(id, msg);
-                if (success >= 0) {
-                    unique_lock<mutex> lock(endpoint.get_metadata(id)->connection_mutex);
-                    bool result = endpoint.get_metadata(id)->connection_cv.wait_for(
-                        lock,
-                        chrono::seconds(10),
-                        [&] { return endpoint.get_metadata(id)->DATA_PROCESSED; }
-                    );
-                    if (!result) {
-                        fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
-                                  "> Request timed out. The server did not respond in time.\n");
+                vector<future<json>> responses;
+                if (!endpoint.send_subscription(id, msg, responses)) {
+                    responses.push_back(endpoint.send_async(id, msg, chrono::seconds(10)));
+                }
+                try {
+                    for (auto& response : responses) {
+                        response.get();
                     }
-                    endpoint.get_metadata(id)->DATA_PROCESSED = false;
-                } else {
+                } catch (const RequestTimeout& e) {
+                    fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
+                              "> Request timed out. The server did not respond in time.\n");
+                } catch (const ConnectionClosed& e) {
+                    fmt::print(fg(fmt::color::red) | fmt::emphasis::bold, "> {}\n", e.what());
+                } catch (const exception& e) {
                     fmt::print(fg(fmt::color::red) | fmt::emphasis::bold,
                               "> Failed to send request to the server. Check your connection.\n");
                 }
-            } else {
+            } else if (!REQUEST_SERVED_LOCALLY) {
                 fmt::print(fg(fmt::color::yellow) | fmt::emphasis::bold,
                           "> Request preparation failed. Please check your input parameters.\n");
             }
@@ -0,0 +1,273 @@
+#include "market_data/instrument_registry.h"
+#include "market_data/order_book.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+using namespace std;
+namespace {
+    const char CACHE_MAGIC[8] = {'D', 'X', 'I', 'N', 'S', 'T', '0', '1'};
+    const uint32_t CACHE_VERSION = 1;
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t count;
+        int64_t saved_at;
+        uint64_t checksum;
+    };
+
+    struct CacheRecord {
+        double tick_size;
+        double contract_size;
+        double min_trade_amount;
+        int64_t expiration_timestamp;
+        uint8_t kind;
+        uint8_t name_length;
+        uint8_t currency_length;
+        uint8_t reserved[5];
+    };
+
+    uint64_t checksum(const string& payload) {
+        uint64_t value = 1469598103934665603ULL;
+        for (char c : payload) {
+            value = (value ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+        }
+        return value;
+    }
+
+    int64_t nowMilliseconds() {
+        return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+const char* const InstrumentRegistry::DEFAULT_CACHE_PATH = "instruments.cache";
+InstrumentScale InstrumentRegistry::InstrumentInfo::scale() const {
+    // Book amounts are quoted in multiples of the minimum trade amount, which
+    // is the contract size for futures and a fraction of it for options.
+    return InstrumentScale::from_double(tick_size, min_trade_amount > 0 ? min_trade_amount : contract_size);
+}
+InstrumentRegistry::Kind InstrumentRegistry::kind_from_string(const string& kind) {
+    if (kind == "future") return FUTURE;
+    if (kind == "option") return OPTION;
+    if (kind == "spot") return SPOT;
+    if (kind == "future_combo") return FUTURE_COMBO;
+    if (kind == "option_combo") return OPTION_COMBO;
+    return UNKNOWN;
+}
+const char* InstrumentRegistry::kind_name(Kind kind) {
+    switch (kind) {
+        case FUTURE: return "future";
+        case OPTION: return "option";
+        case SPOT: return "spot";
+        case FUTURE_COMBO: return "future_combo";
+        case OPTION_COMBO: return "option_combo";
+        default: return "unknown";
+    }
+}
+size_t InstrumentRegistry::load(const json& instruments) {
+    size_t loaded = 0;
+    if (!instruments.is_array()) {
+        return loaded;
+    }
+    for (const json& instrument : instruments) {
+        if (!instrument.is_object() || !instrument.contains("instrument_name")) {
+            continue;
+        }
+        InstrumentInfo info;
+        info.name = instrument["instrument_name"].get<string>();
+        info.base_currency = instrument.value("base_currency", "");
+        info.kind = kind_from_string(instrument.value("kind", ""));
+        info.tick_size = instrument.value("tick_size", 0.0);
+        info.contract_size = instrument.value("contract_size", 0.0);
+        info.min_trade_amount = instrument.value("min_trade_amount", 0.0);
+        if (instrument.contains("expiration_timestamp") && instrument["expiration_timestamp"].is_number()) {
+            info.expiration_timestamp = instrument["expiration_timestamp"].get<int64_t>();
+        }
+        if (add(info)) {
+            loaded++;
+        }
+    }
+    return loaded;
+}
+bool InstrumentRegistry::add(const InstrumentInfo& source) {
+    if (source.name.empty() || source.tick_size <= 0.0) {
+        return false;
+    }
+    InstrumentInfo info = source;
+    info.symbol = getSymbolTable().intern(info.name);
+    if (info.symbol == SymbolTable::INVALID) {
+        return false;
+    }
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (info.symbol >= m_slot_of_symbol.size()) {
+            m_slot_of_symbol.resize(info.symbol + 1, SymbolTable::INVALID);
+        }
+        uint32_t& slot = m_slot_of_symbol[info.symbol];
+        if (slot == SymbolTable::INVALID) {
+            slot = static_cast<uint32_t>(m_instruments.size());
+            m_instruments.push_back(info);
+        } else {
+            m_instruments[slot] = info;
+        }
+        if (!info.base_currency.empty() &&
+            std::find(m_currencies.begin(), m_currencies.end(), info.base_currency) == m_currencies.end()) {
+            m_currencies.push_back(info.base_currency);
+        }
+    }
+    getOrderBookManager().set_scale(info.name, info.scale());
+    return true;
+}
+const InstrumentRegistry::InstrumentInfo* InstrumentRegistry::lookup(uint32_t symbol) const {
+    if (symbol >= m_slot_of_symbol.size() || m_slot_of_symbol[symbol] == SymbolTable::INVALID) {
+        return nullptr;
+    }
+    return &m_instruments[m_slot_of_symbol[symbol]];
+}
+bool InstrumentRegistry::contains(string_view name) const {
+    uint32_t symbol = getSymbolTable().find(name);
+    lock_guard<mutex> lock(m_mutex);
+    return lookup(symbol) != nullptr;
+}
+bool InstrumentRegistry::find(string_view name, InstrumentInfo& info) const {
+    uint32_t symbol = getSymbolTable().find(name);
+    lock_guard<mutex> lock(m_mutex);
+    const InstrumentInfo* found = lookup(symbol);
+    if (found == nullptr) {
+        return false;
+    }
+    info = *found;
+    return true;
+}
+bool InstrumentRegistry::is_currency(string_view currency) const {
+    lock_guard<mutex> lock(m_mutex);
+    return std::find(m_currencies.begin(), m_currencies.end(), currency) != m_currencies.end();
+}
+vector<string> InstrumentRegistry::currencies() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_currencies;
+}
+size_t InstrumentRegistry::size() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_instruments.size();
+}
+bool InstrumentRegistry::save(const string& path) const {
+    string payload;
+    uint32_t count = 0;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        payload.reserve(m_instruments.size() * (sizeof(CacheRecord) + 32));
+        for (const InstrumentInfo& info : m_instruments) {
+            if (info.name.size() > 255 || info.base_currency.size() > 255) {
+                continue;
+            }
+            CacheRecord record{};
+            record.tick_size = info.tick_size;
+            record.contract_size = info.contract_size;
+            record.min_trade_amount = info.min_trade_amount;
+            record.expiration_timestamp = info.expiration_timestamp;
+            record.kind = info.kind;
+            record.name_length = static_cast<uint8_t>(info.name.size());
+            record.currency_length = static_cast<uint8_t>(info.base_currency.size());
+            payload.append(reinterpret_cast<const char*>(&record), sizeof(record));
+            payload.append(info.name);
+            payload.append(info.base_currency);
+            count++;
+        }
+    }
+
+    CacheHeader header{};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.count = count;
+    header.saved_at = nowMilliseconds();
+    header.checksum = checksum(payload);
+
+    string temporary = path + ".tmp";
+    {
+        ofstream out(temporary, ios::binary | ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(payload.data(), payload.size());
+        if (!out) {
+            return false;
+        }
+    }
+    return rename(temporary.c_str(), path.c_str()) == 0;
+}
+void InstrumentRegistry::schedule_save(const string& path) {
+    lock_guard<mutex> lock(m_mutex);
+    m_pending_save = path;
+}
+InstrumentRegistry::SaveResult InstrumentRegistry::flush_pending_save(string& path) {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_pending_save.empty()) {
+            return NOTHING_PENDING;
+        }
+        path.swap(m_pending_save);
+        m_pending_save.clear();
+    }
+    return save(path) ? SAVED : SAVE_FAILED;
+}
+size_t InstrumentRegistry::load_cache(const string& path, chrono::milliseconds max_age) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        return 0;
+    }
+    CacheHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION) {
+        return 0;
+    }
+    int64_t now = nowMilliseconds();
+    if (now - header.saved_at > max_age.count()) {
+        return 0;
+    }
+    string payload((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (checksum(payload) != header.checksum) {
+        return 0;
+    }
+
+    size_t loaded = 0;
+    size_t offset = 0;
+    for (uint32_t i = 0; i < header.count; i++) {
+        CacheRecord record;
+        if (offset + sizeof(record) > payload.size()) {
+            break;
+        }
+        memcpy(&record, payload.data() + offset, sizeof(record));
+        offset += sizeof(record);
+        if (offset + record.name_length + record.currency_length > payload.size()) {
+            break;
+        }
+        InstrumentInfo info;
+        info.name.assign(payload.data() + offset, record.name_length);
+        offset += record.name_length;
+        info.base_currency.assign(payload.data() + offset, record.currency_length);
+        offset += record.currency_length;
+        info.kind = static_cast<Kind>(record.kind);
+        info.tick_size = record.tick_size;
+        info.contract_size = record.contract_size;
+        info.min_trade_amount = record.min_trade_amount;
+        info.expiration_timestamp = record.expiration_timestamp;
+        bool expired = info.expiration_timestamp > 0 && info.expiration_timestamp < now;
+        if (!expired && add(info)) {
+            loaded++;
+        }
+    }
+    return loaded;
+}
+void InstrumentRegistry::clear() {
+    lock_guard<mutex> lock(m_mutex);
+    m_instruments.clear();
+    m_slot_of_symbol.clear();
+    m_currencies.clear();
+    m_pending_save.clear();
+}
+InstrumentRegistry& getInstrumentRegistry() {
+    static InstrumentRegistry registry;
+    return registry;
+}
@@ -0,0 +1,89 @@
+#include "market_data/market_data_manager.h"
+#include <algorithm>
+using namespace std;
+void MarketDataManager::PriceHistory::push(double price) {
+    values[head] = price;
+    head = (head + 1) % HISTORY_LENGTH;
+    count = min(count + 1, HISTORY_LENGTH);
+}
+uint32_t MarketDataManager::resolve(uint32_t symbol, ChannelKind kind) {
+    if (symbol >= m_slot_of_symbol.size()) {
+        m_slot_of_symbol.resize(max<size_t>(symbol + 1, m_slot_of_symbol.size() * 2), SymbolTable::INVALID);
+    }
+    uint32_t& slot = m_slot_of_symbol[symbol];
+    if (slot == SymbolTable::INVALID) {
+        slot = static_cast<uint32_t>(m_slots.size());
+        m_slots.emplace_back();
+        m_slots.back().symbol = symbol;
+        m_slots.back().name = getSymbolTable().name(symbol);
+        m_slots.back().kind = kind;
+    }
+    return slot;
+}
+bool MarketDataManager::apply(const MarketEvent& event) {
+    switch (event.kind) {
+        case ChannelKind::PriceIndex: {
+            if (event.index.symbol == SymbolTable::INVALID) return false;
+            InstrumentState& state = m_slots[resolve(event.index.symbol, event.kind)];
+            update(state, event.index.timestamp, event.index.price);
+            return true;
+        }
+        case ChannelKind::Ticker: {
+            if (event.ticker.symbol == SymbolTable::INVALID) return false;
+            InstrumentState& state = m_slots[resolve(event.ticker.symbol, event.kind)];
+            if (state.kind != ChannelKind::Ticker) {
+                // Trades arrived first; the mark price takes over the price line
+                // from here, so start its series afresh instead of mixing the two.
+                state.kind = ChannelKind::Ticker;
+                state.update_count = 0;
+                state.price_history = PriceHistory();
+            }
+            state.best_bid_price = event.ticker.best_bid_price;
+            state.best_ask_price = event.ticker.best_ask_price;
+            update(state, event.ticker.timestamp, event.ticker.mark_price);
+            return true;
+        }
+        case ChannelKind::Trades: {
+            if (event.trade.symbol == SymbolTable::INVALID) return false;
+            InstrumentState& state = m_slots[resolve(event.trade.symbol, event.kind)];
+            state.last_trade_price = event.trade.price;
+            state.traded_volume += event.trade.amount;
+            state.trade_count++;
+            // Once a ticker has been seen on the instrument, it drives the price line.
+            if (state.kind == ChannelKind::Trades) {
+                update(state, event.trade.timestamp, event.trade.price);
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+void MarketDataManager::update(InstrumentState& state, int64_t timestamp, double price) {
+    if (state.update_count == 0) {
+        state.price = price;
+        state.high_price = price;
+        state.low_price = price;
+        state.open_price = price;
+    }
+    state.previous_price = state.price;
+    state.price = price;
+    state.timestamp = timestamp;
+    state.update_count++;
+    state.high_price = max(state.high_price, price);
+    state.low_price = min(state.low_price, price);
+    state.price_history.push(price);
+}
+const MarketDataManager::InstrumentState* MarketDataManager::find(uint32_t symbol) const {
+    if (symbol >= m_slot_of_symbol.size() || m_slot_of_symbol[symbol] == SymbolTable::INVALID) {
+        return nullptr;
+    }
+    return &m_slots[m_slot_of_symbol[symbol]];
+}
+const MarketDataManager::InstrumentState* MarketDataManager::find(string_view name) const {
+    return find(getSymbolTable().find(name));
+}
+void MarketDataManager::clear() {
+    m_slots.clear();
+    m_slot_of_symbol.clear();
+}
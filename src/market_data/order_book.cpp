@@ -0,0 +1,183 @@
+#include "market_data/order_book.h"
+#include <algorithm>
+using namespace std;
+OrderBook::OrderBook(const string& instrument, InstrumentScale scale)
+    : m_instrument(instrument), m_scale(scale), m_change_id(0), m_timestamp(0), m_synced(false), m_updates(0), m_gaps(0) {
+    m_bids.reserve(256);
+    m_asks.reserve(256);
+}
+void OrderBook::reset() {
+    m_bids.clear();
+    m_asks.clear();
+    m_change_id = 0;
+    m_timestamp = 0;
+    m_synced = false;
+}
+void OrderBook::rescale(InstrumentScale scale) {
+    for (vector<Level>* side : {&m_bids, &m_asks}) {
+        for (Level& level : *side) {
+            level.price = scale.to_price(m_scale.to_decimal(level.price));
+            level.amount = scale.to_qty(m_scale.to_decimal(level.amount));
+        }
+    }
+    m_scale = scale;
+}
+OrderBook::ApplyResult OrderBook::apply(const BookUpdateHeader& header, const vector<BookLevelUpdate>& bids,
+                                        const vector<BookLevelUpdate>& asks) {
+    if (header.is_snapshot) {
+        m_bids.clear();
+        m_asks.clear();
+    } else if (!m_synced) {
+        return AWAITING_SNAPSHOT;
+    } else if (header.prev_change_id != m_change_id) {
+        m_gaps++;
+        reset();
+        return SEQUENCE_GAP;
+    }
+
+    apply_levels(m_bids, bids, true);
+    apply_levels(m_asks, asks, false);
+    m_change_id = header.change_id;
+    m_timestamp = header.timestamp;
+    m_updated_at = chrono::steady_clock::now();
+    m_synced = true;
+    m_updates++;
+    return header.is_snapshot ? SNAPSHOT_APPLIED : APPLIED;
+}
+void OrderBook::apply_levels(vector<Level>& side, const vector<BookLevelUpdate>& updates, bool ascending) {
+    for (const BookLevelUpdate& update : updates) {
+        Price price = m_scale.to_price(update.price);
+        Qty amount = m_scale.to_qty(update.amount);
+        auto position = ascending
+            ? lower_bound(side.begin(), side.end(), price,
+                          [](const Level& level, Price price) { return level.price < price; })
+            : lower_bound(side.begin(), side.end(), price,
+                          [](const Level& level, Price price) { return level.price > price; });
+        bool exists = position != side.end() && position->price == price;
+
+        if (update.action == BookAction::Delete || amount.is_zero()) {
+            if (exists) {
+                side.erase(position);
+            }
+        } else if (exists) {
+            position->amount = amount;
+        } else {
+            side.insert(position, Level{price, amount});
+        }
+    }
+}
+bool OrderBook::best_bid(Level& level) const {
+    if (m_bids.empty()) {
+        return false;
+    }
+    level = m_bids.back();
+    return true;
+}
+bool OrderBook::best_ask(Level& level) const {
+    if (m_asks.empty()) {
+        return false;
+    }
+    level = m_asks.back();
+    return true;
+}
+void OrderBook::top_levels(size_t depth, vector<Level>& bids, vector<Level>& asks) const {
+    bids.assign(m_bids.rbegin(), m_bids.rbegin() + min(depth, m_bids.size()));
+    asks.assign(m_asks.rbegin(), m_asks.rbegin() + min(depth, m_asks.size()));
+}
+OrderBook* OrderBookManager::book_for(uint32_t symbol) {
+    return symbol < m_books.size() ? m_books[symbol].get() : nullptr;
+}
+OrderBook::ApplyResult OrderBookManager::apply(const MarketDataFrame& frame) {
+    uint32_t symbol = frame.book.symbol;
+    lock_guard<mutex> lock(m_mutex);
+    OrderBook* book = book_for(symbol);
+    if (book == nullptr) {
+        if (symbol == SymbolTable::INVALID) {
+            return OrderBook::AWAITING_SNAPSHOT;
+        }
+        if (symbol >= m_books.size()) {
+            m_books.resize(symbol + 1);
+        }
+        auto scale = m_scales.find(symbol);
+        m_books[symbol] = make_unique<OrderBook>(string(getSymbolTable().name(symbol)),
+                                                 scale == m_scales.end() ? InstrumentScale() : scale->second);
+        book = m_books[symbol].get();
+    }
+    return book->apply(frame.book, frame.bids, frame.asks);
+}
+bool OrderBookManager::snapshot(const string& instrument, OrderBook& book) {
+    lock_guard<mutex> lock(m_mutex);
+    OrderBook* found = book_for(getSymbolTable().find(instrument));
+    if (found == nullptr) {
+        return false;
+    }
+    book = *found;
+    return true;
+}
+void OrderBookManager::unsync(const string& instrument) {
+    lock_guard<mutex> lock(m_mutex);
+    OrderBook* found = book_for(getSymbolTable().find(instrument));
+    if (found != nullptr) {
+        found->reset();
+    }
+}
+bool OrderBookManager::best_bid(const string& instrument, OrderBook::Level& level) {
+    lock_guard<mutex> lock(m_mutex);
+    OrderBook* found = book_for(getSymbolTable().find(instrument));
+    return found != nullptr && found->best_bid(level);
+}
+bool OrderBookManager::best_ask(const string& instrument, OrderBook::Level& level) {
+    lock_guard<mutex> lock(m_mutex);
+    OrderBook* found = book_for(getSymbolTable().find(instrument));
+    return found != nullptr && found->best_ask(level);
+}
+bool OrderBookManager::top_levels(const string& instrument, size_t depth, TopOfBook& top) {
+    lock_guard<mutex> lock(m_mutex);
+    OrderBook* found = book_for(getSymbolTable().find(instrument));
+    if (found == nullptr) {
+        return false;
+    }
+    found->top_levels(depth, top.bids, top.asks);
+    top.instrument = found->instrument();
+    top.scale = found->scale();
+    top.change_id = found->change_id();
+    top.timestamp = found->timestamp();
+    top.updated_at = found->updated_at();
+    top.synced = found->is_synced();
+    top.updates_applied = found->updates_applied();
+    top.gaps_detected = found->gaps_detected();
+    return true;
+}
+void OrderBookManager::set_scale(const string& instrument, InstrumentScale scale) {
+    uint32_t symbol = getSymbolTable().intern(instrument);
+    lock_guard<mutex> lock(m_mutex);
+    m_scales[symbol] = scale;
+    if (OrderBook* book = book_for(symbol)) {
+        book->rescale(scale);
+    }
+}
+void OrderBookManager::remove(const string& instrument) {
+    lock_guard<mutex> lock(m_mutex);
+    uint32_t symbol = getSymbolTable().find(instrument);
+    if (book_for(symbol) != nullptr) {
+        m_books[symbol].reset();
+    }
+}
+vector<string> OrderBookManager::instruments() {
+    lock_guard<mutex> lock(m_mutex);
+    vector<string> names;
+    for (const auto& book : m_books) {
+        if (book) {
+            names.push_back(book->instrument());
+        }
+    }
+    return names;
+}
+void OrderBookManager::clear() {
+    lock_guard<mutex> lock(m_mutex);
+    m_books.clear();
+}
+OrderBookManager& getOrderBookManager() {
+    static OrderBookManager manager;
+    return manager;
+}
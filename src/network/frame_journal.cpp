@@ -0,0 +1,253 @@
+#include "network/frame_journal.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+namespace {
+    const char JOURNAL_MAGIC[8] = {'D', 'X', 'J', 'R', 'N', 'L', '0', '1'};
+    const uint32_t JOURNAL_VERSION = 1;
+    const size_t WRITE_BUFFER_SIZE = 256 * 1024;
+
+    size_t recordSize(size_t payload_length) {
+        return (sizeof(JournalRecordHeader) + payload_length + 7) & ~size_t(7);
+    }
+
+    bool writeAll(int fd, const char* data, size_t length, uint64_t offset) {
+        while (length > 0) {
+            ssize_t written = pwrite(fd, data, length, offset);
+            if (written <= 0) {
+                return false;
+            }
+            data += written;
+            length -= written;
+            offset += written;
+        }
+        return true;
+    }
+}
+FrameJournalWriter::FrameJournalWriter()
+    : m_fd(-1), m_buffered_frames(0), m_offset(0), m_allocated(0), m_frames(0), m_dropped(0), m_write_failures(0) {}
+FrameJournalWriter::~FrameJournalWriter() {
+    close();
+}
+bool FrameJournalWriter::open(const string& path, size_t preallocate) {
+    close();
+    lock_guard<mutex> io_lock(m_io_mutex);
+    lock_guard<mutex> lock(m_mutex);
+    m_fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (m_fd < 0) {
+        return false;
+    }
+    m_path = path;
+    m_buffer.clear();
+    m_buffer.reserve(WRITE_BUFFER_SIZE);
+    m_writing.clear();
+    m_writing.reserve(WRITE_BUFFER_SIZE);
+    m_buffered_frames = 0;
+    m_frames = 0;
+    m_dropped = 0;
+    m_write_failures = 0;
+    m_allocated = 0;
+    m_offset = sizeof(JournalFileHeader);
+    reserve(m_fd, max<uint64_t>(preallocate, sizeof(JournalFileHeader)));
+
+    JournalFileHeader header{};
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    if (!writeAll(m_fd, reinterpret_cast<const char*>(&header), sizeof(header), 0)) {
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    return true;
+}
+bool FrameJournalWriter::reserve(int fd, uint64_t end) {
+    if (end <= m_allocated) {
+        return true;
+    }
+    uint64_t target = max(end, m_allocated * 2);
+    if (posix_fallocate(fd, 0, target) != 0 && ftruncate(fd, target) != 0) {
+        return false;
+    }
+    m_allocated = target;
+    return true;
+}
+void FrameJournalWriter::append(MessageHistory::Direction direction, int connection_id, string_view payload) {
+    auto now = chrono::system_clock::now().time_since_epoch();
+    append(direction, connection_id, payload, chrono::duration_cast<chrono::nanoseconds>(now).count());
+}
+void FrameJournalWriter::append(MessageHistory::Direction direction, int connection_id,
+                                string_view payload, int64_t timestamp_ns) {
+    size_t size = recordSize(payload.size());
+    lock_guard<mutex> lock(m_mutex);
+    if (m_fd < 0) {
+        return;
+    }
+    if (connection_id < 0 || connection_id > numeric_limits<uint16_t>::max() ||
+        payload.size() > numeric_limits<uint32_t>::max() || m_buffer.size() + size > MAX_BUFFERED_BYTES) {
+        m_dropped++;
+        return;
+    }
+    JournalRecordHeader record{};
+    record.timestamp_ns = timestamp_ns;
+    record.length = static_cast<uint32_t>(payload.size());
+    record.connection_id = static_cast<uint16_t>(connection_id);
+    record.direction = direction;
+
+    size_t at = m_buffer.size();
+    m_buffer.resize(at + size);
+    memcpy(m_buffer.data() + at, &record, sizeof(record));
+    memcpy(m_buffer.data() + at + sizeof(record), payload.data(), payload.size());
+    m_buffered_frames++;
+    m_frames++;
+}
+bool FrameJournalWriter::write_pending(int fd) {
+    // Runs under m_io_mutex, which also guards m_fd changes. Appends keep filling a fresh buffer while the
+    // swapped-out one is written.
+    uint64_t frames;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_buffer.empty()) {
+            return true;
+        }
+        m_writing.swap(m_buffer);
+        frames = m_buffered_frames;
+        m_buffered_frames = 0;
+    }
+    bool written = reserve(fd, m_offset + m_writing.size()) &&
+                   writeAll(fd, m_writing.data(), m_writing.size(), m_offset);
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (written) {
+            m_offset += m_writing.size();
+        } else {
+            m_write_failures++;
+            m_frames -= frames;
+            m_dropped += frames;
+        }
+    }
+    m_writing.clear();
+    return written;
+}
+void FrameJournalWriter::flush() {
+    lock_guard<mutex> io_lock(m_io_mutex);
+    if (m_fd >= 0) {
+        write_pending(m_fd);
+    }
+}
+void FrameJournalWriter::close() {
+    lock_guard<mutex> io_lock(m_io_mutex);
+    int fd;
+    {
+        // Stop accepting appends first so nothing lands after the final write.
+        lock_guard<mutex> lock(m_mutex);
+        fd = m_fd;
+        m_fd = -1;
+    }
+    if (fd < 0) {
+        return;
+    }
+    write_pending(fd);
+    uint64_t data_end = m_offset;
+    writeAll(fd, reinterpret_cast<const char*>(&data_end), sizeof(data_end),
+             offsetof(JournalFileHeader, data_end));
+    if (ftruncate(fd, data_end) == 0) {
+        m_allocated = data_end;
+    }
+    ::close(fd);
+}
+bool FrameJournalWriter::is_open() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_fd >= 0;
+}
+string FrameJournalWriter::path() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_path;
+}
+uint64_t FrameJournalWriter::frames_written() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_frames;
+}
+uint64_t FrameJournalWriter::bytes_written() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_offset + m_buffer.size();
+}
+uint64_t FrameJournalWriter::frames_dropped() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_dropped;
+}
+uint64_t FrameJournalWriter::write_failures() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_write_failures;
+}
+FrameJournalReader::FrameJournalReader() : m_data(nullptr), m_size(0), m_end(0), m_cursor(0) {}
+FrameJournalReader::~FrameJournalReader() {
+    close();
+}
+bool FrameJournalReader::open(const string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(JournalFileHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+
+    JournalFileHeader header;
+    memcpy(&header, mapped, sizeof(header));
+    if (memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0 || header.version != JOURNAL_VERSION) {
+        munmap(mapped, info.st_size);
+        return false;
+    }
+    m_data = static_cast<const char*>(mapped);
+    m_size = info.st_size;
+    m_end = header.data_end != 0 && header.data_end <= m_size ? header.data_end : m_size;
+    m_cursor = sizeof(JournalFileHeader);
+    return true;
+}
+void FrameJournalReader::close() {
+    if (m_data) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_end = 0;
+    m_cursor = 0;
+}
+bool FrameJournalReader::next(JournalFrame& frame) {
+    if (!m_data || m_cursor + sizeof(JournalRecordHeader) > m_end) {
+        return false;
+    }
+    JournalRecordHeader record;
+    memcpy(&record, m_data + m_cursor, sizeof(record));
+    if (record.timestamp_ns == 0 && record.length == 0) {
+        return false;
+    }
+    if (m_cursor + sizeof(record) + record.length > m_end) {
+        return false;
+    }
+    frame.timestamp_ns = record.timestamp_ns;
+    frame.connection_id = record.connection_id;
+    frame.direction = static_cast<MessageHistory::Direction>(record.direction);
+    frame.payload = string_view(m_data + m_cursor + sizeof(record), record.length);
+    m_cursor += recordSize(record.length);
+    return true;
+}
+void FrameJournalReader::rewind() {
+    m_cursor = m_data ? sizeof(JournalFileHeader) : 0;
+}
@@ -0,0 +1,137 @@
+#include "network/message_history.h"
+#include <algorithm>
+using namespace std;
+MessageHistory::MessageHistory(size_t capacity)
+    : m_slots(max<size_t>(capacity, 1)), m_head(0), m_count(0), m_evicted(0), m_spill_dropped(0) {}
+MessageHistory::~MessageHistory() {
+    stop_spill();
+}
+void MessageHistory::record(Direction direction, string_view payload) {
+    lock_guard<mutex> lock(m_mutex);
+    size_t slot = (m_head + m_count) % m_slots.size();
+    if (m_count == m_slots.size()) {
+        evict(m_slots[m_head]);
+        m_head = (m_head + 1) % m_slots.size();
+    } else {
+        m_count++;
+    }
+    m_slots[slot].direction = direction;
+    m_slots[slot].payload.assign(payload.data(), payload.size());
+}
+void MessageHistory::evict(Entry& entry) {
+    m_evicted++;
+    if (m_spill_path.empty()) {
+        return;
+    }
+    if (m_spill_buffer.size() + entry.payload.size() + 16 > MAX_SPILL_BYTES) {
+        m_spill_dropped++;
+        return;
+    }
+    m_spill_buffer += entry.direction == SENT ? "SENT: " : "RECEIVED: ";
+    m_spill_buffer += entry.payload;
+    m_spill_buffer += '\n';
+}
+void MessageHistory::write_spill() {
+    // Runs under m_io_mutex; recording keeps filling a fresh buffer meanwhile.
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_spill_writing.swap(m_spill_buffer);
+    }
+    if (!m_spill_writing.empty() && m_spill.is_open()) {
+        m_spill.write(m_spill_writing.data(), static_cast<streamsize>(m_spill_writing.size()));
+        m_spill.flush();
+    }
+    m_spill_writing.clear();
+}
+void MessageHistory::flush_spill() {
+    lock_guard<mutex> io_lock(m_io_mutex);
+    write_spill();
+}
+void MessageHistory::resize(size_t capacity) {
+    lock_guard<mutex> lock(m_mutex);
+    capacity = max<size_t>(capacity, 1);
+    while (m_count > capacity) {
+        evict(m_slots[m_head]);
+        m_head = (m_head + 1) % m_slots.size();
+        m_count--;
+    }
+    vector<Entry> slots(capacity);
+    for (size_t i = 0; i < m_count; ++i) {
+        slots[i] = move(m_slots[(m_head + i) % m_slots.size()]);
+    }
+    m_slots = move(slots);
+    m_head = 0;
+}
+bool MessageHistory::spill_to(const string& path) {
+    lock_guard<mutex> io_lock(m_io_mutex);
+    write_spill();
+    if (m_spill.is_open()) {
+        m_spill.close();
+    }
+    m_spill.open(path, ios::out | ios::app);
+    lock_guard<mutex> lock(m_mutex);
+    m_spill_path = m_spill.is_open() ? path : "";
+    return m_spill.is_open();
+}
+void MessageHistory::stop_spill() {
+    lock_guard<mutex> io_lock(m_io_mutex);
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_spill_path.clear();
+    }
+    write_spill();
+    if (m_spill.is_open()) {
+        m_spill.close();
+    }
+}
+void MessageHistory::clear() {
+    lock_guard<mutex> lock(m_mutex);
+    for (auto& slot : m_slots) {
+        slot.payload.clear();
+    }
+    m_head = 0;
+    m_count = 0;
+}
+void MessageHistory::for_each(const function<void(const Entry&)>& visit) const {
+    lock_guard<mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_count; ++i) {
+        visit(m_slots[(m_head + i) % m_slots.size()]);
+    }
+}
+vector<string> MessageHistory::snapshot() const {
+    vector<string> messages;
+    messages.reserve(size());
+    for_each([&](const Entry& entry) { messages.push_back(format(entry)); });
+    return messages;
+}
+size_t MessageHistory::size() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_count;
+}
+size_t MessageHistory::capacity() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_slots.size();
+}
+size_t MessageHistory::evicted() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_evicted;
+}
+size_t MessageHistory::spill_dropped() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_spill_dropped;
+}
+size_t MessageHistory::memory_usage() const {
+    lock_guard<mutex> lock(m_mutex);
+    size_t bytes = m_slots.capacity() * sizeof(Entry) + m_spill_buffer.capacity();
+    for (const auto& slot : m_slots) {
+        bytes += slot.payload.capacity();
+    }
+    return bytes;
+}
+string MessageHistory::spill_path() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_spill_path;
+}
+string MessageHistory::format(const Entry& entry) {
+    return (entry.direction == SENT ? "SENT: " : "RECEIVED: ") + entry.payload;
+}
@@ -0,0 +1,208 @@
+#include "network/metrics_server.h"
+#include "performance/monitor.h"
+#include "performance/clock_sync.h"
+#include "data_format/symbol_table.h"
+#include <fmt/format.h>
+using namespace std;
+namespace {
+    const char* stage_labels[] = {
+        "order_execution",
+        "market_data_handling",
+        "websocket_communication",
+        "trading_cycle_full",
+        "frame_decode",
+        "book_update"
+    };
+    const char* pipeline_labels[] = {"decode", "dispatch", "notify", "render", "total"};
+    const char* kind_labels[] = {"unknown", "price_index", "ticker", "book", "trades", "user_orders", "user_trades"};
+
+    // Upper bounds in nanoseconds, 1 us to 10 s; the internal log-linear
+    // buckets are folded into these so a scrape stays a few dozen lines.
+    const uint64_t BUCKET_BOUNDS[] = {
+        1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+        1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000, 250000000, 500000000,
+        1000000000, 2500000000ULL, 5000000000ULL, 10000000000ULL
+    };
+
+    string escapeLabel(string_view value) {
+        string escaped;
+        escaped.reserve(value.size());
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+                escaped += c;
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    void appendHeader(string& out, const char* name, const char* type, const char* help) {
+        out += fmt::format("# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+    }
+}
+MetricsServer::MetricsServer(SocketEndpoint& endpoint) : m_endpoint(endpoint), m_port(0) {}
+MetricsServer::~MetricsServer() {
+    stop();
+}
+bool MetricsServer::start(int port, const string& host) {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_server) {
+        m_error = fmt::format("already serving on port {}", m_port);
+        return false;
+    }
+    auto server = make_unique<ix::HttpServer>(port, host);
+    server->setOnConnectionCallback(
+        [this](ix::HttpRequestPtr request, shared_ptr<ix::ConnectionState>) -> ix::HttpResponsePtr {
+            ix::WebSocketHttpHeaders headers;
+            if (request->uri != "/metrics") {
+                headers["Content-Type"] = "text/plain";
+                return make_shared<ix::HttpResponse>(404, "Not Found", ix::HttpErrorCode::Ok, headers, "Not Found\n");
+            }
+            headers["Content-Type"] = "text/plain; version=0.0.4";
+            return make_shared<ix::HttpResponse>(200, "OK", ix::HttpErrorCode::Ok, headers, scrape());
+        });
+    auto listening = server->listen();
+    if (!listening.first) {
+        m_error = listening.second;
+        return false;
+    }
+    server->start();
+    m_server = move(server);
+    m_port = port;
+    m_error.clear();
+    return true;
+}
+void MetricsServer::stop() {
+    unique_ptr<ix::HttpServer> server;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        server = move(m_server);
+    }
+    if (server) {
+        server->stop();
+    }
+}
+bool MetricsServer::running() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_server != nullptr;
+}
+int MetricsServer::port() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_port;
+}
+string MetricsServer::error() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_error;
+}
+void MetricsServer::append_histogram(string& out, const string& name, const string& labels,
+                                     const LatencyHistogram::Snapshot& snapshot) {
+    string prefix = labels.empty() ? "" : labels + ",";
+    uint64_t cumulative = 0;
+    size_t bucket = 0;
+    for (uint64_t bound : BUCKET_BOUNDS) {
+        // A bucket counts toward a bound only once all of it lies below it.
+        while (bucket < LatencyHistogram::BUCKETS &&
+               LatencyHistogram::bucket_floor(bucket) + LatencyHistogram::bucket_width(bucket) <= bound) {
+            cumulative += snapshot.counts[bucket++];
+        }
+        out += fmt::format("{}_bucket{{{}le=\"{:g}\"}} {}\n", name, prefix, bound / 1e9, cumulative);
+    }
+    // Count from the buckets so +Inf always matches them even if a
+    // recorder was mid-update while the snapshot was taken.
+    for (; bucket < LatencyHistogram::BUCKETS; ++bucket) {
+        cumulative += snapshot.counts[bucket];
+    }
+    string braces = labels.empty() ? "" : "{" + labels + "}";
+    out += fmt::format("{}_bucket{{{}le=\"+Inf\"}} {}\n", name, prefix, cumulative);
+    out += fmt::format("{}_sum{} {:.9f}\n", name, braces, snapshot.sum / 1e9);
+    out += fmt::format("{}_count{} {}\n", name, braces, cumulative);
+}
+string MetricsServer::scrape() const {
+    PerformanceMonitor& monitor = getPerformanceMonitor();
+    string out;
+
+    appendHeader(out, "deribit_stage_latency_seconds", "histogram", "Latency of instrumented client stages.");
+    for (size_t type = 0; type < PerformanceMonitor::MEASUREMENT_TYPES; ++type) {
+        append_histogram(out, "deribit_stage_latency_seconds", fmt::format("stage=\"{}\"", stage_labels[type]),
+                         monitor.snapshot(static_cast<PerformanceMonitor::MeasurementType>(type)));
+    }
+
+    appendHeader(out, "deribit_pipeline_latency_seconds", "histogram",
+                 "Market-data pipeline latency per stage and channel type.");
+    for (size_t kind = 0; kind < PerformanceMonitor::CHANNEL_KINDS; ++kind) {
+        for (size_t stage = 0; stage < PerformanceMonitor::PIPELINE_STAGES; ++stage) {
+            LatencyHistogram::Snapshot snapshot = monitor.stage_snapshot(
+                static_cast<PerformanceMonitor::PipelineStage>(stage), static_cast<ChannelKind>(kind));
+            if (snapshot.empty()) continue;
+            append_histogram(out, "deribit_pipeline_latency_seconds",
+                             fmt::format("stage=\"{}\",channel_type=\"{}\"", pipeline_labels[stage], kind_labels[kind]),
+                             snapshot);
+        }
+    }
+
+    appendHeader(out, "deribit_exchange_latency_seconds", "histogram",
+                 "Exchange timestamp to local receive, corrected for clock offset.");
+    for (uint32_t channel_id : monitor.channels()) {
+        append_histogram(out, "deribit_exchange_latency_seconds",
+                         fmt::format("channel=\"{}\"", escapeLabel(getSymbolTable().name(channel_id))),
+                         monitor.channel_snapshot(channel_id));
+    }
+
+    const ClockSync& clock = getClockSync();
+    if (clock.synchronized()) {
+        appendHeader(out, "deribit_clock_offset_seconds", "gauge", "Exchange clock minus local wall clock.");
+        out += fmt::format("deribit_clock_offset_seconds {:.6f}\n", clock.offset_us() / 1e6);
+        appendHeader(out, "deribit_clock_sync_rtt_seconds", "gauge", "Round trip of the clock sample in use.");
+        out += fmt::format("deribit_clock_sync_rtt_seconds {:.6f}\n", clock.rtt_us() / 1e6);
+    }
+
+    struct ConnectionMetrics {
+        string labels;
+        ConnectionDetails::ptr connection;
+        ConnectionDetails::TrafficStats traffic;
+    };
+    vector<ConnectionMetrics> connections;
+    for (const auto& connection : m_endpoint.connections()) {
+        connections.push_back({fmt::format("connection=\"{}\",uri=\"{}\"", connection->get_id(),
+                                           escapeLabel(connection->get_uri())),
+                               connection, connection->traffic()});
+    }
+    auto counter = [&](const char* name, const char* type, const char* help, auto value) {
+        appendHeader(out, name, type, help);
+        for (const auto& metrics : connections) {
+            out += fmt::format("{}{{{}}} {}\n", name, metrics.labels, value(metrics));
+        }
+    };
+    counter("deribit_connection_up", "gauge", "1 while the WebSocket is connected.",
+            [](const ConnectionMetrics& m) { return m.connection->connected() ? 1 : 0; });
+    counter("deribit_messages_received_total", "counter", "WebSocket messages received.",
+            [](const ConnectionMetrics& m) { return m.traffic.messages_received; });
+    counter("deribit_received_bytes_total", "counter", "WebSocket payload bytes received.",
+            [](const ConnectionMetrics& m) { return m.traffic.bytes_received; });
+    counter("deribit_messages_sent_total", "counter", "WebSocket messages sent.",
+            [](const ConnectionMetrics& m) { return m.traffic.messages_sent; });
+    counter("deribit_sent_bytes_total", "counter", "WebSocket payload bytes sent.",
+            [](const ConnectionMetrics& m) { return m.traffic.bytes_sent; });
+    counter("deribit_reconnects_total", "counter", "Times the WebSocket reopened after the first connect.",
+            [](const ConnectionMetrics& m) { return m.traffic.reconnects; });
+    counter("deribit_request_timeouts_total", "counter", "JSON-RPC requests that expired without a response.",
+            [](const ConnectionMetrics& m) { return m.traffic.request_timeouts; });
+    counter("deribit_pending_requests", "gauge", "JSON-RPC requests awaiting a response.",
+            [](const ConnectionMetrics& m) { return m.connection->pending_requests(); });
+    counter("deribit_dropped_events_total", "counter", "Stream events dropped because the consumer ring was full.",
+            [](const ConnectionMetrics& m) { return m.connection->dropped_events(); });
+    counter("deribit_book_resyncs_total", "counter", "Order book resnapshots after a sequence gap.",
+            [](const ConnectionMetrics& m) { return m.connection->book_resyncs(); });
+
+    appendHeader(out, "deribit_request_rtt_seconds", "histogram", "JSON-RPC request to response round trip.");
+    for (const auto& metrics : connections) {
+        LatencyHistogram::Snapshot rtt;
+        metrics.connection->request_rtt(rtt);
+        append_histogram(out, "deribit_request_rtt_seconds", metrics.labels, rtt);
+    }
+    return out;
+}
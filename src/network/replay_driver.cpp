@@ -0,0 +1,55 @@
+#include "network/replay_driver.h"
+#include <algorithm>
+#include <thread>
+using namespace std;
+double ReplayDriver::Stats::frames_per_second() const {
+    return elapsed.count() > 0 ? frames_replayed * 1e9 / elapsed.count() : 0.0;
+}
+double ReplayDriver::Stats::megabytes_per_second() const {
+    return elapsed.count() > 0 ? bytes_replayed * 1e9 / elapsed.count() / (1024.0 * 1024.0) : 0.0;
+}
+chrono::nanoseconds ReplayDriver::Stats::average_handler_time() const {
+    return frames_replayed > 0 ? chrono::nanoseconds(handler_time.count() / static_cast<int64_t>(frames_replayed))
+                               : chrono::nanoseconds(0);
+}
+ReplayDriver::ReplayDriver(ConnectionDetails& target) : m_target(target) {}
+bool ReplayDriver::open(const string& path) {
+    return m_reader.open(path);
+}
+ReplayDriver::Stats ReplayDriver::run(Pace pace) {
+    Stats stats;
+    if (!m_reader.is_open()) {
+        return stats;
+    }
+    m_reader.rewind();
+
+    JournalFrame frame;
+    int64_t first_timestamp = -1;
+    int64_t last_timestamp = 0;
+    auto started = chrono::steady_clock::now();
+    while (m_reader.next(frame)) {
+        if (frame.direction != MessageHistory::RECEIVED) {
+            stats.frames_skipped++;
+            continue;
+        }
+        if (first_timestamp < 0) {
+            first_timestamp = frame.timestamp_ns;
+        }
+        last_timestamp = frame.timestamp_ns;
+        if (pace == REALTIME) {
+            this_thread::sleep_until(started + chrono::nanoseconds(frame.timestamp_ns - first_timestamp));
+        }
+
+        auto handler_start = chrono::steady_clock::now();
+        m_target.handle_message(frame.payload, frame.timestamp_ns / 1000);
+        auto handler_elapsed = chrono::steady_clock::now() - handler_start;
+
+        stats.handler_time += handler_elapsed;
+        stats.max_handler_time = max(stats.max_handler_time, chrono::duration_cast<chrono::nanoseconds>(handler_elapsed));
+        stats.frames_replayed++;
+        stats.bytes_replayed += frame.payload.size();
+    }
+    stats.elapsed = chrono::steady_clock::now() - started;
+    stats.recorded_span = chrono::nanoseconds(first_timestamp < 0 ? 0 : last_timestamp - first_timestamp);
+    return stats;
+}
@@ -0,0 +1,66 @@
+#include "network/request_registry.h"
+using namespace std;
+void RequestRegistry::register_request(long request_id, const string& method, CompletionHandler handler,
+                                       chrono::milliseconds timeout, TimeoutHandler on_timeout,
+                                       FailureHandler on_failure) {
+    PendingRequest request;
+    request.method = method;
+    request.sent_at = chrono::steady_clock::now();
+    request.deadline = request.sent_at + timeout;
+    request.on_complete = move(handler);
+    request.on_timeout = move(on_timeout);
+    request.on_failure = move(on_failure);
+    lock_guard<mutex> lock(registry_mutex);
+    pending_requests[request_id] = move(request);
+}
+bool RequestRegistry::complete(long request_id, PendingRequest& request) {
+    lock_guard<mutex> lock(registry_mutex);
+    auto it = pending_requests.find(request_id);
+    if (it == pending_requests.end()) {
+        return false;
+    }
+    request = move(it->second);
+    pending_requests.erase(it);
+    return true;
+}
+size_t RequestRegistry::expire(chrono::steady_clock::time_point now) {
+    vector<PendingRequest> expired;
+    {
+        lock_guard<mutex> lock(registry_mutex);
+        for (auto it = pending_requests.begin(); it != pending_requests.end();) {
+            if (it->second.deadline <= now) {
+                expired.push_back(move(it->second));
+                it = pending_requests.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& request : expired) {
+        if (request.on_timeout) {
+            request.on_timeout(request.method);
+        }
+    }
+    return expired.size();
+}
+size_t RequestRegistry::fail_all(const exception_ptr& error) {
+    unordered_map<long, PendingRequest> failed;
+    {
+        lock_guard<mutex> lock(registry_mutex);
+        failed.swap(pending_requests);
+    }
+    for (auto& entry : failed) {
+        if (entry.second.on_failure) {
+            entry.second.on_failure(error);
+        }
+    }
+    return failed.size();
+}
+size_t RequestRegistry::pending_count() {
+    lock_guard<mutex> lock(registry_mutex);
+    return pending_requests.size();
+}
+void RequestRegistry::clear() {
+    lock_guard<mutex> lock(registry_mutex);
+    pending_requests.clear();
+}
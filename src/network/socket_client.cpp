@@ -3,28 +3,215 @@
 #include "security/credentials.h"
 #include <fmt/color.h>
 #include "performance/monitor.h"
+#include "performance/scoped_probe.h"
+#include "performance/clock_sync.h"
+#include "performance/flight_recorder.h"
+#include "exchange_interface/market_api.h"
+#include "helpers/stream_renderer.h"
+#include "market_data/order_book.h"
+#include "market_data/instrument_registry.h"
+#include "network/subscription_manager.h"
 #include <termios.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <unordered_map>
 
 using namespace std;
 
-bool isDataStreaming = false;
 extern bool AUTHENTICATION_SENT;
 
+namespace {
+    typedef RequestRegistry::CompletionHandler CompletionHandler;
+    typedef function<CompletionHandler(const json&)> HandlerFactory;
+
+    CompletionHandler orderConfirmation(const string& title, const string& message, fmt::rgb color) {
+        return [=](const json& response) {
+            if (!response.contains("result") || !response["result"].contains("order_id")) {
+                return;
+            }
+            string order_id = response["result"]["order_id"];
+            string order_state = response["result"]["order_state"];
+
+            vector<pair<string, string>> content = {
+                {"Order ID", order_id},
+                {"Order State", order_state},
+                {"", ""},
+                {"Message", message}
+            };
+
+            utils::displayBox(title, content, color, "✅");
+        };
+    }
+
+    CompletionHandler cancellationConfirmation(const string& title, const string& message) {
+        return [=](const json& response) {
+            if (!response.contains("result")) {
+                return;
+            }
+            vector<pair<string, string>> content = {
+                {"", ""},
+                {"Message", message}
+            };
+
+            utils::displayBox(title, content, fmt::rgb(255, 99, 71), "✅");
+        };
+    }
+
+    void reportRequestError(const string& method, const json& response) {
+        string error_message = response["error"].value("message", "Unknown error");
+        cout << "ERROR: API request failed: " << error_message << endl;
+
+        vector<pair<string, string>> errorContent = {
+            {"Status", "Failed"},
+            {"Method", method},
+            {"Error", error_message},
+            {"Code", to_string(response["error"].value("code", 0))},
+            {"", ""},
+            {"Message", "Please check your request parameters and try again"}
+        };
+
+        utils::displayBox("API REQUEST FAILED", errorContent,
+                        fmt::rgb(255, 69, 0), "❌");
+    }
+
+    const unordered_map<string, HandlerFactory>& responseHandlers() {
+        static const unordered_map<string, HandlerFactory> handlers = [] {
+            unordered_map<string, HandlerFactory> table;
+
+            table["public/auth"] = [](const json&) -> CompletionHandler {
+                return [](const json& response) {
+                    if (response.contains("result") && response["result"].contains("access_token")) {
+                        string access_token = response["result"]["access_token"];
+                        cout << "DEBUG: Received access token from server" << endl;
+
+                        Credentials::password().setAccessToken(access_token);
+
+                        vector<pair<string, string>> content = {
+                            {"Status", "Success"},
+                            {"", ""},
+                            {"Message", "Access token received and stored securely"}
+                        };
+
+                        utils::displayBox("AUTHENTICATION SUCCESSFUL", content,
+                                        fmt::rgb(0, 205, 102), "🔐");
+                    }
+                    AUTHENTICATION_SENT = false;
+                };
+            };
+
+            table["public/get_order_book"] = [](const json& request) -> CompletionHandler {
+                if (!request.contains("params") || !request["params"].contains("instrument_name")) {
+                    return nullptr;
+                }
+                string instrument = request["params"]["instrument_name"];
+                int depth = request["params"].value("depth", 10);
+                return [instrument, depth](const json& response) {
+                    utils::printOrderbook(instrument, response, depth);
+                };
+            };
+
+            table["public/get_instruments"] = [](const json&) -> CompletionHandler {
+                return [](const json& response) {
+                    InstrumentRegistry& registry = getInstrumentRegistry();
+                    size_t loaded = registry.load(response.value("result", json::array()));
+                    registry.schedule_save(InstrumentRegistry::DEFAULT_CACHE_PATH);
+                    vector<pair<string, string>> content = {
+                        {"Instruments Loaded", to_string(loaded)},
+                        {"Registry Size", to_string(registry.size())},
+                        {"", ""},
+                        {"Cache", string("Saving to ") + InstrumentRegistry::DEFAULT_CACHE_PATH}
+                    };
+                    utils::displayBox("INSTRUMENTS LOADED", content, fmt::rgb(0, 255, 127), "🗃️");
+                };
+            };
+
+            HandlerFactory positions = [](const json&) -> CompletionHandler {
+                return [](const json& response) { utils::printPositions(response); };
+            };
+            table["private/get_positions"] = positions;
+
+            HandlerFactory open_orders = [](const json&) -> CompletionHandler {
+                return [](const json& response) { utils::printOpenOrders(response); };
+            };
+            table["private/get_open_orders"] = open_orders;
+            table["private/get_open_orders_by_instrument"] = open_orders;
+            table["private/get_open_orders_by_currency"] = open_orders;
+            table["private/get_open_orders_by_label"] = open_orders;
+
+            table["private/buy"] = [](const json&) {
+                return orderConfirmation("BUY ORDER CONFIRMED",
+                                         "Order has been successfully placed", fmt::rgb(0, 255, 127));
+            };
+            table["private/sell"] = [](const json&) {
+                return orderConfirmation("SELL ORDER CONFIRMED",
+                                         "Order has been successfully placed", fmt::rgb(255, 69, 0));
+            };
+            table["private/edit"] = [](const json&) {
+                return orderConfirmation("ORDER MODIFICATION CONFIRMED",
+                                         "Order has been successfully modified", fmt::rgb(255, 215, 0));
+            };
+
+            table["private/cancel"] = [](const json&) {
+                return cancellationConfirmation("ORDER CANCELLATION CONFIRMED",
+                                                "Order has been successfully cancelled");
+            };
+            HandlerFactory cancel_many = [](const json&) {
+                return cancellationConfirmation("ORDERS CANCELLATION CONFIRMED",
+                                                "Orders have been successfully cancelled");
+            };
+            table["private/cancel_all"] = cancel_many;
+            table["private/cancel_all_by_instrument"] = cancel_many;
+            table["private/cancel_all_by_currency"] = cancel_many;
+            table["private/cancel_by_label"] = cancel_many;
+
+            return table;
+        }();
+        return handlers;
+    }
+
+    // The exchange answers (un)subscribe with the channels it applied; a failed
+    // request (reply == nullptr) or an error reply applied none of them.
+    void settleSubscription(bool unsubscribing, int connection_id, const vector<string>& channels,
+                            const json* reply) {
+        vector<string> confirmed;
+        if (reply != nullptr && reply->contains("result") && (*reply)["result"].is_array()) {
+            for (const json& entry : (*reply)["result"]) {
+                if (entry.is_string()) confirmed.push_back(entry.get<string>());
+            }
+        }
+        getSubscriptionManager().settle(unsubscribing, connection_id, channels, confirmed);
+        if (!unsubscribing) {
+            return;
+        }
+        // Local books are only trustworthy while their feed is subscribed.
+        for (const string& channel : confirmed) {
+            if (market_data::classifyChannel(channel) != ChannelKind::Book) continue;
+            string instrument(SubscriptionManager::instrument_of(channel));
+            if (getSubscriptionManager().book_channel(instrument).empty()) {
+                getOrderBookManager().remove(instrument);
+            }
+        }
+    }
+}
+
 ConnectionDetails::ConnectionDetails(
     int id,
     string uri,
-    SocketEndpoint* endpoint
+    SocketEndpoint* endpoint,
+    OrderBookManager* books,
+    PerformanceMonitor* monitor,
+    FlightRecorder* flight
 ) :
     m_connection_id(id),
-    m_connection_status("Connecting"),
+    m_state(CONNECTING),
     m_endpoint_uri(uri),
     m_server_info("N/A"),
-    m_received_data({}),
-    m_transaction_logs({}),
+    m_message_history(1024),
+    m_transaction_logs(1024),
     m_endpoint_controller(endpoint),
-    DATA_PROCESSED(false),
+    m_books(books ? *books : getOrderBookManager()),
+    m_monitor(monitor ? *monitor : getPerformanceMonitor()),
+    m_flight(flight ? *flight : getFlightRecorder()),
     m_webSocketClient(std::make_unique<ix::WebSocket>())
 {
     setup_websocket();
@@ -34,6 +221,7 @@ ConnectionDetails::~ConnectionDetails() {
     if (m_webSocketClient) {
         m_webSocketClient->stop();
     }
+    stop_capture();
 }
 
 void ConnectionDetails::setup_websocket() {
@@ -42,450 +230,458 @@ void ConnectionDetails::setup_websocket() {
 
     m_webSocketClient->setOnMessageCallback([this](const ix::WebSocketMessagePtr& msg) {
         if (msg->type == ix::WebSocketMessageType::Message) {
+            m_messages_received.fetch_add(1, memory_order_relaxed);
+            m_bytes_received.fetch_add(msg->str.size(), memory_order_relaxed);
+            if (auto journal = atomic_load(&m_journal)) {
+                journal->append(MessageHistory::RECEIVED, m_connection_id, msg->str);
+            }
+            handle_message(msg->str);
+        }
+        else if (msg->type == ix::WebSocketMessageType::Open) {
+            m_state.store(CONNECTED, memory_order_release);
+            m_server_info = "IXWebSocket";
+            uint64_t opens = m_opens.fetch_add(1, memory_order_relaxed) + 1;
+            FlightRecorder& flight = m_flight;
+            flight.record(FlightRecorder::CONNECTION_OPEN, m_connection_id, 0, opens);
+            if (opens > 1) {
+                flight.record(FlightRecorder::RECONNECT, m_connection_id, 0, opens - 1);
+                flight.trigger(FlightRecorder::TRIGGER_RECONNECT);
+            }
+            sync_clock();
+            restore_subscriptions();
+        }
+        else if (msg->type == ix::WebSocketMessageType::Error) {
+            m_state.store(CONNECTION_ERROR, memory_order_release);
 
-            getPerformanceMonitor().start_measurement(
-                PerformanceMonitor::WEBSOCKET_COMMUNICATION,
-                "websocket_message_" + to_string(m_connection_id)
-            );
-
-            try {
-                string payload = msg->str;
-
-                json received_json;
-                try {
-                    received_json = json::parse(payload);
-                } catch (const json::parse_error& e) {
-                    cerr << "JSON parse error: " << e.what() << endl;
-                    cerr << "Problematic payload: " << payload << endl;
-                    return;
-                }
-
-                if (received_json.contains("method")) {
-                    string method = received_json.value("method", "");
-
-                    if (method == "subscription" && isDataStreaming) {
-                        auto params = received_json.value("params", json{});
-                        auto data = params.value("data", json{});
-
-                        if (!data.is_null() && data.is_object()) {
-
-                            static vector<double> priceHistory;
-                            static string currentInstrument = "";
-                            static double previousPrice = 0.0;
-                            static double highPrice = 0.0;
-                            static double lowPrice = std::numeric_limits<double>::max();
-                            static double openPrice = 0.0;
-                            static int updateCount = 0;
-
-                            utils::clear_console();
-
-
-                            int terminal_width = utils::getTerminalWidth();
-                            string separator(terminal_width, '-');
-                            string thin_separator(terminal_width, '.');
+            m_error_message = msg->errorInfo.reason;
+            m_flight.record(FlightRecorder::CONNECTION_ERROR, m_connection_id, 0,
+                                       msg->errorInfo.http_status, FlightRecorder::NO_CHANNEL, msg->errorInfo.reason);
+            stringstream ss;
+            ss << "Error: " << msg->errorInfo.reason;
+            if (msg->errorInfo.http_status != 0) {
+                ss << " HTTP Status: " << msg->errorInfo.http_status;
+            }
 
+            cerr << ss.str() << endl;
+            fail_pending_requests(msg->errorInfo.reason);
+            unsync_books();
+        }
+        else if (msg->type == ix::WebSocketMessageType::Close) {
+            m_state.store(CLOSED, memory_order_release);
+            m_flight.record(FlightRecorder::CONNECTION_CLOSED, m_connection_id, 0,
+                                       msg->closeInfo.code, FlightRecorder::NO_CHANNEL, msg->closeInfo.reason);
+            stringstream ss;
+            ss << "Close code: " << msg->closeInfo.code << ", reason: " << msg->closeInfo.reason;
+            m_error_message = ss.str();
+            fail_pending_requests(msg->closeInfo.reason.empty() ? "code " + to_string(msg->closeInfo.code)
+                                                                : msg->closeInfo.reason);
+            unsync_books();
+        }
+    });
+}
 
-                            fmt::print(fg(fmt::rgb(0, 120, 212)) | bg(fmt::rgb(20, 20, 30)) | fmt::emphasis::bold,
-                                "{:^{}}\n", "💹 LIVE MARKET DATA STREAM", terminal_width);
-                            fmt::print(fg(fmt::rgb(100, 100, 120)), "{}\n", separator);
+void ConnectionDetails::handle_message(string_view payload, int64_t received_us) {
+    DERIBIT_PROBE_ON(m_monitor, WEBSOCKET_COMMUNICATION);
+    uint64_t started = CycleClock::now();
+#if DERIBIT_INSTRUMENTATION
+    m_trace.received = started;
+#endif
+    uint32_t channel = FlightRecorder::NO_CHANNEL;
+    m_received_us = received_us != 0 ? received_us : ClockSync::wall_clock_us();
+
+    try {
+        bool decoded;
+        {
+            DERIBIT_PROBE_ON(m_monitor, FRAME_DECODE);
+            decoded = market_data::decodeSubscription(payload, m_market_frame);
+        }
+        if (decoded) {
+            m_trace.decoded = DERIBIT_TRACE_STAMP();
+            channel = m_market_frame.channel_id;
+            m_flight.record(FlightRecorder::FRAME_DECODED, m_connection_id,
+                                       m_market_frame.kind == ChannelKind::Book ? m_market_frame.book.change_id : 0,
+                                       payload.size(), channel);
+            record_exchange_latency();
+            bool queued = false;
+            switch (m_market_frame.kind) {
+                case ChannelKind::PriceIndex:
+                case ChannelKind::Ticker:
+                case ChannelKind::Trades:
+                    if (streaming()) {
+                        publish_market_events();
+                        queued = true;
+                    } else {
+                        m_message_history.record(MessageHistory::RECEIVED, payload);
+                    }
+                    break;
+                case ChannelKind::Book: {
+                    DERIBIT_PROBE_ON(m_monitor, BOOK_UPDATE);
+                    if (m_books.apply(m_market_frame) == OrderBook::SEQUENCE_GAP) {
+                        m_flight.record(FlightRecorder::SEQUENCE_GAP, m_connection_id,
+                                                   m_market_frame.book.change_id, m_market_frame.book.prev_change_id,
+                                                   channel);
+                        m_flight.trigger(FlightRecorder::TRIGGER_SEQUENCE_GAP);
+                        resnapshot_book(string(m_market_frame.channel.view()));
+                    }
+                    break;
+                }
+                case ChannelKind::UserOrders:
+                case ChannelKind::UserTrades:
+                    record_private_updates();
+                    break;
+                default:
+                    if (!streaming()) {
+                        m_message_history.record(MessageHistory::RECEIVED, payload);
+                    }
+                    break;
+            }
+            record_pipeline(queued);
+        } else {
+            json received_json;
+            bool parsed = true;
+            try {
+                received_json = json::parse(payload);
+            } catch (const json::parse_error& e) {
+                cerr << "JSON parse error: " << e.what() << endl;
+                m_flight.record(FlightRecorder::PARSE_ERROR, m_connection_id, 0, payload.size(),
+                                           FlightRecorder::NO_CHANNEL, payload);
+                m_flight.trigger(FlightRecorder::TRIGGER_PARSE_ERROR);
+                cerr << "Problematic payload: " << payload << endl;
+                parsed = false;
+            }
 
-                            if (data.contains("price") && data["price"].is_number() &&
-                                data.contains("timestamp") && data["timestamp"].is_number() &&
-                                data.contains("index_name") && data["index_name"].is_string()) {
+            if (parsed) {
+                bool clock_sync = received_json.contains("id") && received_json["id"].is_number_integer() &&
+                                  received_json["id"].get<long>() == m_clock_sync_request.load();
+                if (!streaming() && !clock_sync) {
+                    m_message_history.record(MessageHistory::RECEIVED, payload);
+                    record_summary(string(payload), "RECEIVED");
+                }
 
-                                double price = data["price"];
-                                int64_t timestamp = data["timestamp"];
-                                string index_name = data["index_name"];
+                dispatch_response(received_json);
+            }
+        }
+    }
+    catch (const exception& e) {
+        cerr << "Error processing message: " << e.what() << endl;
+        m_flight.record(FlightRecorder::PARSE_ERROR, m_connection_id, 0, payload.size(), channel, e.what());
+        m_flight.trigger(FlightRecorder::TRIGGER_PARSE_ERROR);
+    }
 
+    uint64_t elapsed = CycleClock::elapsed_nanos(started, CycleClock::now());
+    FlightRecorder& flight = m_flight;
+    if (flight.is_slow(elapsed)) {
+        flight.record(FlightRecorder::SLOW_CALLBACK, m_connection_id, 0, elapsed, channel);
+        flight.trigger(FlightRecorder::TRIGGER_SLOW_CALLBACK);
+    }
+}
 
-                                if (currentInstrument != index_name) {
-                                    currentInstrument = index_name;
-                                    priceHistory.clear();
-                                    previousPrice = price;
-                                    highPrice = price;
-                                    lowPrice = price;
-                                    openPrice = price;
-                                    updateCount = 0;
-                                }
+void ConnectionDetails::publish_market_events() {
+    MarketEvent event;
+    event.kind = m_market_frame.kind;
+    event.connection_id = m_connection_id;
+    event.trace = m_trace;
+    event.trace.published = DERIBIT_TRACE_STAMP();
+    auto push = [&]() {
+        if (!m_market_events.try_push(event)) {
+            m_dropped_events.fetch_add(1, memory_order_relaxed);
+        }
+    };
+    if (event.kind == ChannelKind::PriceIndex) {
+        event.index = m_market_frame.index;
+        push();
+    } else if (event.kind == ChannelKind::Ticker) {
+        event.ticker = m_market_frame.ticker;
+        push();
+    } else {
+        for (const TradeUpdate& trade : m_market_frame.trades) {
+            event.trade = trade;
+            push();
+        }
+    }
+}
 
+void ConnectionDetails::record_private_updates() {
+    for (const OrderUpdate& order : m_market_frame.orders) {
+        m_transaction_logs.record(MessageHistory::RECEIVED, fmt::format(
+            "order {} {} {} {} {} @ {} filled {}", order.order_id.view(), order.order_state.view(),
+            order.direction == Side::Buy ? "buy" : "sell", order.instrument_name.view(),
+            order.amount, order.price, order.filled_amount));
+    }
+    if (m_market_frame.kind != ChannelKind::UserTrades) return;
+    for (const TradeUpdate& trade : m_market_frame.trades) {
+        m_transaction_logs.record(MessageHistory::RECEIVED, fmt::format(
+            "trade {} order {} {} {} {} @ {}", trade.trade_id.view(), trade.order_id.view(),
+            trade.direction == Side::Buy ? "buy" : "sell", trade.instrument_name.view(),
+            trade.amount, trade.price));
+    }
+}
 
-                                updateCount++;
-                                highPrice = max(highPrice, price);
-                                lowPrice = min(lowPrice, price);
-                                if (priceHistory.size() >= 30) priceHistory.erase(priceHistory.begin());
-                                priceHistory.push_back(price);
+void ConnectionDetails::record_pipeline(bool queued) {
+    // Queued events finish their trace on the consumer; the rest end here.
+    uint64_t dispatched = DERIBIT_TRACE_STAMP();
+    ChannelKind kind = m_market_frame.kind;
+    m_monitor.record_stage(PerformanceMonitor::STAGE_DECODE, kind, m_trace.received, m_trace.decoded);
+    m_monitor.record_stage(PerformanceMonitor::STAGE_DISPATCH, kind, m_trace.decoded, dispatched);
+    if (!queued) {
+        m_monitor.record_stage(PerformanceMonitor::STAGE_TOTAL, kind, m_trace.received, dispatched);
+    }
+}
 
+void ConnectionDetails::record_exchange_latency() {
+    const ClockSync& clock = getClockSync();
+    if (!clock.synchronized()) return;
+    int64_t exchange_ms = 0;
+    switch (m_market_frame.kind) {
+        case ChannelKind::PriceIndex:
+            exchange_ms = m_market_frame.index.timestamp;
+            break;
+        case ChannelKind::Ticker:
+            exchange_ms = m_market_frame.ticker.timestamp;
+            break;
+        case ChannelKind::Book:
+            exchange_ms = m_market_frame.book.timestamp;
+            break;
+        case ChannelKind::Trades:
+        case ChannelKind::UserTrades:
+            // A batch is published after its newest trade.
+            for (const TradeUpdate& trade : m_market_frame.trades) {
+                exchange_ms = max(exchange_ms, trade.timestamp);
+            }
+            break;
+        case ChannelKind::UserOrders:
+            for (const OrderUpdate& order : m_market_frame.orders) {
+                exchange_ms = max(exchange_ms, order.timestamp);
+            }
+            break;
+        default:
+            break;
+    }
+    if (exchange_ms <= 0) return;
+    m_monitor.record_channel(m_market_frame.channel_id,
+        chrono::microseconds(clock.exchange_to_local_us(exchange_ms, m_received_us)));
+}
 
-                                double priceChange = price - previousPrice;
-                                double percentChange = previousPrice != 0 ? (priceChange / previousPrice) * 100 : 0;
+void ConnectionDetails::restore_subscriptions() {
+    // Channels outlive a dropped socket. The new socket is unauthenticated,
+    // so public channels go out at once and private ones wait for auth.
+    vector<string> public_channels;
+    vector<string> private_channels;
+    for (string& channel : getSubscriptionManager().channels_for(m_connection_id)) {
+        (SubscriptionManager::is_private(channel) ? private_channels : public_channels).push_back(move(channel));
+    }
+    if (!public_channels.empty()) {
+        send(SubscriptionManager::subscribe_request(public_channels));
+    }
+    if (private_channels.empty()) {
+        return;
+    }
+    shared_ptr<const json> auth = atomic_load(&m_auth_request);
+    if (!auth) {
+        cerr << "> Connection " << m_connection_id << " reopened without credentials; "
+             << private_channels.size() << " private channel(s) not restored" << endl;
+        return;
+    }
+    jsonrpc_request request("public/auth");
+    request["params"] = (*auth)["params"];
+    send_request(request.dump(), [this, private_channels](const json& response) {
+        if (response.contains("result") && response["result"].contains("access_token")) {
+            send(SubscriptionManager::subscribe_request(private_channels));
+        }
+    }, nullptr);
+}
 
+void ConnectionDetails::resnapshot_book(const string& channel) {
+    // A replay target has no socket; its book simply waits for the next snapshot.
+    if (!m_webSocketClient || !connected()) {
+        return;
+    }
+    m_book_resyncs.fetch_add(1, memory_order_relaxed);
+    send(SubscriptionManager::unsubscribe_request({channel}));
+    send(SubscriptionManager::subscribe_request({channel}));
+}
 
-                                time_t t = timestamp / 1000;
-                                char time_buf[64];
-                                strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", localtime(&t));
+// Deltas missed while the socket is down leave the books behind; they stay
+// unsynced until the resubscription after reconnect delivers a new snapshot.
+void ConnectionDetails::unsync_books() {
+    for (const string& channel : getSubscriptionManager().channels_for(m_connection_id)) {
+        if (market_data::classifyChannel(channel) == ChannelKind::Book) {
+            m_books.unsync(string(SubscriptionManager::instrument_of(channel)));
+        }
+    }
+}
 
+int ConnectionDetails::get_id() { return m_connection_id; }
+const char* ConnectionDetails::state_name(State state) {
+    switch (state) {
+        case CONNECTING: return "Connecting";
+        case CONNECTED: return "Connected";
+        case CONNECTION_ERROR: return "Error";
+        case CLOSED: return "Closed";
+    }
+    return "Unknown";
+}
 
-                                fmt::print(fg(fmt::rgb(255, 255, 255)) | bg(fmt::rgb(40, 44, 52)) | fmt::emphasis::bold,
-                                    " 🎯 Instrument: ");
-                                fmt::print(fg(fmt::rgb(255, 215, 0)) | bg(fmt::rgb(40, 44, 52)) | fmt::emphasis::bold,
-                                    "{:<30} ", index_name);
-                                fmt::print(fg(fmt::rgb(255, 255, 255)) | bg(fmt::rgb(40, 44, 52)) | fmt::emphasis::bold,
-                                    "⏰ Time: ");
-                                fmt::print(fg(fmt::rgb(120, 200, 255)) | bg(fmt::rgb(40, 44, 52)),
-                                    "{}\n", time_buf);
-                                fmt::print(fg(fmt::rgb(100, 100, 120)), "{}\n", thin_separator);
-
-
-                                fmt::print(fg(fmt::rgb(255, 255, 255)) | fmt::emphasis::bold,
-                                    " 💰 PRICE: ");
-
-                                auto priceColor = priceChange >= 0 ?
-                                                fmt::rgb(0, 255, 127) :
-                                                fmt::rgb(255, 69, 0);
-
-                                fmt::print(fg(priceColor) | fmt::emphasis::bold,
-                                    "${:.2f} ", price);
-
-
-                                string changeArrow = priceChange >= 0 ? "▲" : "▼";
-                                fmt::print(fg(priceColor) | fmt::emphasis::bold,
-                                    "{} ${:.2f} ({:.2f}%)\n",
-                                    changeArrow, fabs(priceChange), percentChange);
-
-
-                                fmt::print(fg(fmt::rgb(255, 255, 255)) | fmt::emphasis::bold,
-                                    " 📊 STATS: ");
-                                fmt::print(fg(fmt::rgb(200, 200, 200)),
-                                    "Open: ");
-                                fmt::print(fg(fmt::rgb(100, 200, 255)) | fmt::emphasis::bold,
-                                    "${:.2f} ", openPrice);
-                                fmt::print(fg(fmt::rgb(200, 200, 200)),
-                                    "High: ");
-                                fmt::print(fg(fmt::rgb(0, 255, 127)) | fmt::emphasis::bold,
-                                    "${:.2f} ", highPrice);
-                                fmt::print(fg(fmt::rgb(200, 200, 200)),
-                                    "Low: ");
-                                fmt::print(fg(fmt::rgb(255, 69, 0)) | fmt::emphasis::bold,
-                                    "${:.2f} ", lowPrice);
-                                fmt::print(fg(fmt::rgb(200, 200, 200)),
-                                    "Updates: ");
-                                fmt::print(fg(fmt::rgb(255, 215, 0)) | fmt::emphasis::bold,
-                                    "{}\n", updateCount);
-
-                                fmt::print(fg(fmt::rgb(100, 100, 120)), "{}\n", thin_separator);
-
-
-                                fmt::print(fg(fmt::rgb(255, 255, 255)) | fmt::emphasis::bold,
-                                    " 📊 MARKET SUMMARY:\n\n");
-
-
-                                string trend_indicator;
-                                fmt::rgb trend_color;
-                                string trend_label;
-
-                                if (priceHistory.size() >= 5) {
-                                    int up_count = 0;
-                                    int down_count = 0;
-
-
-                                    for (size_t i = priceHistory.size() - 5; i < priceHistory.size() - 1; ++i) {
-                                        if (priceHistory[i+1] > priceHistory[i]) up_count++;
-                                        else if (priceHistory[i+1] < priceHistory[i]) down_count++;
-                                    }
-
-                                    if (up_count > down_count) {
-                                        trend_indicator = "↗️  BULLISH";
-                                        trend_color = fmt::rgb(0, 255, 127);
-                                        trend_label = "Market trending upward";
-                                    } else if (down_count > up_count) {
-                                        trend_indicator = "↘️  BEARISH";
-                                        trend_color = fmt::rgb(255, 69, 0);
-                                        trend_label = "Market trending downward";
-                                    } else {
-                                        trend_indicator = "↔️  SIDEWAYS";
-                                        trend_color = fmt::rgb(255, 215, 0);
-                                        trend_label = "Market moving sideways";
-                                    }
-                                } else {
-                                    trend_indicator = "❓ WAITING";
-                                    trend_color = fmt::rgb(150, 150, 150);
-                                    trend_label = "Collecting data...";
-                                }
-
-
-                                fmt::print(fg(fmt::rgb(200, 200, 200)),
-                                    " Market Trend: ");
-                                fmt::print(fg(trend_color) | fmt::emphasis::bold,
-                                    "{} ", trend_indicator);
-                                fmt::print(fg(fmt::rgb(180, 180, 180)) | fmt::emphasis::italic,
-                                    "- {}\n", trend_label);
-
-
-                                double volatility = 0.0;
-                                if (priceHistory.size() >= 10) {
-                                    double sum = 0.0;
-                                    for (size_t i = priceHistory.size() - 10; i < priceHistory.size() - 1; ++i) {
-                                        sum += fabs(priceHistory[i+1] - priceHistory[i]);
-                                    }
-                                    volatility = sum / 9.0;
-                                }
-
-                                string volatility_level;
-                                fmt::rgb volatility_color;
-                                if (volatility < 0.0001 * price) {
-                                    volatility_level = "LOW";
-                                    volatility_color = fmt::rgb(0, 255, 127);
-                                } else if (volatility < 0.001 * price) {
-                                    volatility_level = "MEDIUM";
-                                    volatility_color = fmt::rgb(255, 215, 0);
-                                } else {
-                                    volatility_level = "HIGH";
-                                    volatility_color = fmt::rgb(255, 69, 0);
-                                }
-
-                                fmt::print(fg(fmt::rgb(200, 200, 200)),
-                                    " Volatility: ");
-                                fmt::print(fg(volatility_color) | fmt::emphasis::bold,
-                                    "{}", volatility_level);
-                                fmt::print(" (${:.6f} avg change)\n", volatility);
-
-
-                                double session_change = price - openPrice;
-                                double session_percent = openPrice != 0 ? (session_change / openPrice) * 100 : 0;
-                                fmt::rgb session_color = session_change >= 0 ? fmt::rgb(0, 255, 127) : fmt::rgb(255, 69, 0);
-
-                                fmt::print(fg(fmt::rgb(200, 200, 200)),
-                                    " Session Change: ");
-                                fmt::print(fg(session_color) | fmt::emphasis::bold,
-                                    "${:.2f} ({:.2f}%)\n", session_change, session_percent);
-
-
-                                fmt::print(fg(fmt::rgb(200, 200, 200)),
-                                    " Price Range: ");
-                                fmt::print("${:.2f} - ${:.2f} (${:.2f})\n",
-                                           lowPrice, highPrice, highPrice - lowPrice);
-
-
-                                fmt::print(fg(fmt::rgb(200, 200, 200)),
-                                    " Data Points: ");
-                                fmt::print(fg(fmt::rgb(255, 215, 0)) | fmt::emphasis::bold,
-                                    "{}\n", updateCount);
-
-                                fmt::print(fg(fmt::rgb(100, 100, 120)), "{}\n", separator);
-                                fmt::print(fg(fmt::rgb(180, 180, 180)) | fmt::emphasis::italic,
-                                    " Press 'q' to stop streaming\n");
-
-
-                                previousPrice = price;
-                            } else {
-                                cerr << "Unexpected data format" << endl;
-                            }
-                        } else {
-                            cerr << "Invalid or null data received" << endl;
-                        }
-                    }
-                }
+void ConnectionDetails::record_sent_message(string const &message) {
+    m_message_history.record(MessageHistory::SENT, message);
+}
 
-                if (!isDataStreaming) {
-                    m_received_data.push_back("RECEIVED: " + payload);
-                    record_summary(payload, "RECEIVED");
+bool ConnectionDetails::start_capture(const string& path) {
+    auto journal = make_shared<FrameJournalWriter>();
+    if (!journal->open(path)) {
+        return false;
+    }
+    auto previous = atomic_exchange(&m_journal, journal);
+    if (previous) {
+        previous->close();
+    }
+    return true;
+}
 
+void ConnectionDetails::stop_capture() {
+    auto journal = atomic_exchange(&m_journal, shared_ptr<FrameJournalWriter>());
+    if (journal) {
+        journal->close();
+    }
+}
 
-                    if (received_json.contains("result") && AUTHENTICATION_SENT) {
-                        if (received_json["result"].contains("access_token")) {
-                            string access_token = received_json["result"]["access_token"];
-                            cout << "DEBUG: Received access token from server" << endl;
+void ConnectionDetails::set_history_capacity(size_t capacity) {
+    m_message_history.resize(capacity);
+    m_transaction_logs.resize(capacity);
+}
 
+long ConnectionDetails::track_request(string const &message, ResponseHandler on_response,
+                                     TimeoutHandler on_timeout, chrono::milliseconds timeout,
+                                     FailureHandler on_failure) {
+    json request = json::parse(message, nullptr, false);
+    if (request.is_discarded() || !request.is_object() ||
+        !request.contains("id") || !request["id"].is_number_integer()) {
+        return 0;
+    }
 
-                            Credentials::password().setAccessToken(access_token);
+    string method = request.value("method", "");
+    CompletionHandler renderer;
+    auto factory = responseHandlers().find(method);
+    if (factory != responseHandlers().end()) {
+        renderer = factory->second(request);
+    }
 
-                            vector<pair<string, string>> content = {
-                                {"Status", "Success"},
-                                {"", ""},
-                                {"Message", "Access token received and stored securely"}
-                            };
+    if (method == "public/auth" && request.contains("params")) {
+        atomic_store(&m_auth_request, make_shared<const json>(request));
+    }
 
-                            utils::displayBox("AUTHENTICATION SUCCESSFUL", content,
-                                            fmt::rgb(0, 205, 102), "🔐");
-                        }
-                        AUTHENTICATION_SENT = false;
-                    }
+    long request_id = request["id"].get<long>();
+    m_flight.record(FlightRecorder::REQUEST_SENT, m_connection_id, request_id, message.size(),
+                               FlightRecorder::NO_CHANNEL, method);
+    m_pending_requests.register_request(request_id, method,
+        [method, renderer, on_response](const json& response) {
+            if (response.contains("error")) {
+                reportRequestError(method, response);
+            } else if (renderer) {
+                renderer(response);
+            }
+            if (on_response) {
+                on_response(response);
+            }
+        },
+        timeout,
+        [this, request_id, on_timeout](const string& method) {
+            FlightRecorder& flight = m_flight;
+            flight.record(FlightRecorder::REQUEST_TIMEOUT, m_connection_id, request_id, 0,
+                          FlightRecorder::NO_CHANNEL, method);
+            flight.trigger(FlightRecorder::TRIGGER_TIMEOUT);
+            if (on_timeout) {
+                on_timeout(method);
+            }
+        },
+        move(on_failure));
+    return request_id;
+}
 
+void ConnectionDetails::dispatch_response(json const &response) {
+    if (!response.contains("id") || !response["id"].is_number_integer()) {
+        return;
+    }
 
-                    if (received_json.contains("id") && received_json.contains("result")) {
-
-                        if (received_json.contains("error")) {
-                            cout << "ERROR: API request failed: " << received_json["error"]["message"].get<string>() << endl;
-
-                            vector<pair<string, string>> errorContent = {
-                                {"Status", "Failed"},
-                                {"Error", received_json["error"]["message"].get<string>()},
-                                {"Code", to_string(received_json["error"]["code"].get<int>())},
-                                {"", ""},
-                                {"Message", "Please check your request parameters and try again"}
-                            };
-
-                            utils::displayBox("API REQUEST FAILED", errorContent,
-                                            fmt::rgb(255, 69, 0), "❌");
-                        }
-
-
-                        if (!m_received_data.empty() && m_received_data.size() >= 2) {
-                            string prev_message = m_received_data[m_received_data.size() - 2];
-
-                            if (prev_message.find("public/get_order_book") != string::npos) {
-                                json req_json;
-                                try {
-                                    size_t json_start = prev_message.find("{");
-                                    if (json_start != string::npos) {
-                                        req_json = json::parse(prev_message.substr(json_start));
-                                        if (req_json.contains("params") && req_json["params"].contains("instrument_name")) {
-                                            string instrument = req_json["params"]["instrument_name"];
-                                            int depth = req_json["params"].contains("depth") ?
-                                                       req_json["params"]["depth"].get<int>() : 10;
-
-                                            utils::printOrderbook(instrument, payload, depth);
-                                        }
-                                    }
-                                } catch (const json::parse_error& e) {
-
-                                }
-                            }
-                            else if (prev_message.find("private/get_positions") != string::npos) {
-                                utils::printPositions(payload);
-                            }
-                            else if (prev_message.find("private/get_open_orders") != string::npos) {
-                                utils::printOpenOrders(payload);
-                            }
-                            else if (prev_message.find("private/buy") != string::npos) {
-
-                                if (received_json.contains("result") && received_json["result"].contains("order_id")) {
-                                    string order_id = received_json["result"]["order_id"];
-                                    string order_state = received_json["result"]["order_state"];
-
-                                    vector<pair<string, string>> content = {
-                                        {"Order ID", order_id},
-                                        {"Order State", order_state},
-                                        {"", ""},
-                                        {"Message", "Order has been successfully placed"}
-                                    };
-
-                                    utils::displayBox("BUY ORDER CONFIRMED", content,
-                                                    fmt::rgb(0, 255, 127), "✅");
-                                }
-                            }
-                            else if (prev_message.find("private/sell") != string::npos) {
-
-                                if (received_json.contains("result") && received_json["result"].contains("order_id")) {
-                                    string order_id = received_json["result"]["order_id"];
-                                    string order_state = received_json["result"]["order_state"];
-
-                                    vector<pair<string, string>> content = {
-                                        {"Order ID", order_id},
-                                        {"Order State", order_state},
-                                        {"", ""},
-                                        {"Message", "Order has been successfully placed"}
-                                    };
-
-                                    utils::displayBox("SELL ORDER CONFIRMED", content,
-                                                    fmt::rgb(255, 69, 0), "✅");
-                                }
-                            }
-                            else if (prev_message.find("private/edit") != string::npos) {
-
-                                if (received_json.contains("result") && received_json["result"].contains("order_id")) {
-                                    string order_id = received_json["result"]["order_id"];
-                                    string order_state = received_json["result"]["order_state"];
-
-                                    vector<pair<string, string>> content = {
-                                        {"Order ID", order_id},
-                                        {"Order State", order_state},
-                                        {"", ""},
-                                        {"Message", "Order has been successfully modified"}
-                                    };
-
-                                    utils::displayBox("ORDER MODIFICATION CONFIRMED", content,
-                                                    fmt::rgb(255, 215, 0), "✅");
-                                }
-                            }
-                            else if (prev_message.find("private/cancel") != string::npos &&
-                                    prev_message.find("private/cancel_all") == string::npos &&
-                                    prev_message.find("private/cancel_all_by") == string::npos &&
-                                    prev_message.find("private/cancel_by_label") == string::npos) {
-
-                                if (received_json.contains("result")) {
-                                    vector<pair<string, string>> content = {
-                                        {"", ""},
-                                        {"Message", "Order has been successfully cancelled"}
-                                    };
-
-                                    utils::displayBox("ORDER CANCELLATION CONFIRMED", content,
-                                                    fmt::rgb(255, 99, 71), "✅");
-                                }
-                            }
-                            else if (prev_message.find("private/cancel_all") != string::npos ||
-                                    prev_message.find("private/cancel_all_by") != string::npos ||
-                                    prev_message.find("private/cancel_by_label") != string::npos) {
-
-                                if (received_json.contains("result")) {
-                                    vector<pair<string, string>> content = {
-                                        {"", ""},
-                                        {"Message", "Orders have been successfully cancelled"}
-                                    };
-
-                                    utils::displayBox("ORDERS CANCELLATION CONFIRMED", content,
-                                                    fmt::rgb(255, 99, 71), "✅");
-                                }
-                            }
-                        }
-                    }
-                }
+    RequestRegistry::PendingRequest request;
+    if (!m_pending_requests.complete(response["id"].get<long>(), request)) {
+        return;
+    }
+    uint64_t rtt = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now() - request.sent_at).count());
+    m_request_rtt.record(rtt);
+    m_flight.record(FlightRecorder::RESPONSE_RECEIVED, m_connection_id, response["id"].get<long>(), rtt,
+                               FlightRecorder::NO_CHANNEL, request.method);
+
+    if (request.on_complete) {
+        request.on_complete(response);
+    }
+}
 
-                DATA_PROCESSED = true;
-                connection_cv.notify_one();
-            }
-            catch (const exception& e) {
-                cerr << "Error processing message: " << e.what() << endl;
-                DATA_PROCESSED = true;
-                connection_cv.notify_one();
-            }
+size_t ConnectionDetails::expire_requests(chrono::steady_clock::time_point now) {
+    size_t expired = m_pending_requests.expire(now);
+    if (expired > 0) {
+        m_request_timeouts.fetch_add(expired, memory_order_relaxed);
+    }
+    return expired;
+}
 
+ConnectionDetails::TrafficStats ConnectionDetails::traffic() const {
+    uint64_t opens = m_opens.load(memory_order_relaxed);
+    return {m_messages_received.load(memory_order_relaxed), m_bytes_received.load(memory_order_relaxed),
+            m_messages_sent.load(memory_order_relaxed), m_bytes_sent.load(memory_order_relaxed),
+            opens > 0 ? opens - 1 : 0, m_request_timeouts.load(memory_order_relaxed)};
+}
 
-            getPerformanceMonitor().stop_measurement(
-                PerformanceMonitor::WEBSOCKET_COMMUNICATION,
-                "websocket_message_" + to_string(m_connection_id)
-            );
-        }
-        else if (msg->type == ix::WebSocketMessageType::Open) {
-            m_connection_status = "Connected";
-            m_server_info = "IXWebSocket";
-        }
-        else if (msg->type == ix::WebSocketMessageType::Error) {
-            m_connection_status = "Error";
+void ConnectionDetails::fail_pending_requests(const string& reason) {
+    // Responses cannot arrive on a dead socket; fail waiters now instead of at their deadline.
+    m_pending_requests.fail_all(make_exception_ptr(ConnectionClosed(reason)));
+}
 
-            m_error_message = msg->errorInfo.reason;
-            stringstream ss;
-            ss << "Error: " << msg->errorInfo.reason;
-            if (msg->errorInfo.http_status != 0) {
-                ss << " HTTP Status: " << msg->errorInfo.http_status;
-            }
+size_t ConnectionDetails::pending_requests() {
+    return m_pending_requests.pending_count();
+}
 
-            cerr << ss.str() << endl;
+bool ConnectionDetails::sync_clock() {
+    if (!m_webSocketClient || !connected()) {
+        return false;
+    }
+    // Sent outside send_request so the periodic probe stays out of the
+    // message history and transaction log.
+    long request_id = next_request_id();
+    string message = json{{"jsonrpc", "2.0"}, {"id", request_id}, {"method", "public/get_time"}}.dump();
+    m_last_clock_sync.store(chrono::steady_clock::now().time_since_epoch().count());
+    m_clock_sync_request.store(request_id);
+    int64_t sent_us = ClockSync::wall_clock_us();
+    m_pending_requests.register_request(request_id, "public/get_time", [this, sent_us](const json& response) {
+        if (!response.contains("result") || !response["result"].is_number_integer()) {
+            return;
         }
-        else if (msg->type == ix::WebSocketMessageType::Close) {
-            m_connection_status = "Closed";
-            stringstream ss;
-            ss << "Close code: " << msg->closeInfo.code << ", reason: " << msg->closeInfo.reason;
-            m_error_message = ss.str();
+        int64_t server_in_us = response["result"].get<int64_t>() * 1000;
+        int64_t server_out_us = server_in_us;
+        if (response.contains("usIn") && response.contains("usOut") &&
+            response["usIn"].is_number_integer() && response["usOut"].is_number_integer()) {
+            server_in_us = response["usIn"].get<int64_t>();
+            server_out_us = response["usOut"].get<int64_t>();
         }
-    });
+        getClockSync().add_sample(sent_us, server_in_us, server_out_us, m_received_us);
+    }, chrono::seconds(5));
+    if (!m_webSocketClient->send(message).success) {
+        RequestRegistry::PendingRequest discarded;
+        m_pending_requests.complete(request_id, discarded);
+        return false;
+    }
+    m_messages_sent.fetch_add(1, memory_order_relaxed);
+    m_bytes_sent.fetch_add(message.size(), memory_order_relaxed);
+    return true;
 }
 
-int ConnectionDetails::get_id() { return m_connection_id; }
-string ConnectionDetails::get_status() { return m_connection_status; }
-
-void ConnectionDetails::record_sent_message(string const &message) {
-    m_received_data.push_back("SENT: " + message);
+bool ConnectionDetails::sync_clock_if_due(chrono::steady_clock::time_point now) {
+    auto last = chrono::steady_clock::time_point(chrono::steady_clock::duration(m_last_clock_sync.load()));
+    if (now - last < CLOCK_SYNC_INTERVAL) {
+        return false;
+    }
+    return sync_clock();
 }
 
 void ConnectionDetails::record_summary(string const &message, string const &sent) {
@@ -666,7 +862,8 @@ void ConnectionDetails::record_summary(string const &message, string const &sent
     else {
         summary = find->second(parsed_msg);
     }
-    m_transaction_logs.push_back(sent + " : \n" + utils::mapToString(summary));
+    m_transaction_logs.record(sent == "SENT" ? MessageHistory::SENT : MessageHistory::RECEIVED,
+                              utils::mapToString(summary));
 }
 
 void ConnectionDetails::close(uint16_t code, const string& reason) {
@@ -676,13 +873,29 @@ void ConnectionDetails::close(uint16_t code, const string& reason) {
 }
 
 bool ConnectionDetails::send(const string& message) {
-    if (!m_webSocketClient || m_connection_status != "Connected") {
-        return false;
+    return send_request(message, nullptr, nullptr) >= 0;
+}
+
+long ConnectionDetails::send_request(const string& message, ResponseHandler on_response,
+                                     TimeoutHandler on_timeout, chrono::milliseconds timeout,
+                                     FailureHandler on_failure) {
+    if (!m_webSocketClient || !connected()) {
+        return -1;
     }
 
-    m_webSocketClient->send(message);
+    long request_id = track_request(message, move(on_response), move(on_timeout), timeout, move(on_failure));
+    if (!m_webSocketClient->send(message).success) {
+        RequestRegistry::PendingRequest discarded;
+        m_pending_requests.complete(request_id, discarded);
+        return -1;
+    }
+    m_messages_sent.fetch_add(1, memory_order_relaxed);
+    m_bytes_sent.fetch_add(message.size(), memory_order_relaxed);
+    if (auto journal = atomic_load(&m_journal)) {
+        journal->append(MessageHistory::SENT, m_connection_id, message);
+    }
     record_sent_message(message);
-    return true;
+    return request_id;
 }
 
 ix::WebSocket* ConnectionDetails::get_websocket() {
@@ -691,27 +904,42 @@ ix::WebSocket* ConnectionDetails::get_websocket() {
 
 ostream &operator<< (ostream &out, ConnectionDetails const &data) {
     out << "> URI: " << data.m_endpoint_uri << "\n"
-        << "> Status: " << data.m_connection_status << "\n"
+        << "> Status: " << data.get_status() << "\n"
         << "> Remote Server: " << (data.m_server_info.empty() ? "None Specified" : data.m_server_info) << "\n"
         << "> Error/close reason: " << (data.m_error_message.empty() ? "N/A" : data.m_error_message) << "\n"
-        << "> Messages Processed: (" << data.m_received_data.size() << ") \n";
-
-    vector<string>::const_iterator it;
-    for (it = data.m_transaction_logs.begin(); it != data.m_transaction_logs.end(); ++it) {
-        out << *it << "\n";
-    }
+        << "> Messages Processed: (" << data.m_message_history.size() << ") \n"
+        << "> History: " << data.m_message_history.size() << "/" << data.m_message_history.capacity()
+        << " messages, " << data.m_message_history.memory_usage() << " bytes\n"
+        << "> Dropped Stream Events: " << data.m_dropped_events.load() << "\n"
+        << "> Order Book Resyncs: " << data.m_book_resyncs.load() << "\n";
+
+    data.m_transaction_logs.for_each([&out](const MessageHistory::Entry& entry) {
+        out << (entry.direction == MessageHistory::SENT ? "SENT" : "RECEIVED") << " : \n" << entry.payload << "\n";
+    });
     return out;
 }
 
-SocketEndpoint::SocketEndpoint(): m_next_id(0) {
+SocketEndpoint::SocketEndpoint(): m_next_id(0), m_shard_policy(SHARD_BY_RATE), m_reaper_stopping(false) {
 
     ix::initNetSystem();
+    m_timeout_reaper = thread([this] { expire_requests(); });
 }
 
 SocketEndpoint::~SocketEndpoint() {
+    if (!pool().empty()) {
+        getSubscriptionManager().set_router(nullptr);
+    }
+    {
+        lock_guard<mutex> lock(m_reaper_mutex);
+        m_reaper_stopping = true;
+    }
+    m_reaper_cv.notify_all();
+    if (m_timeout_reaper.joinable()) {
+        m_timeout_reaper.join();
+    }
 
     for (connection_list::const_iterator it = m_active_connections.begin(); it != m_active_connections.end(); ++it) {
-        if (it->second->get_status() != "Connected") {
+        if (!it->second->connected()) {
             continue;
         }
 
@@ -723,11 +951,45 @@ SocketEndpoint::~SocketEndpoint() {
     ix::uninitNetSystem();
 }
 
-int SocketEndpoint::connect(string const &uri) {
-    int new_id = m_next_id++;
+void SocketEndpoint::expire_requests() {
+    unique_lock<mutex> lock(m_reaper_mutex);
+    while (!m_reaper_cv.wait_for(lock, chrono::milliseconds(20), [this] { return m_reaper_stopping; })) {
+        vector<ConnectionDetails::ptr> connections;
+        {
+            lock_guard<mutex> connections_lock(m_connections_mutex);
+            for (const auto& connection : m_active_connections) {
+                connections.push_back(connection.second);
+            }
+        }
+        auto now = chrono::steady_clock::now();
+        for (const auto& connection : connections) {
+            connection->expire_requests(now);
+            connection->sync_clock_if_due(now);
+            if (auto journal = connection->capture_journal()) {
+                journal->flush();
+            }
+            connection->history().flush_spill();
+        }
+        string dumped = getFlightRecorder().flush_pending();
+        if (!dumped.empty()) {
+            cerr << "> Flight recorder dumped to " << dumped << endl;
+        }
+        string cache_path;
+        if (getInstrumentRegistry().flush_pending_save(cache_path) == InstrumentRegistry::SAVE_FAILED) {
+            cerr << "> Could not write instrument cache " << cache_path << endl;
+        }
+    }
+}
 
-    ConnectionDetails::ptr metadata_ptr(new ConnectionDetails(new_id, uri, this));
-    m_active_connections[new_id] = metadata_ptr;
+int SocketEndpoint::connect(string const &uri) {
+    ConnectionDetails::ptr metadata_ptr;
+    {
+        lock_guard<mutex> lock(m_connections_mutex);
+        int new_id = m_next_id++;
+        metadata_ptr.reset(new ConnectionDetails(new_id, uri, this));
+        m_active_connections[new_id] = metadata_ptr;
+    }
+    int new_id = metadata_ptr->get_id();
 
 
     metadata_ptr->get_websocket()->start();
@@ -735,7 +997,143 @@ int SocketEndpoint::connect(string const &uri) {
     return new_id;
 }
 
+vector<ConnectionDetails::ptr> SocketEndpoint::connections() const {
+    lock_guard<mutex> lock(m_connections_mutex);
+    vector<ConnectionDetails::ptr> connections;
+    for (const auto& connection : m_active_connections) {
+        connections.push_back(connection.second);
+    }
+    return connections;
+}
+
+vector<int> SocketEndpoint::open_pool(const string& uri, size_t size, ShardPolicy policy) {
+    {
+        lock_guard<mutex> lock(m_pool_mutex);
+        if (!m_pool.empty() || size == 0 || size > MAX_POOL_SIZE) {
+            return {};
+        }
+    }
+    vector<int> ids;
+    for (size_t i = 0; i < size; i++) {
+        ids.push_back(connect(uri));
+    }
+    {
+        lock_guard<mutex> lock(m_pool_mutex);
+        m_pool = ids;
+        m_shard_policy = policy;
+    }
+    getSubscriptionManager().set_router(
+        [this](const string& channel, const vector<SubscriptionManager::Subscription>& current) {
+            return shard_for(channel, current);
+        });
+    return ids;
+}
+
+vector<int> SocketEndpoint::pool() const {
+    lock_guard<mutex> lock(m_pool_mutex);
+    return m_pool;
+}
+
+double SocketEndpoint::pool_load(int id) const {
+    if (pool().empty()) {
+        return 0.0;
+    }
+    double load = 0.0;
+    for (const auto& subscription : getSubscriptionManager().subscriptions()) {
+        if (subscription.connection_id == id) {
+            load += SubscriptionManager::estimated_rate(getSymbolTable().name(subscription.channel));
+        }
+    }
+    return load;
+}
+
+// Instrument sharding keeps every channel of one instrument on the same
+// socket, so its book, ticker and trades stay ordered relative to each other.
+// Rate sharding places each new channel on the connection with the least
+// estimated traffic.
+int SocketEndpoint::shard_for(const string& channel, const vector<SubscriptionManager::Subscription>& current) {
+    lock_guard<mutex> lock(m_pool_mutex);
+    if (m_pool.empty()) {
+        return -1;
+    }
+    size_t shard = 0;
+    if (m_shard_policy == SHARD_BY_INSTRUMENT) {
+        shard = hash<string_view>()(SubscriptionManager::instrument_of(channel)) % m_pool.size();
+    } else {
+        vector<double> load(m_pool.size(), 0.0);
+        for (const auto& subscription : current) {
+            auto member = find(m_pool.begin(), m_pool.end(), subscription.connection_id);
+            if (member != m_pool.end()) {
+                load[member - m_pool.begin()] +=
+                    SubscriptionManager::estimated_rate(getSymbolTable().name(subscription.channel));
+            }
+        }
+        for (size_t i = 1; i < m_pool.size(); i++) {
+            if (load[i] < load[shard]) shard = i;
+        }
+    }
+    return m_pool[shard];
+}
+
+bool SocketEndpoint::send_subscription(int id, const string& request, vector<future<json>>& responses,
+                                       chrono::milliseconds timeout) {
+    json parsed = json::parse(request, nullptr, false);
+    if (parsed.is_discarded() || !parsed.contains("method") || !parsed.contains("params") ||
+        !parsed["params"].contains("channels") || !parsed["params"]["channels"].is_array()) {
+        return false;
+    }
+    string method = parsed["method"];
+    bool unsubscribing = method.find("/unsubscribe") != string::npos;
+    if (!unsubscribing && method.find("/subscribe") == string::npos) {
+        return false;
+    }
+
+    // The SubscriptionManager records which connection each channel was
+    // routed to; channels it has no owner for go to the requested connection.
+    SubscriptionManager& subscriptions = getSubscriptionManager();
+    map<int, vector<string>> by_connection;
+    for (const json& entry : parsed["params"]["channels"]) {
+        string channel = entry.get<string>();
+        int owner = unsubscribing ? subscriptions.take_released_owner(channel) : subscriptions.owner_of(channel);
+        by_connection[owner == SubscriptionManager::ANY_CONNECTION ? id : owner].push_back(move(channel));
+    }
+    // The manager already reflects the request; settle it once the exchange
+    // answers so rejected, timed-out or unsent channels do not linger.
+    for (const auto& shard : by_connection) {
+        int owner = shard.first;
+        vector<string> channels = shard.second;
+        string message = unsubscribing ? SubscriptionManager::unsubscribe_request(channels)
+                                       : SubscriptionManager::subscribe_request(channels);
+        auto response = make_shared<promise<json>>();
+        responses.push_back(response->get_future());
+        auto settle = [unsubscribing, owner, channels](const json* reply) {
+            settleSubscription(unsubscribing, owner, channels, reply);
+        };
+        long request_id = send_async(owner, message,
+            [response, settle](const json& reply) {
+                settle(&reply);
+                response->set_value(reply);
+            },
+            [response, settle](const string& method) {
+                settle(nullptr);
+                response->set_exception(make_exception_ptr(RequestTimeout(method)));
+            },
+            timeout,
+            [response, settle](const exception_ptr& error) {
+                settle(nullptr);
+                response->set_exception(error);
+            });
+        if (request_id <= 0) {
+            settle(nullptr);
+            response->set_exception(make_exception_ptr(
+                runtime_error("Failed to send request on connection " + to_string(owner))));
+        }
+    }
+    return true;
+}
+
 ConnectionDetails::ptr SocketEndpoint::get_metadata(int id) const {
+    lock_guard<mutex> lock(m_connections_mutex);
     connection_list::const_iterator it = m_active_connections.find(id);
     if (it == m_active_connections.end()) {
         return ConnectionDetails::ptr();
@@ -744,23 +1142,23 @@ ConnectionDetails::ptr SocketEndpoint::get_metadata(int id) const {
 }
 
 void SocketEndpoint::close(int id, uint16_t code, string reason) {
-    connection_list::iterator it = m_active_connections.find(id);
-    if (it == m_active_connections.end()) {
+    ConnectionDetails::ptr connection = get_metadata(id);
+    if (!connection) {
         cout << "> No connection found with id " << id << endl;
         return;
     }
 
-    it->second->close(code, reason);
+    connection->close(code, reason);
 }
 
 int SocketEndpoint::send(int id, string message) {
-    connection_list::iterator it = m_active_connections.find(id);
-    if (it == m_active_connections.end()) {
+    ConnectionDetails::ptr connection = get_metadata(id);
+    if (!connection) {
         cout << "> No connection found with id " << id << endl;
         return -1;
     }
 
-    if (!it->second->send(message)) {
+    if (!connection->send(message)) {
         cout << "> Error sending message to connection " << id << endl;
         return -1;
     }
@@ -768,27 +1166,56 @@ int SocketEndpoint::send(int id, string message) {
     return 0;
 }
 
-int SocketEndpoint::streamSubscriptions(const vector<string>& connections) {
-    if (connections.empty()) {
-        cout << "No subscriptions to stream." << endl;
+long SocketEndpoint::send_async(int id, const string& message, ConnectionDetails::ResponseHandler on_response,
+                                ConnectionDetails::TimeoutHandler on_timeout, chrono::milliseconds timeout,
+                                ConnectionDetails::FailureHandler on_failure) {
+    ConnectionDetails::ptr connection = get_metadata(id);
+    if (!connection) {
+        cout << "> No connection found with id " << id << endl;
         return -1;
     }
 
-    json subscribe = {
-        {"jsonrpc", "2.0"},
-        {"id", 4235},
-        {"method", "private/subscribe"},
-        {"params", {
-            {"channels", connections}
-        }}
-    };
+    long request_id = connection->send_request(message, move(on_response), move(on_timeout), timeout,
+                                               move(on_failure));
+    if (request_id < 0) {
+        cout << "> Error sending message to connection " << id << endl;
+    }
+    return request_id;
+}
 
-    isDataStreaming = true;
+future<json> SocketEndpoint::send_async(int id, const string& message, chrono::milliseconds timeout) {
+    auto response = make_shared<promise<json>>();
+    future<json> result = response->get_future();
+
+    long request_id = send_async(id, message,
+        [response](const json& reply) { response->set_value(reply); },
+        [response](const string& method) {
+            response->set_exception(make_exception_ptr(RequestTimeout(method)));
+        },
+        timeout,
+        [response](const exception_ptr& error) { response->set_exception(error); });
+
+    if (request_id < 0) {
+        response->set_exception(make_exception_ptr(
+            runtime_error("Failed to send request on connection " + to_string(id))));
+    } else if (request_id == 0) {
+        response->set_value(json());
+    }
+    return result;
+}
 
-    if (!m_active_connections.empty()) {
-        int connectionId = m_active_connections.begin()->first;
+int SocketEndpoint::streamSubscriptions(const vector<string>& connections, int refresh_hz) {
+    if (connections.empty()) {
+        cout << "No subscriptions to stream." << endl;
+        return -1;
+    }
 
-        send(connectionId, subscribe.dump());
+    vector<ConnectionDetails::ptr> sources = this->connections();
+    if (!sources.empty()) {
+        // Every connection publishes into its own ring; the renderer drains
+        // them all, so sharded sockets appear as one stream.
+        StreamRenderer renderer(sources, refresh_hz);
+        renderer.start();
 
         struct termios oldt, newt;
         tcgetattr(STDIN_FILENO, &oldt);
@@ -802,22 +1229,11 @@ int SocketEndpoint::streamSubscriptions(const vector<string>& connections) {
 
         fmt::print(fmt::fg(fmt::color::blue) | fmt::emphasis::bold,
                 "> Streaming... Press 'q' to quit.\n");
-        while(isDataStreaming) {
+        while(true) {
 
             char ch;
             if (read(STDIN_FILENO, &ch, 1) > 0) {
                 if (ch == 'q' || ch == 'Q') {
-                    isDataStreaming = false;
-
-
-                    json unsubscribe = {
-                        {"jsonrpc", "2.0"},
-                        {"id", 154},
-                        {"method", "private/unsubscribe_all"},
-                        {"params", {}}
-                    };
-
-                    send(connectionId, unsubscribe.dump());
                     break;
                 }
             }
@@ -826,6 +1242,8 @@ int SocketEndpoint::streamSubscriptions(const vector<string>& connections) {
             this_thread::sleep_for(chrono::milliseconds(1));
         }
 
+        renderer.stop();
+
 
         tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
         fcntl(STDIN_FILENO, F_SETFL, oldf);
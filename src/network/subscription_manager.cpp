@@ -0,0 +1,227 @@
+#include "network/subscription_manager.h"
+#include "exchange_interface/market_api.h"
+#include <algorithm>
+using namespace std;
+namespace {
+    // Raw feeds and user.* channels are only served to authenticated sessions.
+    string requestMethod(const vector<string>& channels, const char* action) {
+        bool needs_auth = any_of(channels.begin(), channels.end(), [](const string& channel) {
+            return SubscriptionManager::is_private(channel);
+        });
+        return string(needs_auth ? "private/" : "public/") + action;
+    }
+}
+vector<SubscriptionManager::Subscription>::iterator SubscriptionManager::locate(uint32_t channel) {
+    return find_if(m_subscriptions.begin(), m_subscriptions.end(),
+                   [channel](const Subscription& subscription) { return subscription.channel == channel; });
+}
+vector<SubscriptionManager::Subscription>::const_iterator SubscriptionManager::locate_book(string_view instrument) const {
+    return find_if(m_subscriptions.begin(), m_subscriptions.end(), [instrument](const Subscription& subscription) {
+        return subscription.kind == ChannelKind::Book &&
+               instrument_of(getSymbolTable().name(subscription.channel)) == instrument;
+    });
+}
+void SubscriptionManager::acquire(int connection_id, const vector<string>& channels, vector<string>& added,
+                                  vector<string>* rejected) {
+    added.clear();
+    if (rejected != nullptr) rejected->clear();
+    lock_guard<mutex> lock(m_mutex);
+    for (const string& name : channels) {
+        uint32_t channel = getSymbolTable().intern(name);
+        if (channel == SymbolTable::INVALID) {
+            if (rejected != nullptr) rejected->push_back(name);
+            continue;
+        }
+        auto it = locate(channel);
+        if (it != m_subscriptions.end()) {
+            it->ref_count++;
+            continue;
+        }
+        ChannelKind kind = market_data::classifyChannel(name);
+        if (kind == ChannelKind::Book && locate_book(instrument_of(name)) != m_subscriptions.end()) {
+            if (rejected != nullptr) rejected->push_back(name);
+            continue;
+        }
+        int owner = connection_id;
+        if (m_router) {
+            int routed = m_router(name, m_subscriptions);
+            if (routed >= 0) owner = routed;
+        }
+        m_subscriptions.push_back({channel, kind, owner, 1});
+        added.push_back(name);
+    }
+}
+size_t SubscriptionManager::release(const vector<string>& channels, vector<string>& dropped) {
+    dropped.clear();
+    size_t released = 0;
+    lock_guard<mutex> lock(m_mutex);
+    for (const string& name : channels) {
+        auto it = locate(getSymbolTable().find(name));
+        if (it == m_subscriptions.end()) {
+            continue;
+        }
+        released++;
+        if (--it->ref_count == 0) {
+            remember_released(*it);
+            m_subscriptions.erase(it);
+            dropped.push_back(name);
+        }
+    }
+    return released;
+}
+void SubscriptionManager::settle(bool unsubscribing, int connection_id, const vector<string>& channels,
+                                 const vector<string>& confirmed) {
+    lock_guard<mutex> lock(m_mutex);
+    for (const string& name : channels) {
+        if (find(confirmed.begin(), confirmed.end(), name) != confirmed.end()) {
+            continue;
+        }
+        uint32_t channel = getSymbolTable().find(name);
+        auto it = locate(channel);
+        if (!unsubscribing && it != m_subscriptions.end()) {
+            m_subscriptions.erase(it);
+        } else if (unsubscribing && it == m_subscriptions.end() && channel != SymbolTable::INVALID) {
+            m_subscriptions.push_back({channel, market_data::classifyChannel(name), connection_id, 1});
+        }
+    }
+}
+void SubscriptionManager::release_all(int connection_id, vector<string>& dropped) {
+    dropped.clear();
+    lock_guard<mutex> lock(m_mutex);
+    auto keep = remove_if(m_subscriptions.begin(), m_subscriptions.end(), [&](const Subscription& subscription) {
+        if (connection_id != ANY_CONNECTION && subscription.connection_id != connection_id) return false;
+        remember_released(subscription);
+        dropped.emplace_back(getSymbolTable().name(subscription.channel));
+        return true;
+    });
+    m_subscriptions.erase(keep, m_subscriptions.end());
+}
+bool SubscriptionManager::contains(string_view channel) const {
+    return ref_count(channel) > 0;
+}
+uint32_t SubscriptionManager::ref_count(string_view channel) const {
+    uint32_t id = getSymbolTable().find(channel);
+    lock_guard<mutex> lock(m_mutex);
+    for (const Subscription& subscription : m_subscriptions) {
+        if (subscription.channel == id) return subscription.ref_count;
+    }
+    return 0;
+}
+vector<string> SubscriptionManager::channels() const {
+    lock_guard<mutex> lock(m_mutex);
+    vector<string> names;
+    names.reserve(m_subscriptions.size());
+    for (const Subscription& subscription : m_subscriptions) {
+        names.emplace_back(getSymbolTable().name(subscription.channel));
+    }
+    return names;
+}
+vector<string> SubscriptionManager::channels_for(int connection_id) const {
+    lock_guard<mutex> lock(m_mutex);
+    vector<string> names;
+    for (const Subscription& subscription : m_subscriptions) {
+        if (subscription.connection_id == connection_id) {
+            names.emplace_back(getSymbolTable().name(subscription.channel));
+        }
+    }
+    return names;
+}
+string SubscriptionManager::book_channel(string_view instrument) const {
+    lock_guard<mutex> lock(m_mutex);
+    auto it = locate_book(instrument);
+    return it == m_subscriptions.end() ? string() : string(getSymbolTable().name(it->channel));
+}
+int SubscriptionManager::owner_of(string_view channel) const {
+    uint32_t id = getSymbolTable().find(channel);
+    lock_guard<mutex> lock(m_mutex);
+    for (const Subscription& subscription : m_subscriptions) {
+        if (subscription.channel == id) return subscription.connection_id;
+    }
+    return ANY_CONNECTION;
+}
+void SubscriptionManager::remember_released(const Subscription& subscription) {
+    if (!m_router) return;
+    auto it = find_if(m_released.begin(), m_released.end(),
+                      [&](const Subscription& released) { return released.channel == subscription.channel; });
+    if (it != m_released.end()) {
+        *it = subscription;
+    } else {
+        m_released.push_back(subscription);
+    }
+}
+int SubscriptionManager::take_released_owner(string_view channel) {
+    uint32_t id = getSymbolTable().find(channel);
+    lock_guard<mutex> lock(m_mutex);
+    auto it = find_if(m_released.begin(), m_released.end(),
+                      [id](const Subscription& released) { return released.channel == id; });
+    if (it == m_released.end()) {
+        return ANY_CONNECTION;
+    }
+    int owner = it->connection_id;
+    m_released.erase(it);
+    return owner;
+}
+vector<SubscriptionManager::Subscription> SubscriptionManager::subscriptions() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_subscriptions;
+}
+size_t SubscriptionManager::size() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_subscriptions.size();
+}
+void SubscriptionManager::clear() {
+    lock_guard<mutex> lock(m_mutex);
+    m_subscriptions.clear();
+    m_released.clear();
+}
+void SubscriptionManager::set_router(Router router) {
+    lock_guard<mutex> lock(m_mutex);
+    m_router = move(router);
+    m_released.clear();
+}
+bool SubscriptionManager::routed() const {
+    lock_guard<mutex> lock(m_mutex);
+    return static_cast<bool>(m_router);
+}
+bool SubscriptionManager::is_private(string_view channel) {
+    if (channel.compare(0, 5, "user.") == 0) return true;
+    return channel.size() >= 4 && channel.compare(channel.size() - 4, 4, ".raw") == 0;
+}
+string_view SubscriptionManager::instrument_of(string_view channel) {
+    size_t begin = channel.find('.');
+    if (begin != string_view::npos && channel.compare(0, 5, "user.") == 0) {
+        begin = channel.find('.', begin + 1);
+    }
+    if (begin == string_view::npos) return channel;
+    size_t end = channel.find('.', begin + 1);
+    return channel.substr(begin + 1, end == string_view::npos ? string_view::npos : end - begin - 1);
+}
+// Rough notifications per second, used to balance connections. Raw feeds
+// publish on every change; book frames also cost several times a ticker to
+// decode and apply.
+double SubscriptionManager::estimated_rate(string_view channel) {
+    double rate = 1.0;
+    if (channel.size() >= 4 && channel.compare(channel.size() - 4, 4, ".raw") == 0) {
+        rate = 50.0;
+    } else if (channel.size() >= 6 && channel.compare(channel.size() - 6, 6, ".100ms") == 0) {
+        rate = 10.0;
+    }
+    if (market_data::classifyChannel(channel) == ChannelKind::Book) {
+        rate *= 4.0;
+    }
+    return rate;
+}
+string SubscriptionManager::subscribe_request(const vector<string>& channels) {
+    jsonrpc_request request(requestMethod(channels, "subscribe"));
+    request["params"] = {{"channels", channels}};
+    return request.dump();
+}
+string SubscriptionManager::unsubscribe_request(const vector<string>& channels) {
+    jsonrpc_request request(requestMethod(channels, "unsubscribe"));
+    request["params"] = {{"channels", channels}};
+    return request.dump();
+}
+SubscriptionManager& getSubscriptionManager() {
+    static SubscriptionManager manager;
+    return manager;
+}
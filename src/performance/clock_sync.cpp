@@ -0,0 +1,49 @@
+#include "performance/clock_sync.h"
+#include <fmt/format.h>
+using namespace std;
+ClockSync::ClockSync() : m_samples{}, m_next(0), m_count(0), m_offset_us(0), m_rtt_us(-1) {}
+void ClockSync::add_sample(int64_t sent_us, int64_t server_in_us, int64_t server_out_us, int64_t received_us) {
+    int64_t rtt = (received_us - sent_us) - (server_out_us - server_in_us);
+    if (received_us < sent_us || rtt < 0) {
+        return;
+    }
+    int64_t offset = ((server_in_us - sent_us) + (server_out_us - received_us)) / 2;
+    lock_guard<mutex> lock(m_mutex);
+    m_samples[m_next] = {offset, rtt};
+    m_next = (m_next + 1) % WINDOW;
+    if (m_count < WINDOW) {
+        m_count++;
+    }
+    // Queueing only ever adds delay, so the fastest round trip carries the
+    // least asymmetry and the tightest error bound.
+    const Sample* best = &m_samples[0];
+    for (size_t i = 1; i < m_count; ++i) {
+        if (m_samples[i].rtt_us < best->rtt_us) {
+            best = &m_samples[i];
+        }
+    }
+    m_offset_us.store(best->offset_us, memory_order_relaxed);
+    m_rtt_us.store(best->rtt_us, memory_order_release);
+}
+size_t ClockSync::samples() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_count;
+}
+string ClockSync::describe() const {
+    if (!synchronized()) {
+        return "not synchronized (no public/get_time samples yet)";
+    }
+    return fmt::format("exchange {:+.3f} ms vs local, ±{:.3f} ms (best RTT of {} samples)",
+                       offset_us() / 1000.0, rtt_us() / 2000.0, samples());
+}
+void ClockSync::reset() {
+    lock_guard<mutex> lock(m_mutex);
+    m_next = 0;
+    m_count = 0;
+    m_offset_us.store(0, memory_order_relaxed);
+    m_rtt_us.store(-1, memory_order_release);
+}
+ClockSync& getClockSync() {
+    static ClockSync clock_sync;
+    return clock_sync;
+}
@@ -0,0 +1,64 @@
+#include "performance/cycle_clock.h"
+#include <thread>
+#include <time.h>
+#include <fmt/format.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+using namespace std;
+namespace {
+    uint64_t monotonicNanos() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    CycleClock::Calibration steadyClock() {
+        return {CycleClock::STEADY_CLOCK, uint64_t(1) << 32, 1.0};
+    }
+
+    CycleClock::Calibration calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+        if (!CycleClock::has_invariant_tsc()) {
+            return steadyClock();
+        }
+        uint64_t wall_begin = monotonicNanos();
+        uint64_t tsc_begin = __rdtsc();
+        this_thread::sleep_for(chrono::milliseconds(10));
+        uint64_t wall_end = monotonicNanos();
+        uint64_t tsc_end = __rdtsc();
+        double ticks_per_nanosecond = static_cast<double>(tsc_end - tsc_begin) / (wall_end - wall_begin);
+        // Anything outside 0.1-10 GHz means the counter cannot be trusted.
+        if (ticks_per_nanosecond < 0.1 || ticks_per_nanosecond > 10.0) {
+            return steadyClock();
+        }
+        uint64_t multiplier = static_cast<uint64_t>(4294967296.0 / ticks_per_nanosecond + 0.5);
+        return {CycleClock::TSC, multiplier, ticks_per_nanosecond};
+#else
+        return steadyClock();
+#endif
+    }
+}
+bool CycleClock::has_invariant_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+const CycleClock::Calibration& CycleClock::calibration() {
+    static const Calibration calibrated = calibrate();
+    return calibrated;
+}
+string CycleClock::describe() {
+    const Calibration& clock = calibration();
+    if (clock.source == TSC) {
+        return fmt::format("invariant TSC @ {:.3f} GHz", clock.ticks_per_nanosecond);
+    }
+    return "steady_clock (no invariant TSC)";
+}
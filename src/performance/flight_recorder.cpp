@@ -0,0 +1,223 @@
+#include "performance/flight_recorder.h"
+#include "performance/cycle_clock.h"
+#include "data_format/symbol_table.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <fmt/format.h>
+using namespace std;
+static_assert(sizeof(FlightRecorder::Event) % sizeof(uint64_t) == 0, "events are copied as whole words");
+namespace {
+    int64_t wallClockMicros() {
+        return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    string formatWallClock(int64_t micros, const char* format) {
+        time_t seconds = static_cast<time_t>(micros / 1000000);
+        tm local;
+        localtime_r(&seconds, &local);
+        char buffer[32];
+        strftime(buffer, sizeof(buffer), format, &local);
+        return buffer;
+    }
+
+    string escapePayload(string_view payload) {
+        string escaped;
+        for (unsigned char c : payload) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += static_cast<char>(c);
+            } else if (c < 0x20 || c >= 0x7f) {
+                escaped += fmt::format("\\x{:02x}", c);
+            } else {
+                escaped += static_cast<char>(c);
+            }
+        }
+        return escaped;
+    }
+}
+FlightRecorder::FlightRecorder()
+    : instance_id([] {
+          static atomic<uint64_t> next_instance{1};
+          return next_instance.fetch_add(1, memory_order_relaxed);
+      }()),
+      m_dump_directory("."),
+      m_base_ticks(CycleClock::now()),
+      m_base_wall_us(wallClockMicros()) {
+    for (auto& enabled : m_enabled) {
+        enabled.store(true, memory_order_relaxed);
+    }
+}
+FlightRecorder::Ring& FlightRecorder::local_ring() {
+    thread_local uint64_t cached_recorder = 0;
+    thread_local Ring* cached_ring = nullptr;
+    if (cached_recorder == instance_id) {
+        return *cached_ring;
+    }
+    lock_guard<mutex> lock(m_rings_mutex);
+    thread::id self = this_thread::get_id();
+    auto it = find_if(m_rings.begin(), m_rings.end(),
+                      [self](const unique_ptr<Ring>& ring) { return ring->owner == self; });
+    if (it == m_rings.end()) {
+        m_rings.push_back(make_unique<Ring>());
+        m_rings.back()->owner = self;
+        m_rings.back()->thread_index = m_rings.size() - 1;
+        it = prev(m_rings.end());
+    }
+    cached_recorder = instance_id;
+    cached_ring = it->get();
+    return *cached_ring;
+}
+void FlightRecorder::record(EventType type, int connection, int64_t id, uint64_t value,
+                            uint32_t channel, string_view payload) {
+    Event event;
+    event.ticks = CycleClock::now();
+    event.value = value;
+    event.id = id;
+    event.channel = channel;
+    event.connection = static_cast<int16_t>(connection);
+    event.type = type;
+    event.length = static_cast<uint8_t>(min(payload.size(), PAYLOAD_BYTES));
+    memcpy(event.payload, payload.data(), event.length);
+    memset(event.payload + event.length, 0, PAYLOAD_BYTES - event.length);
+
+    uint64_t words[WORDS];
+    memcpy(words, &event, sizeof(event));
+    Ring& ring = local_ring();
+    uint64_t index = ring.head.load(memory_order_relaxed);
+    Slot& slot = ring.slots[index % CAPACITY];
+    slot.sequence.store(2 * index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (size_t i = 0; i < WORDS; ++i) {
+        slot.words[i].store(words[i], memory_order_relaxed);
+    }
+    slot.sequence.store(2 * index + 2, memory_order_release);
+    ring.head.store(index + 1, memory_order_release);
+}
+bool FlightRecorder::trigger(Trigger trigger) {
+    if (!enabled(trigger)) {
+        return false;
+    }
+    uint8_t none = 0;
+    m_pending.compare_exchange_strong(none, static_cast<uint8_t>(trigger + 1), memory_order_acq_rel);
+    return true;
+}
+void FlightRecorder::set_slow_callback(chrono::nanoseconds threshold) {
+    threshold = min<chrono::nanoseconds>(max(threshold, chrono::nanoseconds::zero()), MAX_SLOW_CALLBACK);
+    m_slow_callback_ns.store(static_cast<uint64_t>(threshold.count()), memory_order_relaxed);
+}
+void FlightRecorder::set_dump_directory(const string& directory) {
+    lock_guard<mutex> lock(m_dump_mutex);
+    m_dump_directory = directory.empty() ? "." : directory;
+}
+string FlightRecorder::dump_directory() const {
+    lock_guard<mutex> lock(m_dump_mutex);
+    return m_dump_directory;
+}
+string FlightRecorder::flush_pending() {
+    // Take the trigger before dumping so one raised while the dump is written
+    // stays pending for the next flush instead of being cleared with this one.
+    uint8_t pending = m_pending.exchange(0, memory_order_acq_rel);
+    if (pending == 0) {
+        return "";
+    }
+    string path;
+    {
+        lock_guard<mutex> lock(m_dump_mutex);
+        auto now = chrono::steady_clock::now();
+        if (m_dumps.load(memory_order_relaxed) > 0 && now - m_last_dump < DUMP_COOLDOWN) {
+            uint8_t none = 0;
+            m_pending.compare_exchange_strong(none, pending, memory_order_acq_rel);
+            return "";
+        }
+        Trigger reason = static_cast<Trigger>(pending - 1);
+        path = fmt::format("{}/flight-{}-{}.log", m_dump_directory,
+                           formatWallClock(wallClockMicros(), "%Y%m%d-%H%M%S"), trigger_name(reason));
+    }
+    return dump(path, static_cast<Trigger>(pending - 1));
+}
+string FlightRecorder::dump(const string& path, Trigger reason) {
+    vector<Record> records = collect();
+    lock_guard<mutex> lock(m_dump_mutex);
+    m_last_dump = chrono::steady_clock::now();
+    m_dumps.fetch_add(1, memory_order_relaxed);
+    ofstream out(path);
+    if (!out) {
+        return "";
+    }
+    out << fmt::format("# flight recorder dump: reason={} events={} clock={}\n",
+                       trigger_name(reason), records.size(), CycleClock::describe());
+    for (const Record& record : records) {
+        const Event& event = record.event;
+        int64_t offset_us = event.ticks >= m_base_ticks
+            ? static_cast<int64_t>(CycleClock::to_nanos(event.ticks - m_base_ticks) / 1000)
+            : -static_cast<int64_t>(CycleClock::to_nanos(m_base_ticks - event.ticks) / 1000);
+        int64_t wall_us = m_base_wall_us + offset_us;
+        out << fmt::format("{}.{:06d} thread={} conn={} {:<17} id={} value={}",
+                           formatWallClock(wall_us, "%Y-%m-%dT%H:%M:%S"), wall_us % 1000000,
+                           record.thread_index, event.connection, event_name(event.type), event.id, event.value);
+        if (event.channel != NO_CHANNEL) {
+            out << " channel=" << getSymbolTable().name(event.channel);
+        }
+        if (event.length > 0) {
+            out << " payload=\"" << escapePayload(event.text()) << "\"";
+        }
+        out << "\n";
+    }
+    return out ? path : "";
+}
+vector<FlightRecorder::Record> FlightRecorder::collect() const {
+    vector<Record> records;
+    lock_guard<mutex> lock(m_rings_mutex);
+    for (const auto& ring : m_rings) {
+        uint64_t head = ring->head.load(memory_order_acquire);
+        uint64_t first = head > CAPACITY ? head - CAPACITY : 0;
+        for (uint64_t index = first; index < head; ++index) {
+            const Slot& slot = ring->slots[index % CAPACITY];
+            uint64_t before = slot.sequence.load(memory_order_acquire);
+            uint64_t words[WORDS];
+            for (size_t i = 0; i < WORDS; ++i) {
+                words[i] = slot.words[i].load(memory_order_relaxed);
+            }
+            atomic_thread_fence(memory_order_acquire);
+            uint64_t after = slot.sequence.load(memory_order_relaxed);
+            // Skip slots the owner has since overwritten or is writing now.
+            if (before != 2 * index + 2 || after != before) {
+                continue;
+            }
+            Record record;
+            record.thread_index = ring->thread_index;
+            memcpy(&record.event, words, sizeof(record.event));
+            records.push_back(record);
+        }
+    }
+    sort(records.begin(), records.end(), [](const Record& a, const Record& b) {
+        return a.event.ticks < b.event.ticks;
+    });
+    return records;
+}
+const char* FlightRecorder::event_name(EventType type) {
+    static const char* names[] = {
+        "FRAME_DECODED",
+        "REQUEST_SENT",
+        "RESPONSE_RECEIVED",
+        "REQUEST_TIMEOUT",
+        "SEQUENCE_GAP",
+        "PARSE_ERROR",
+        "SLOW_CALLBACK",
+        "CONNECTION_OPEN",
+        "RECONNECT",
+        "CONNECTION_CLOSED",
+        "CONNECTION_ERROR"
+    };
+    return type < sizeof(names) / sizeof(names[0]) ? names[type] : "UNKNOWN";
+}
+const char* FlightRecorder::trigger_name(Trigger trigger) {
+    static const char* names[] = {"slow_callback", "timeout", "reconnect", "sequence_gap", "parse_error", "manual"};
+    return trigger < TRIGGERS ? names[trigger] : "unknown";
+}
+FlightRecorder& getFlightRecorder() {
+    static FlightRecorder recorder;
+    return recorder;
+}
@@ -0,0 +1,85 @@
+#include "performance/latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+using namespace std;
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+size_t LatencyHistogram::bucket_of(uint64_t nanos) {
+    if (nanos < 2 * SUB_BUCKETS) {
+        return static_cast<size_t>(nanos);
+    }
+    int exponent = 63 - __builtin_clzll(nanos);
+    int shift = exponent - SUB_BUCKET_BITS;
+    return static_cast<size_t>(shift) * SUB_BUCKETS + static_cast<size_t>(nanos >> shift);
+}
+uint64_t LatencyHistogram::bucket_floor(size_t bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+    size_t shift = bucket / SUB_BUCKETS - 1;
+    return static_cast<uint64_t>(bucket - shift * SUB_BUCKETS) << shift;
+}
+uint64_t LatencyHistogram::bucket_width(size_t bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return 1;
+    }
+    return uint64_t(1) << (bucket / SUB_BUCKETS - 1);
+}
+void LatencyHistogram::record(uint64_t nanos) {
+    m_counts[bucket_of(nanos)].fetch_add(1, memory_order_relaxed);
+    m_count.fetch_add(1, memory_order_relaxed);
+    m_sum.fetch_add(nanos, memory_order_relaxed);
+    // Each histogram has a single writer thread, so plain load/store is enough
+    // for the extremes.
+    if (nanos < m_min.load(memory_order_relaxed)) m_min.store(nanos, memory_order_relaxed);
+    if (nanos > m_max.load(memory_order_relaxed)) m_max.store(nanos, memory_order_relaxed);
+}
+void LatencyHistogram::reset() {
+    for (auto& count : m_counts) {
+        count.store(0, memory_order_relaxed);
+    }
+    m_count.store(0, memory_order_relaxed);
+    m_sum.store(0, memory_order_relaxed);
+    m_min.store(UINT64_MAX, memory_order_relaxed);
+    m_max.store(0, memory_order_relaxed);
+}
+void LatencyHistogram::snapshot_into(Snapshot& snapshot) const {
+    Snapshot local;
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        local.counts[bucket] = m_counts[bucket].load(memory_order_relaxed);
+        local.count += local.counts[bucket];
+    }
+    local.sum = m_sum.load(memory_order_relaxed);
+    local.min = m_min.load(memory_order_relaxed);
+    local.max = m_max.load(memory_order_relaxed);
+    snapshot.merge(local);
+}
+void LatencyHistogram::Snapshot::merge(const Snapshot& other) {
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        counts[bucket] += other.counts[bucket];
+    }
+    count += other.count;
+    sum += other.sum;
+    if (other.count) {
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+}
+uint64_t LatencyHistogram::Snapshot::percentile(double fraction) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(fraction * count)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            // The top bucket holds the maximum, which is known exactly.
+            if (seen == count) return max;
+            uint64_t midpoint = bucket_floor(bucket) + bucket_width(bucket) / 2;
+            return std::min(std::max(midpoint, min), max);
+        }
+    }
+    return max;
+}
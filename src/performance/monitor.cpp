@@ -1,45 +1,234 @@
 #include "performance/monitor.h"
+#include "performance/clock_sync.h"
+#include "data_format/symbol_table.h"
 #include "helpers/utility.h"
+#include <atomic>
 using namespace std;
+PerformanceMonitor::PerformanceMonitor() : instance_id([] {
+    static atomic<uint64_t> next_instance{1};
+    return next_instance.fetch_add(1, memory_order_relaxed);
+}()) {}
+PerformanceMonitor::ThreadRecorder::ThreadRecorder() {
+    for (auto& window : windows) {
+        window.store(nullptr, memory_order_relaxed);
+    }
+    for (auto& stage : stages) {
+        stage.store(nullptr, memory_order_relaxed);
+    }
+}
+PerformanceMonitor::ThreadRecorder::~ThreadRecorder() {
+    for (auto& window : windows) {
+        delete window.load(memory_order_relaxed);
+    }
+    for (auto& stage : stages) {
+        delete stage.load(memory_order_relaxed);
+    }
+}
+namespace {
+    const char* type_names[] = {
+        "Order Execution",
+        "Market Data Handling", 
+        "WebSocket Communication", 
+        "Trading Cycle Full",
+        "Frame Decode",
+        "Book Update"
+    };
+    const char* stage_names[] = {
+        "Decode",
+        "Dispatch",
+        "Notify",
+        "Render",
+        "Total"
+    };
+    const char* kind_names[] = {
+        "Unknown",
+        "Price Index",
+        "Ticker",
+        "Book",
+        "Trades",
+        "User Orders",
+        "User Trades"
+    };
+    uint64_t second_of(uint64_t ticks) {
+        return CycleClock::to_nanos(ticks) / 1000000000ULL;
+    }
+}
+PerformanceMonitor::ThreadRecorder& PerformanceMonitor::local_recorder() {
+    // Keyed by instance id rather than address so a monitor allocated where a
+    // destroyed one used to live never sees its stale recorder.
+    thread_local uint64_t cached_monitor = 0;
+    thread_local ThreadRecorder* cached_recorder = nullptr;
+    if (cached_monitor == instance_id) {
+        return *cached_recorder;
+    }
+    lock_guard<mutex> lock(recorders_mutex);
+    thread::id self = this_thread::get_id();
+    auto it = find_if(recorders.begin(), recorders.end(),
+                      [self](const unique_ptr<ThreadRecorder>& recorder) { return recorder->owner == self; });
+    if (it == recorders.end()) {
+        recorders.push_back(make_unique<ThreadRecorder>());
+        recorders.back()->owner = self;
+        it = prev(recorders.end());
+    }
+    cached_monitor = instance_id;
+    cached_recorder = it->get();
+    return *cached_recorder;
+}
 void PerformanceMonitor::start_measurement(MeasurementType type, const string& unique_id) {
-    lock_guard<mutex> lock(metrics_mutex);
-    TimingData metric;
-    metric.begin_time = chrono::high_resolution_clock::now();
-    if (unique_id.empty()) {
-        performance_data[type].push_back(metric);
+    ThreadRecorder& recorder = local_recorder();
+    uint64_t begin_time = CycleClock::now();
+    if (!unique_id.empty()) {
+        recorder.keyed[unique_id] = begin_time;
+        return;
+    }
+    size_t& head = recorder.open_head[type];
+    size_t& count = recorder.open_count[type];
+    recorder.open[type][(head + count) % OPEN_MEASUREMENTS] = begin_time;
+    if (count < OPEN_MEASUREMENTS) {
+        count++;
     } else {
-        ongoing_measurements[unique_id] = metric;
+        head = (head + 1) % OPEN_MEASUREMENTS;
     }
 }
 void PerformanceMonitor::stop_measurement(MeasurementType type, const string& unique_id) {
-    lock_guard<mutex> lock(metrics_mutex);
-    auto finish_time = chrono::high_resolution_clock::now();
+    uint64_t finish_time = CycleClock::now();
+    ThreadRecorder& recorder = local_recorder();
+    uint64_t begin_time;
     if (unique_id.empty()) {
-        for (auto& metric : performance_data[type]) {
-            if (!metric.is_complete) {
-                metric.finish_time = finish_time;
-                metric.elapsed_time = chrono::duration_cast<chrono::nanoseconds>(
-                    metric.finish_time - metric.begin_time
-                );
-                metric.is_complete = true;
-                break;
-            }
+        size_t& count = recorder.open_count[type];
+        if (count == 0) {
+            return;
         }
+        size_t& head = recorder.open_head[type];
+        begin_time = recorder.open[type][head];
+        head = (head + 1) % OPEN_MEASUREMENTS;
+        count--;
     } else {
-        auto it = ongoing_measurements.find(unique_id);
-        if (it != ongoing_measurements.end()) {
-            it->second.finish_time = finish_time;
-            it->second.elapsed_time = chrono::duration_cast<chrono::nanoseconds>(
-                it->second.finish_time - it->second.begin_time
-            );
-            it->second.is_complete = true;
-            performance_data[type].push_back(it->second);
-            ongoing_measurements.erase(it);
+        auto it = recorder.keyed.find(unique_id);
+        if (it == recorder.keyed.end()) {
+            return;
+        }
+        begin_time = it->second;
+        recorder.keyed.erase(it);
+    }
+    record_sample(recorder, type, CycleClock::elapsed_nanos(begin_time, finish_time), finish_time);
+}
+void PerformanceMonitor::record(MeasurementType type, chrono::nanoseconds elapsed) {
+    record_sample(local_recorder(), type, static_cast<uint64_t>(max<int64_t>(0, elapsed.count())), CycleClock::now());
+}
+void PerformanceMonitor::record_interval(MeasurementType type, uint64_t begin_ticks, uint64_t end_ticks) {
+    record_sample(local_recorder(), type, CycleClock::elapsed_nanos(begin_ticks, end_ticks), end_ticks);
+}
+void PerformanceMonitor::record_sample(ThreadRecorder& recorder, MeasurementType type, uint64_t nanos, uint64_t now_ticks) {
+    recorder.histograms[type].record(nanos);
+    RollingWindows* windows = recorder.windows[type].load(memory_order_relaxed);
+    if (windows == nullptr) {
+        windows = new RollingWindows();
+        recorder.windows[type].store(windows, memory_order_release);
+    }
+    uint64_t second = second_of(now_ticks);
+    record_window(windows->seconds[second % SECOND_SLOTS], second, nanos);
+    record_window(windows->decades[(second / 10) % DECADE_SLOTS], second / 10, nanos);
+}
+void PerformanceMonitor::record_window(WindowSlot& slot, uint64_t epoch, uint64_t nanos) {
+    // Only the owning thread writes a slot. A reader racing the rollover may
+    // see part of the previous span, which is acceptable for a live view.
+    if (slot.epoch.load(memory_order_relaxed) != epoch) {
+        slot.histogram.reset();
+        slot.epoch.store(epoch, memory_order_release);
+    }
+    slot.histogram.record(nanos);
+}
+LatencyHistogram::Snapshot PerformanceMonitor::snapshot(MeasurementType type, Window window) {
+    LatencyHistogram::Snapshot merged;
+    // A window covers its span of whole units plus the one in progress.
+    uint64_t now = second_of(CycleClock::now());
+    uint64_t oldest = 0;
+    switch (window) {
+        case LAST_1S: oldest = now - min<uint64_t>(now, 1); break;
+        case LAST_10S: oldest = now - min<uint64_t>(now, 10); break;
+        case LAST_60S: oldest = now / 10 - min<uint64_t>(now / 10, 6); break;
+        case LIFETIME: break;
+    }
+    lock_guard<mutex> lock(recorders_mutex);
+    for (const auto& recorder : recorders) {
+        if (window == LIFETIME) {
+            recorder->histograms[type].snapshot_into(merged);
+            continue;
+        }
+        const RollingWindows* windows = recorder->windows[type].load(memory_order_acquire);
+        if (windows == nullptr) continue;
+        const WindowSlot* slots = (window == LAST_60S) ? windows->decades.data() : windows->seconds.data();
+        size_t slot_count = (window == LAST_60S) ? DECADE_SLOTS : SECOND_SLOTS;
+        for (size_t i = 0; i < slot_count; ++i) {
+            uint64_t epoch = slots[i].epoch.load(memory_order_acquire);
+            if (epoch != NO_EPOCH && epoch >= oldest) {
+                slots[i].histogram.snapshot_into(merged);
+            }
+        }
+    }
+    return merged;
+}
+void PerformanceMonitor::record_channel(uint32_t channel_id, chrono::nanoseconds elapsed) {
+    ThreadRecorder& recorder = local_recorder();
+    auto it = recorder.channels.find(channel_id);
+    if (it == recorder.channels.end()) {
+        lock_guard<mutex> lock(recorder.channels_mutex);
+        it = recorder.channels.emplace(channel_id, make_unique<LatencyHistogram>()).first;
+    }
+    it->second->record(static_cast<uint64_t>(max<int64_t>(0, elapsed.count())));
+}
+LatencyHistogram::Snapshot PerformanceMonitor::channel_snapshot(uint32_t channel_id) {
+    LatencyHistogram::Snapshot merged;
+    lock_guard<mutex> lock(recorders_mutex);
+    for (const auto& recorder : recorders) {
+        lock_guard<mutex> channels_lock(recorder->channels_mutex);
+        auto it = recorder->channels.find(channel_id);
+        if (it != recorder->channels.end()) {
+            it->second->snapshot_into(merged);
+        }
+    }
+    return merged;
+}
+vector<uint32_t> PerformanceMonitor::channels() {
+    vector<uint32_t> ids;
+    lock_guard<mutex> lock(recorders_mutex);
+    for (const auto& recorder : recorders) {
+        lock_guard<mutex> channels_lock(recorder->channels_mutex);
+        for (const auto& channel : recorder->channels) {
+            ids.push_back(channel.first);
+        }
+    }
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+void PerformanceMonitor::record_stage(PipelineStage stage, ChannelKind kind, uint64_t begin_ticks, uint64_t end_ticks) {
+    if (begin_ticks == 0) {
+        return;
+    }
+    ThreadRecorder& recorder = local_recorder();
+    atomic<LatencyHistogram*>& slot = recorder.stages[stage * CHANNEL_KINDS + static_cast<size_t>(kind)];
+    LatencyHistogram* histogram = slot.load(memory_order_relaxed);
+    if (histogram == nullptr) {
+        histogram = new LatencyHistogram();
+        slot.store(histogram, memory_order_release);
+    }
+    histogram->record(CycleClock::elapsed_nanos(begin_ticks, end_ticks));
+}
+LatencyHistogram::Snapshot PerformanceMonitor::stage_snapshot(PipelineStage stage, ChannelKind kind) {
+    LatencyHistogram::Snapshot merged;
+    lock_guard<mutex> lock(recorders_mutex);
+    for (const auto& recorder : recorders) {
+        const LatencyHistogram* histogram =
+            recorder->stages[stage * CHANNEL_KINDS + static_cast<size_t>(kind)].load(memory_order_acquire);
+        if (histogram != nullptr) {
+            histogram->snapshot_into(merged);
         }
     }
+    return merged;
 }
 string PerformanceMonitor::generate_report() {
-    lock_guard<mutex> lock(metrics_mutex);
     int terminal_width = utils::getTerminalWidth();
     ostringstream report;
     const string reset_color = "\033[0m";
@@ -50,63 +239,153 @@ string PerformanceMonitor::generate_report() {
     string header = "Performance Benchmarking Report";
     int padding_length = (terminal_width - header.length()) / 2;
     string padding(padding_length, '=');
-    report << header_color << padding << header << padding << reset_color << "\n\n";
-    const char* type_names[] = {
-        "Order Execution",
-        "Market Data Handling", 
-        "WebSocket Communication", 
-        "Trading Cycle Full"
-    };
+    report << header_color << padding << header << padding << reset_color << "\n";
+    report << "Clock: " << CycleClock::describe() << "\n\n";
     int type_col_width = 30;
     int metric_col_width = (terminal_width - type_col_width - 4) / 2;
-    for (int type = 0; type < 4; ++type) {
-        auto metrics = performance_data[static_cast<MeasurementType>(type)];
+    for (size_t type = 0; type < MEASUREMENT_TYPES; ++type) {
+        LatencyHistogram::Snapshot metrics = snapshot(static_cast<MeasurementType>(type));
         if (metrics.empty()) continue;
-        vector<chrono::nanoseconds> durations;
-        for (const auto& metric : metrics) {
-            if (metric.is_complete) {
-                durations.push_back(metric.elapsed_time);
-            }
-        }
-        if (durations.empty()) {
-            report << section_color << type_names[type] << reset_color
-                   << " Latency: No completed measurements\n\n";
-            continue;
-        }
-        sort(durations.begin(), durations.end());
-        auto total_measurements = durations.size();
-        auto mean_duration = accumulate(durations.begin(), durations.end(), 
-            chrono::nanoseconds(0)) / total_measurements;
-        auto percentile_50 = durations[total_measurements * 0.5];
-        auto percentile_90 = durations[total_measurements * 0.9];
-        auto percentile_99 = durations[total_measurements * 0.99];
-        auto min_duration = durations.front();
-        auto max_duration = durations.back();
+        auto total_measurements = metrics.count;
+        double mean_duration = metrics.mean();
+        auto percentile_50 = metrics.percentile(0.5);
+        auto percentile_90 = metrics.percentile(0.9);
+        auto percentile_99 = metrics.percentile(0.99);
+        auto percentile_999 = metrics.percentile(0.999);
+        auto min_duration = metrics.min;
+        auto max_duration = metrics.max;
         report << section_color << left << setw(type_col_width) << type_names[type] 
                << reset_color
                << right 
                << fixed << setprecision(3);
         report << "  " << metric_color << "Meas: " << reset_color << setw(6) << total_measurements 
-               << "  " << metric_color << "Mean: " << reset_color << setw(8) << mean_duration.count() / 1000.0 << " µs\n";
+               << "  " << metric_color << "Mean: " << reset_color << setw(8) << mean_duration / 1000.0 << " µs\n";
         report << string(type_col_width, ' ');
-        report << "  " << metric_color << "Min:  " << reset_color << setw(8) << min_duration.count() / 1000.0 << " µs"
-               << "  " << metric_color << "Max:  " << reset_color << setw(8) << max_duration.count() / 1000.0 << " µs\n";
+        report << "  " << metric_color << "Min:  " << reset_color << setw(8) << min_duration / 1000.0 << " µs"
+               << "  " << metric_color << "Max:  " << reset_color << setw(8) << max_duration / 1000.0 << " µs\n";
         report << string(type_col_width, ' ')
-               << "  " << metric_color << "50th: " << reset_color << setw(8) << percentile_50.count() / 1000.0 << " µs"
-               << "  " << metric_color << "90th: " << reset_color << setw(8) << percentile_90.count() / 1000.0 << " µs"
-               << "  " << metric_color << "99th: " << reset_color << setw(8) << percentile_99.count() / 1000.0 << " µs\n\n";
+               << "  " << metric_color << "50th: " << reset_color << setw(8) << percentile_50 / 1000.0 << " µs"
+               << "  " << metric_color << "90th: " << reset_color << setw(8) << percentile_90 / 1000.0 << " µs"
+               << "  " << metric_color << "99th: " << reset_color << setw(8) << percentile_99 / 1000.0 << " µs"
+               << "  " << metric_color << "99.9th: " << reset_color << setw(8) << percentile_999 / 1000.0 << " µs\n\n";
+    }
+    bool pipeline_header = false;
+    for (size_t kind = 0; kind < CHANNEL_KINDS; ++kind) {
+        array<LatencyHistogram::Snapshot, PIPELINE_STAGES> stages;
+        for (size_t stage = 0; stage < PIPELINE_STAGES; ++stage) {
+            stages[stage] = stage_snapshot(static_cast<PipelineStage>(stage), static_cast<ChannelKind>(kind));
+        }
+        if (stages[STAGE_TOTAL].empty()) continue;
+        if (!pipeline_header) {
+            report << section_color << "Pipeline Breakdown" << reset_color << "  (p50 / p99 µs per stage)\n";
+            report << metric_color << "  " << left << setw(type_col_width - 2) << "Channel";
+            for (const char* name : stage_names) {
+                report << setw(20) << name;
+            }
+            report << reset_color << "\n";
+            pipeline_header = true;
+        }
+        report << "  " << left << setw(type_col_width - 2) << kind_names[kind];
+        for (const auto& metrics : stages) {
+            string cell = metrics.empty() ? "-" : fmt::format("{:.3f} / {:.3f}",
+                metrics.percentile(0.5) / 1000.0, metrics.percentile(0.99) / 1000.0);
+            report << setw(20) << cell;
+        }
+        report << "\n";
+    }
+    if (pipeline_header) {
+        report << "\n";
+    }
+    vector<uint32_t> channel_ids = channels();
+    if (!channel_ids.empty()) {
+        report << section_color << "Exchange → Client" << reset_color << "  (clock: " << getClockSync().describe() << ")\n";
+        for (uint32_t channel_id : channel_ids) {
+            LatencyHistogram::Snapshot metrics = channel_snapshot(channel_id);
+            if (metrics.empty()) continue;
+            report << "  " << left << setw(type_col_width - 2) << getSymbolTable().name(channel_id)
+                   << right << fixed << setprecision(3)
+                   << "  " << metric_color << "Meas: " << reset_color << setw(6) << metrics.count
+                   << "  " << metric_color << "50th: " << reset_color << setw(10) << metrics.percentile(0.5) / 1000.0 << " µs"
+                   << "  " << metric_color << "99th: " << reset_color << setw(10) << metrics.percentile(0.99) / 1000.0 << " µs"
+                   << "  " << metric_color << "Max: " << reset_color << setw(10) << metrics.max / 1000.0 << " µs\n";
+        }
+        report << "\n";
     }
     report << footer_color << string(terminal_width, '=') << reset_color << "\n";
     return report.str();
 }
-map<PerformanceMonitor::MeasurementType, vector<PerformanceMonitor::TimingData>> PerformanceMonitor::get_raw_metrics() {
-    lock_guard<mutex> lock(metrics_mutex);
-    return performance_data;
+string PerformanceMonitor::generate_window_report() {
+    int terminal_width = utils::getTerminalWidth();
+    ostringstream report;
+    const string reset_color = "\033[0m";
+    const string header_color = "\033[1;36m"; 
+    const string section_color = "\033[1;32m"; 
+    const string metric_color = "\033[1;33m"; 
+    const string footer_color = "\033[1;34m"; 
+    string header = "Rolling Latency Windows (µs)";
+    int padding_length = max<int>(0, (terminal_width - static_cast<int>(header.length())) / 2);
+    string padding(padding_length, '=');
+    report << header_color << padding << header << padding << reset_color << "\n";
+    int type_col_width = 30;
+    report << metric_color << left << setw(type_col_width) << "Stage" << setw(8) << "Window"
+           << right << setw(10) << "Count" << setw(12) << "p50" << setw(12) << "p99"
+           << setw(12) << "p99.9" << setw(12) << "Max" << reset_color << "\n";
+    const pair<Window, const char*> windows[] = {{LAST_1S, "1s"}, {LAST_10S, "10s"}, {LAST_60S, "60s"}};
+    bool any = false;
+    for (size_t type = 0; type < MEASUREMENT_TYPES; ++type) {
+        if (snapshot(static_cast<MeasurementType>(type), LAST_60S).empty()) continue;
+        any = true;
+        for (const auto& [window, label] : windows) {
+            LatencyHistogram::Snapshot metrics = snapshot(static_cast<MeasurementType>(type), window);
+            report << section_color << left << setw(type_col_width) << (window == LAST_1S ? type_names[type] : "")
+                   << reset_color << setw(8) << label << right << setw(10) << metrics.count
+                   << fixed << setprecision(3);
+            if (metrics.empty()) {
+                report << setw(12) << "-" << setw(12) << "-" << setw(12) << "-" << setw(12) << "-" << "\n";
+                continue;
+            }
+            report << setw(12) << metrics.percentile(0.5) / 1000.0
+                   << setw(12) << metrics.percentile(0.99) / 1000.0
+                   << setw(12) << metrics.percentile(0.999) / 1000.0
+                   << setw(12) << metrics.max / 1000.0 << "\n";
+        }
+    }
+    if (!any) {
+        report << "No measurements in the last 60 seconds.\n";
+    }
+    report << footer_color << string(terminal_width, '=') << reset_color << "\n";
+    return report.str();
 }
 void PerformanceMonitor::reset() {
-    lock_guard<mutex> lock(metrics_mutex);
-    performance_data.clear();
-    ongoing_measurements.clear();
+    {
+        lock_guard<mutex> lock(recorders_mutex);
+        for (const auto& recorder : recorders) {
+            for (auto& histogram : recorder->histograms) {
+                histogram.reset();
+            }
+            {
+                lock_guard<mutex> channels_lock(recorder->channels_mutex);
+                for (auto& channel : recorder->channels) {
+                    channel.second->reset();
+                }
+            }
+            for (auto& stage : recorder->stages) {
+                if (LatencyHistogram* histogram = stage.load(memory_order_acquire)) {
+                    histogram->reset();
+                }
+            }
+            for (auto& window : recorder->windows) {
+                RollingWindows* windows = window.load(memory_order_acquire);
+                if (windows == nullptr) continue;
+                for (auto& slot : windows->seconds) {
+                    slot.epoch.store(NO_EPOCH, memory_order_release);
+                }
+                for (auto& slot : windows->decades) {
+                    slot.epoch.store(NO_EPOCH, memory_order_release);
+                }
+            }
+        }
+    }
     int terminal_width = utils::getTerminalWidth();
     const string message = "Performance metrics have been reset.";
     int padding_length = (terminal_width - message.length()) / 2;
@@ -1,7 +1,14 @@
 #include <gtest/gtest.h>
 #include "exchange_interface/market_api.h"
+#include "network/subscription_manager.h"
+#include "market_data/instrument_registry.h"
 #include "network/socket_client.h"
 #include "security/credentials.h"
+#include "performance/clock_sync.h"
+#include "performance/monitor.h"
+#include "data_format/symbol_table.h"
+#include "mock/mock_deribit_server.h"
+#include <memory>
 #include <string>
 #include <thread>
 #include <chrono>
@@ -9,26 +16,37 @@
 
 class DeribitApiIntegrationTest : public ::testing::Test {
 protected:
+    static std::unique_ptr<MockDeribitServer> server;
     SocketEndpoint endpoint;
     int connectionId = -1;
 
-    void SetUp() override {
-        
-        channelSubscriptions.clear();
-        AUTHENTICATION_SENT = false;
+    static void SetUpTestSuite() {
+        server.reset(new MockDeribitServer());
+        ASSERT_TRUE(server->start());
+    }
 
-        
-        connectionId = endpoint.connect("wss://test.deribit.com/ws/api/v2");
+    static void TearDownTestSuite() {
+        server.reset();
+    }
 
+    void SetUp() override {
         
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        getSubscriptionManager().clear();
+        AUTHENTICATION_SENT = false;
+        server->set_response_latency(std::chrono::milliseconds(0));
 
         
+        connectionId = endpoint.connect(server->uri());
         ASSERT_NE(connectionId, -1);
         ASSERT_TRUE(endpoint.get_metadata(connectionId));
 
         
-        
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (endpoint.get_metadata(connectionId)->get_status() != "Connected" &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ASSERT_EQ(endpoint.get_metadata(connectionId)->get_status(), "Connected");
     }
 
     void TearDown() override {
@@ -38,11 +56,19 @@ protected:
         }
 
         
-        channelSubscriptions.clear();
+        getSubscriptionManager().clear();
         AUTHENTICATION_SENT = false;
     }
+
+    json call(const std::string& method, const json& params = json::object()) {
+        jsonrpc_request request(method);
+        request["params"] = params;
+        return endpoint.send_async(connectionId, request.dump(), std::chrono::seconds(2)).get();
+    }
 };
 
+std::unique_ptr<MockDeribitServer> DeribitApiIntegrationTest::server;
+
 
 TEST_F(DeribitApiIntegrationTest, PublicEndpoints) {
     
@@ -50,19 +76,17 @@ TEST_F(DeribitApiIntegrationTest, PublicEndpoints) {
     timeRequest["method"] = "public/get_time";
 
     
-    int result = endpoint.send(connectionId, timeRequest.dump());
-    EXPECT_EQ(result, 0);
-
-    
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    json response = endpoint.send_async(connectionId, timeRequest.dump(), std::chrono::seconds(2)).get();
+    EXPECT_EQ(response["id"], timeRequest["id"]);
+    EXPECT_TRUE(response["result"].is_number_integer());
 
     
     auto metadata = endpoint.get_metadata(connectionId);
     ASSERT_TRUE(metadata);
-    EXPECT_GT(metadata->m_received_data.size(), 0);
+    EXPECT_GT(metadata->history().size(), 0);
 
     
-    std::string lastMessage = metadata->m_received_data.back();
+    std::string lastMessage = metadata->history().snapshot().back();
     EXPECT_NE(lastMessage.find("RECEIVED"), std::string::npos);
     EXPECT_NE(lastMessage.find("result"), std::string::npos);
 }
@@ -70,81 +94,182 @@ TEST_F(DeribitApiIntegrationTest, PublicEndpoints) {
 
 TEST_F(DeribitApiIntegrationTest, OrderbookRetrieval) {
     
-    jsonrpc_request orderbookRequest;
-    orderbookRequest["method"] = "public/get_order_book";
-    orderbookRequest["params"] = {
-        {"instrument_name", "BTC-PERPETUAL"},
-        {"depth", 5}
-    };
+    json response = call("public/get_order_book", {{"instrument_name", "BTC-PERPETUAL"}, {"depth", 5}});
 
     
-    int result = endpoint.send(connectionId, orderbookRequest.dump());
-    EXPECT_EQ(result, 0);
+    ASSERT_TRUE(response.contains("result"));
+    EXPECT_EQ(response["result"]["instrument_name"], "BTC-PERPETUAL");
+    EXPECT_EQ(response["result"]["bids"].size(), 5);
+    EXPECT_EQ(response["result"]["asks"].size(), 5);
+    EXPECT_LT(response["result"]["best_bid_price"].get<double>(), response["result"]["best_ask_price"].get<double>());
+}
+
+
+TEST_F(DeribitApiIntegrationTest, InstrumentRegistryLoadsFromServer) {
+    json response = call("public/get_instruments", {{"currency", "any"}, {"expired", false}});
+    ASSERT_TRUE(response.contains("result"));
+
+    InstrumentRegistry registry;
+    EXPECT_EQ(registry.load(response["result"]), 2);
+    InstrumentRegistry::InstrumentInfo info;
+    ASSERT_TRUE(registry.find("ETH-PERPETUAL", info));
+    EXPECT_DOUBLE_EQ(info.tick_size, 0.05);
+    EXPECT_TRUE(registry.is_currency("BTC"));
+}
+
+
+TEST_F(DeribitApiIntegrationTest, OrderLifecycle) {
+    json auth = call("public/auth", {{"grant_type", "client_credentials"}, {"client_id", "id"}, {"client_secret", "secret"}});
+    ASSERT_TRUE(auth.contains("result"));
+    EXPECT_FALSE(auth["result"]["access_token"].get<std::string>().empty());
 
     
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    json buy = call("private/buy", {{"instrument_name", "ETH-PERPETUAL"}, {"amount", 10}, {"price", 2000.5}, {"type", "limit"}});
+    ASSERT_TRUE(buy.contains("result"));
+    std::string order_id = buy["result"]["order"]["order_id"];
+    EXPECT_EQ(buy["result"]["order"]["order_state"], "open");
+
+    json open_orders = call("private/get_open_orders_by_instrument", {{"instrument_name", "ETH-PERPETUAL"}});
+    ASSERT_EQ(open_orders["result"].size(), 1);
 
     
-    auto metadata = endpoint.get_metadata(connectionId);
-    ASSERT_TRUE(metadata);
-    EXPECT_GT(metadata->m_received_data.size(), 0);
+    json edit = call("private/edit", {{"order_id", order_id}, {"amount", 20}, {"price", 2001.0}});
+    EXPECT_EQ(edit["result"]["order"]["amount"], 20);
+
+    json cancel = call("private/cancel", {{"order_id", order_id}});
+    EXPECT_EQ(cancel["result"]["order_state"], "cancelled");
 
     
-    std::string lastMessage = metadata->m_received_data.back();
-    EXPECT_NE(lastMessage.find("RECEIVED"), std::string::npos);
-    EXPECT_NE(lastMessage.find("result"), std::string::npos);
-    EXPECT_NE(lastMessage.find("asks"), std::string::npos);
-    EXPECT_NE(lastMessage.find("bids"), std::string::npos);
+    json missing = call("private/cancel", {{"order_id", order_id}});
+    ASSERT_TRUE(missing.contains("error"));
+    EXPECT_EQ(missing["error"]["code"], 10004);
+
+    
+    json market = call("private/sell", {{"instrument_name", "ETH-PERPETUAL"}, {"amount", 5}, {"type", "market"}});
+    EXPECT_EQ(market["result"]["order"]["order_state"], "filled");
+    json positions = call("private/get_positions", {{"currency", "ETH"}});
+    ASSERT_EQ(positions["result"].size(), 1);
+    EXPECT_EQ(positions["result"][0]["direction"], "sell");
+
+    json cancel_all = call("private/cancel_all");
+    EXPECT_TRUE(cancel_all["result"].is_number());
 }
 
 
 TEST_F(DeribitApiIntegrationTest, SubscriptionHandling) {
     
-    api::registerSubscription("BTC");
+    api::registerSubscription("btc_usd");
 
     
     auto subscriptions = api::getActiveSubscription();
     EXPECT_EQ(subscriptions.size(), 1);
-    EXPECT_EQ(subscriptions[0], "deribit_price_index.BTC");
-
-    
-    jsonrpc_request subscribeRequest;
-    subscribeRequest["method"] = "public/subscribe";
-    subscribeRequest["params"] = {
-        {"channels", subscriptions}
-    };
+    EXPECT_EQ(subscriptions[0], "deribit_price_index.btc_usd");
 
     
-    int result = endpoint.send(connectionId, subscribeRequest.dump());
-    EXPECT_EQ(result, 0);
+    server->set_publish_rate(50);
+    json subscribed = call("public/subscribe", {{"channels", subscriptions}});
+    EXPECT_EQ(subscribed["result"], json(subscriptions));
 
     
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
 
     
     auto metadata = endpoint.get_metadata(connectionId);
     ASSERT_TRUE(metadata);
-    EXPECT_GT(metadata->m_received_data.size(), 0);
-
-    
-    jsonrpc_request unsubscribeRequest;
-    unsubscribeRequest["method"] = "public/unsubscribe";
-    unsubscribeRequest["params"] = {
-        {"channels", subscriptions}
-    };
-
-    
-    result = endpoint.send(connectionId, unsubscribeRequest.dump());
-    EXPECT_EQ(result, 0);
+    bool saw_notification = false;
+    for (const auto& message : metadata->history().snapshot()) {
+        saw_notification = saw_notification || message.find("deribit_price_index.btc_usd") != std::string::npos;
+    }
+    EXPECT_TRUE(saw_notification);
 
     
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    json unsubscribed = call("public/unsubscribe", {{"channels", subscriptions}});
+    EXPECT_TRUE(unsubscribed.contains("result"));
 
     
-    bool removeResult = api::removeActiveSubscription("BTC");
+    bool removeResult = api::removeActiveSubscription("btc_usd");
     EXPECT_TRUE(removeResult);
 
     
     subscriptions = api::getActiveSubscription();
     EXPECT_EQ(subscriptions.size(), 0);
 }
+
+
+TEST_F(DeribitApiIntegrationTest, ShardedPoolSplitsChannels) {
+    std::vector<int> pool = endpoint.open_pool(server->uri(), 2, SocketEndpoint::SHARD_BY_RATE);
+    ASSERT_EQ(pool.size(), 2);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    for (int id : pool) {
+        while (endpoint.get_metadata(id)->get_status() != "Connected" &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ASSERT_EQ(endpoint.get_metadata(id)->get_status(), "Connected");
+    }
+
+    server->set_publish_rate(50);
+    std::string request = api::processRequest("deribit " + std::to_string(pool[0]) + " subscribe btc_usd eth_usd");
+    std::vector<std::future<json>> responses;
+    ASSERT_TRUE(endpoint.send_subscription(pool[0], request, responses));
+    ASSERT_EQ(responses.size(), 2);
+    for (auto& response : responses) {
+        EXPECT_TRUE(response.get().contains("result"));
+    }
+    EXPECT_EQ(getSubscriptionManager().channels_for(pool[0]),
+              std::vector<std::string>{"deribit_price_index.btc_usd"});
+    EXPECT_EQ(getSubscriptionManager().channels_for(pool[1]),
+              std::vector<std::string>{"deribit_price_index.eth_usd"});
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    const char* expected[] = {"deribit_price_index.btc_usd", "deribit_price_index.eth_usd"};
+    for (int shard = 0; shard < 2; shard++) {
+        bool saw_notification = false;
+        for (const auto& message : endpoint.get_metadata(pool[shard])->history().snapshot()) {
+            saw_notification = saw_notification || message.find(expected[shard]) != std::string::npos;
+        }
+        EXPECT_TRUE(saw_notification) << expected[shard];
+    }
+
+    request = api::processRequest("deribit " + std::to_string(pool[0]) + " unsubscribe_all");
+    responses.clear();
+    ASSERT_TRUE(endpoint.send_subscription(pool[0], request, responses));
+    EXPECT_EQ(responses.size(), 2);
+    EXPECT_DOUBLE_EQ(endpoint.pool_load(pool[0]), 0.0);
+    getSubscriptionManager().set_router(nullptr);
+}
+
+
+TEST_F(DeribitApiIntegrationTest, ExchangeLatencyTrackedAfterClockSync) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!getClockSync().synchronized() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(getClockSync().synchronized());
+    // The mock stamps with the local clock at millisecond resolution.
+    EXPECT_LT(std::abs(getClockSync().offset_us()), 2000);
+
+    uint32_t channel = getSymbolTable().intern("deribit_price_index.btc_usd");
+    uint64_t before = getPerformanceMonitor().channel_snapshot(channel).count;
+    server->set_publish_rate(50);
+    json subscribed = call("public/subscribe", {{"channels", {"deribit_price_index.btc_usd"}}});
+    EXPECT_TRUE(subscribed.contains("result"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    call("public/unsubscribe", {{"channels", {"deribit_price_index.btc_usd"}}});
+
+    auto latency = getPerformanceMonitor().channel_snapshot(channel);
+    EXPECT_GT(latency.count, before);
+    EXPECT_LT(latency.max, 1000000000u);
+}
+
+
+TEST_F(DeribitApiIntegrationTest, ConfiguredLatencyDelaysResponses) {
+    server->set_response_latency(std::chrono::milliseconds(50));
+
+    auto started = std::chrono::steady_clock::now();
+    json response = call("public/test");
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    EXPECT_EQ(response["result"]["version"], "1.2.26");
+    EXPECT_GE(elapsed, std::chrono::milliseconds(50));
+}
@@ -84,10 +84,10 @@ TEST_F(WebSocketConnectionTest, DeribitConnection) {
     
     auto metadata = endpoint.get_metadata(connectionId);
     ASSERT_TRUE(metadata);
-    EXPECT_GT(metadata->m_received_data.size(), 0);
+    EXPECT_GT(metadata->history().size(), 0);
 
     
-    std::string lastMessage = metadata->m_received_data.back();
+    std::string lastMessage = metadata->history().snapshot().back();
     EXPECT_NE(lastMessage.find("RECEIVED"), std::string::npos);
     EXPECT_NE(lastMessage.find("result"), std::string::npos);
 
@@ -0,0 +1,364 @@
+#include "mock/mock_deribit_server.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+using namespace std;
+namespace {
+    int64_t nowMillis() {
+        return chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    json errorResponse(const json& request, int code, const string& message) {
+        return {{"jsonrpc", "2.0"}, {"id", request.value("id", json())},
+                {"error", {{"code", code}, {"message", message}}}};
+    }
+
+    string currencyOf(const string& instrument) {
+        return instrument.substr(0, instrument.find('-'));
+    }
+}
+MockDeribitServer::MockDeribitServer() : MockDeribitServer(Config()) {}
+MockDeribitServer::MockDeribitServer(Config config)
+    : m_config(config),
+      m_server(config.port, "127.0.0.1"),
+      m_next_order_id(1),
+      m_index_price(43000.0),
+      m_running(false),
+      m_requests(0),
+      m_notifications(0) {}
+MockDeribitServer::~MockDeribitServer() {
+    stop();
+}
+bool MockDeribitServer::start() {
+    if (m_running.load()) {
+        return true;
+    }
+    m_server.disablePerMessageDeflate();
+    m_server.setOnClientMessageCallback(
+        [this](shared_ptr<ix::ConnectionState>, ix::WebSocket& client, const ix::WebSocketMessagePtr& msg) {
+            on_message(client, msg);
+        });
+    if (!m_server.listen().first) {
+        return false;
+    }
+    m_server.start();
+    m_running = true;
+    m_scheduler = thread([this] { run_scheduler(); });
+    return true;
+}
+void MockDeribitServer::stop() {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    if (m_scheduler.joinable()) {
+        m_scheduler.join();
+    }
+    m_server.stop();
+}
+string MockDeribitServer::uri() const {
+    return "ws://127.0.0.1:" + to_string(m_config.port) + "/ws/api/v2";
+}
+void MockDeribitServer::set_response_latency(chrono::milliseconds latency) {
+    lock_guard<mutex> lock(m_mutex);
+    m_config.response_latency = latency;
+}
+void MockDeribitServer::set_publish_rate(int hz) {
+    lock_guard<mutex> lock(m_mutex);
+    m_config.publish_rate_hz = max(hz, 0);
+}
+size_t MockDeribitServer::open_order_count() {
+    lock_guard<mutex> lock(m_mutex);
+    return count_if(m_orders.begin(), m_orders.end(),
+                    [](const pair<const string, json>& order) { return order.second["order_state"] == "open"; });
+}
+void MockDeribitServer::on_message(ix::WebSocket& client, const ix::WebSocketMessagePtr& msg) {
+    if (msg->type == ix::WebSocketMessageType::Close) {
+        lock_guard<mutex> lock(m_mutex);
+        m_subscriptions.erase(&client);
+        m_delayed.erase(remove_if(m_delayed.begin(), m_delayed.end(),
+                                  [&client](const DelayedResponse& r) { return r.client == &client; }),
+                        m_delayed.end());
+        return;
+    }
+    if (msg->type != ix::WebSocketMessageType::Message) {
+        return;
+    }
+
+    m_requests++;
+    json request = json::parse(msg->str, nullptr, false);
+    json response = request.is_object() ? handle_request(request, &client)
+                                        : errorResponse(json::object(), -32700, "Parse error");
+    string payload = response.dump();
+
+    lock_guard<mutex> lock(m_mutex);
+    if (m_config.response_latency.count() == 0) {
+        client.send(payload);
+    } else {
+        m_delayed.push_back({chrono::steady_clock::now() + m_config.response_latency, &client, move(payload)});
+    }
+}
+json MockDeribitServer::handle_request(const json& request, ix::WebSocket* client) {
+    lock_guard<mutex> lock(m_mutex);
+    string method = request.value("method", "");
+    json params = request.value("params", json::object());
+    json response = {{"jsonrpc", "2.0"}, {"id", request.value("id", json())},
+                     {"usIn", nowMillis() * 1000}, {"usOut", nowMillis() * 1000}, {"usDiff", 0},
+                     {"testnet", true}};
+
+    if (method == "public/auth") {
+        if (!params.contains("client_id")) {
+            return errorResponse(request, 13004, "invalid_credentials");
+        }
+        response["result"] = {{"access_token", "mock-access-token"}, {"refresh_token", "mock-refresh-token"},
+                              {"expires_in", 900}, {"scope", params.value("scope", "connection")},
+                              {"token_type", "bearer"}};
+        return response;
+    }
+    if (method == "public/get_time") {
+        response["result"] = nowMillis();
+        return response;
+    }
+    if (method == "public/test" || method == "public/ping") {
+        response["result"] = method == "public/test" ? json{{"version", "1.2.26"}} : json("pong");
+        return response;
+    }
+    if (method == "public/get_instruments") {
+        string currency = params.value("currency", "any");
+        json instruments = json::array();
+        for (const char* base : {"BTC", "ETH"}) {
+            if (currency != "any" && currency != base) {
+                continue;
+            }
+            bool btc = string(base) == "BTC";
+            instruments.push_back({{"instrument_name", string(base) + "-PERPETUAL"}, {"base_currency", base},
+                                   {"kind", "future"}, {"tick_size", btc ? 0.5 : 0.05},
+                                   {"contract_size", btc ? 10 : 1}, {"min_trade_amount", btc ? 10 : 1},
+                                   {"expiration_timestamp", 32503708800000LL}, {"settlement_period", "perpetual"}});
+        }
+        response["result"] = instruments;
+        return response;
+    }
+    if (method == "public/get_order_book") {
+        if (!params.contains("instrument_name")) {
+            return errorResponse(request, -32602, "Invalid params");
+        }
+        response["result"] = order_book(params["instrument_name"], params.value("depth", 10));
+        return response;
+    }
+
+    if (method == "private/buy" || method == "private/sell") {
+        if (!params.contains("instrument_name") || !params.contains("amount")) {
+            return errorResponse(request, -32602, "Invalid params");
+        }
+        response["result"] = {{"order", create_order(params, method == "private/buy" ? "buy" : "sell")},
+                              {"trades", json::array()}};
+        return response;
+    }
+    if (method == "private/edit") {
+        auto order = m_orders.find(params.value("order_id", ""));
+        if (order == m_orders.end() || order->second["order_state"] != "open") {
+            return errorResponse(request, 10004, "order_not_found");
+        }
+        if (params.contains("amount")) order->second["amount"] = params["amount"];
+        if (params.contains("price")) order->second["price"] = params["price"];
+        order->second["last_update_timestamp"] = nowMillis();
+        response["result"] = {{"order", order->second}, {"trades", json::array()}};
+        return response;
+    }
+    if (method == "private/cancel") {
+        auto order = m_orders.find(params.value("order_id", ""));
+        if (order == m_orders.end() || order->second["order_state"] != "open") {
+            return errorResponse(request, 10004, "order_not_found");
+        }
+        order->second["order_state"] = "cancelled";
+        response["result"] = order->second;
+        return response;
+    }
+    if (method.rfind("private/cancel_all", 0) == 0 || method == "private/cancel_by_label") {
+        int cancelled = 0;
+        for (auto& entry : m_orders) {
+            json& order = entry.second;
+            if (order["order_state"] != "open") continue;
+            if (params.contains("instrument_name") && order["instrument_name"] != params["instrument_name"]) continue;
+            if (params.contains("currency") && currencyOf(order["instrument_name"]) != params["currency"]) continue;
+            if (params.contains("label") && order["label"] != params["label"]) continue;
+            order["order_state"] = "cancelled";
+            cancelled++;
+        }
+        response["result"] = cancelled;
+        return response;
+    }
+    if (method == "private/get_open_orders") {
+        response["result"] = open_orders([](const json&) { return true; });
+        return response;
+    }
+    if (method == "private/get_open_orders_by_instrument") {
+        string instrument = params.value("instrument_name", "");
+        response["result"] = open_orders([&](const json& order) { return order["instrument_name"] == instrument; });
+        return response;
+    }
+    if (method == "private/get_open_orders_by_currency" || method == "private/get_open_orders_by_label") {
+        string currency = params.value("currency", "");
+        string label = params.value("label", "");
+        response["result"] = open_orders([&](const json& order) {
+            return currencyOf(order["instrument_name"]) == currency && (label.empty() || order["label"] == label);
+        });
+        return response;
+    }
+    if (method == "private/get_positions") {
+        string currency = params.value("currency", "");
+        json positions = json::array();
+        for (const auto& position : m_positions) {
+            if (!currency.empty() && currencyOf(position.first) != currency) continue;
+            positions.push_back({{"instrument_name", position.first}, {"size", position.second},
+                                 {"direction", position.second >= 0 ? "buy" : "sell"},
+                                 {"average_price", m_index_price}, {"mark_price", m_index_price},
+                                 {"floating_profit_loss", 0.0}, {"kind", "future"}});
+        }
+        response["result"] = positions;
+        return response;
+    }
+    if (method == "private/subscribe" || method == "public/subscribe") {
+        json channels = params.value("channels", json::array());
+        for (const auto& channel : channels) {
+            m_subscriptions[client].insert(channel.get<string>());
+        }
+        response["result"] = channels;
+        return response;
+    }
+    if (method == "private/unsubscribe" || method == "public/unsubscribe") {
+        json channels = params.value("channels", json::array());
+        for (const auto& channel : channels) {
+            m_subscriptions[client].erase(channel.get<string>());
+        }
+        response["result"] = channels;
+        return response;
+    }
+    if (method == "private/unsubscribe_all" || method == "public/unsubscribe_all") {
+        m_subscriptions.erase(client);
+        response["result"] = "ok";
+        return response;
+    }
+    return errorResponse(request, -32601, "Method not found");
+}
+json MockDeribitServer::create_order(const json& params, const string& direction) {
+    string order_id = "MOCK-" + to_string(m_next_order_id++);
+    string type = params.value("type", "limit");
+    double amount = params["amount"].get<double>();
+    string order_state = type == "market" ? "filled" : "open";
+    json order = {{"order_id", order_id}, {"order_state", order_state}, {"order_type", type},
+                  {"instrument_name", params["instrument_name"]}, {"direction", direction},
+                  {"amount", amount}, {"filled_amount", order_state == "filled" ? amount : 0.0},
+                  {"price", params.value("price", m_index_price)}, {"label", params.value("label", "")},
+                  {"creation_timestamp", nowMillis()}, {"last_update_timestamp", nowMillis()}};
+    if (order_state == "filled") {
+        m_positions[params["instrument_name"]] += direction == "buy" ? amount : -amount;
+    }
+    m_orders[order_id] = order;
+    return order;
+}
+json MockDeribitServer::open_orders(const function<bool(const json&)>& filter) {
+    json orders = json::array();
+    for (const auto& entry : m_orders) {
+        if (entry.second["order_state"] == "open" && filter(entry.second)) {
+            orders.push_back(entry.second);
+        }
+    }
+    return orders;
+}
+json MockDeribitServer::order_book(const string& instrument, int depth) {
+    json bids = json::array();
+    json asks = json::array();
+    for (int level = 0; level < depth; level++) {
+        bids.push_back({m_index_price - 0.5 * (level + 1), 1000.0 * (level + 1)});
+        asks.push_back({m_index_price + 0.5 * (level + 1), 1000.0 * (level + 1)});
+    }
+    return {{"instrument_name", instrument}, {"timestamp", nowMillis()}, {"state", "open"},
+            {"bids", bids}, {"asks", asks},
+            {"best_bid_price", bids.empty() ? 0.0 : bids[0][0].get<double>()},
+            {"best_ask_price", asks.empty() ? 0.0 : asks[0][0].get<double>()},
+            {"index_price", m_index_price}, {"mark_price", m_index_price}, {"change_id", nowMillis()}};
+}
+json MockDeribitServer::notification_for(const string& channel) {
+    json data;
+    if (channel.rfind("deribit_price_index.", 0) == 0) {
+        data = {{"timestamp", nowMillis()}, {"price", m_index_price},
+                {"index_name", channel.substr(strlen("deribit_price_index."))}};
+    } else if (channel.rfind("ticker.", 0) == 0) {
+        string instrument = channel.substr(7, channel.find('.', 7) - 7);
+        data = {{"timestamp", nowMillis()}, {"instrument_name", instrument},
+                {"best_bid_price", m_index_price - 0.5}, {"best_bid_amount", 1000.0},
+                {"best_ask_price", m_index_price + 0.5}, {"best_ask_amount", 1000.0},
+                {"last_price", m_index_price}, {"mark_price", m_index_price}, {"index_price", m_index_price}};
+    } else if (channel.rfind("book.", 0) == 0) {
+        string instrument = channel.substr(5, channel.find('.', 5) - 5);
+        int64_t& change_id = m_change_ids[channel];
+        if (change_id == 0) {
+            json snapshot = order_book(instrument, 10);
+            json bids = json::array();
+            json asks = json::array();
+            for (const auto& level : snapshot["bids"]) bids.push_back({"new", level[0], level[1]});
+            for (const auto& level : snapshot["asks"]) asks.push_back({"new", level[0], level[1]});
+            change_id = 1;
+            data = {{"type", "snapshot"}, {"timestamp", nowMillis()}, {"instrument_name", instrument},
+                    {"change_id", change_id}, {"bids", bids}, {"asks", asks}};
+        } else {
+            int64_t prev_change_id = change_id++;
+            data = {{"type", "change"}, {"timestamp", nowMillis()}, {"instrument_name", instrument},
+                    {"prev_change_id", prev_change_id}, {"change_id", change_id},
+                    {"bids", json::array({json::array({"change", m_index_price - 0.5, 1000.0 + change_id})})},
+                    {"asks", json::array()}};
+        }
+    } else {
+        return json();
+    }
+    return {{"jsonrpc", "2.0"}, {"method", "subscription"}, {"params", {{"channel", channel}, {"data", data}}}};
+}
+bool MockDeribitServer::send_to(ix::WebSocket* client, const string& payload) {
+    for (const auto& connected : m_server.getClients()) {
+        if (connected.get() == client) {
+            return connected->send(payload).success;
+        }
+    }
+    return false;
+}
+void MockDeribitServer::run_scheduler() {
+    auto next_publish = chrono::steady_clock::now();
+    long tick = 0;
+    while (m_running.load()) {
+        auto now = chrono::steady_clock::now();
+        vector<DelayedResponse> due;
+        vector<pair<ix::WebSocket*, string>> notifications;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            auto split = partition(m_delayed.begin(), m_delayed.end(),
+                                   [now](const DelayedResponse& r) { return r.due > now; });
+            move(split, m_delayed.end(), back_inserter(due));
+            m_delayed.erase(split, m_delayed.end());
+
+            if (m_config.publish_rate_hz > 0 && now >= next_publish) {
+                m_index_price += sin(tick++ * 0.3) * 2.5;
+                for (const auto& subscriber : m_subscriptions) {
+                    for (const auto& channel : subscriber.second) {
+                        json notification = notification_for(channel);
+                        if (!notification.is_null()) {
+                            notifications.emplace_back(subscriber.first, notification.dump());
+                        }
+                    }
+                }
+                next_publish = now + chrono::microseconds(1000000 / m_config.publish_rate_hz);
+            }
+        }
+        sort(due.begin(), due.end(), [](const DelayedResponse& a, const DelayedResponse& b) { return a.due < b.due; });
+        for (const auto& response : due) {
+            send_to(response.client, response.payload);
+        }
+        for (const auto& notification : notifications) {
+            if (send_to(notification.first, notification.second)) {
+                m_notifications++;
+            }
+        }
+        this_thread::sleep_for(chrono::microseconds(200));
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef MOCK_DERIBIT_SERVER_H
+#define MOCK_DERIBIT_SERVER_H
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ixwebsocket/IXWebSocketServer.h>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+using namespace std;
+// In-process stand-in for test.deribit.com speaking the JSON-RPC subset the
+// client uses. Responses can be delayed and subscribed channels are published
+// at a configurable rate so latency and throughput tests run without a network.
+class MockDeribitServer {
+public:
+    struct Config {
+        int port = 18765;
+        chrono::milliseconds response_latency{0};
+        int publish_rate_hz = 10;
+    };
+    explicit MockDeribitServer(Config config);
+    MockDeribitServer();
+    ~MockDeribitServer();
+    bool start();
+    void stop();
+    string uri() const;
+    void set_response_latency(chrono::milliseconds latency);
+    void set_publish_rate(int hz);
+    size_t requests_received() const { return m_requests.load(); }
+    size_t notifications_published() const { return m_notifications.load(); }
+    size_t open_order_count();
+    json handle_request(const json& request, ix::WebSocket* client);
+private:
+    struct DelayedResponse {
+        chrono::steady_clock::time_point due;
+        ix::WebSocket* client;
+        string payload;
+    };
+    json create_order(const json& params, const string& direction);
+    json open_orders(const function<bool(const json&)>& filter);
+    json order_book(const string& instrument, int depth);
+    json notification_for(const string& channel);
+    bool send_to(ix::WebSocket* client, const string& payload);
+    void on_message(ix::WebSocket& client, const ix::WebSocketMessagePtr& msg);
+    void run_scheduler();
+    Config m_config;
+    ix::WebSocketServer m_server;
+    mutex m_mutex;
+    map<string, json> m_orders;
+    map<string, double> m_positions;
+    map<ix::WebSocket*, set<string>> m_subscriptions;
+    map<string, int64_t> m_change_ids;
+    vector<DelayedResponse> m_delayed;
+    long m_next_order_id;
+    double m_index_price;
+    atomic<bool> m_running;
+    atomic<size_t> m_requests;
+    atomic<size_t> m_notifications;
+    thread m_scheduler;
+};
+#endif
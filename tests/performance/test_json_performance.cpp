@@ -6,6 +6,7 @@
 #include <iomanip>
 #include <nlohmann/json.hpp>
 #include "data_format/json_parser.hpp"
+#include "data_format/market_data_decoder.h"
 
 using json = nlohmann::json;
 using namespace std::chrono;
@@ -329,6 +330,47 @@ TEST_F(JsonPerformanceTest, ArrayOperationsPerformance) {
 }
 
 
+TEST_F(JsonPerformanceTest, SubscriptionDecodePerformance) {
+    const std::string index_frame = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"deribit_price_index.btc_usd","data":{"timestamp":1700000000123,"price":43250.57,"index_name":"btc_usd"}}})";
+    const std::string book_frame = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.100ms","data":{"type":"change","timestamp":1700000000789,"prev_change_id":100,"instrument_name":"BTC-PERPETUAL","change_id":101,"bids":[["new",43250.5,1200],["change",43250.0,800],["delete",43249.5,0]],"asks":[["new",43251.0,300],["change",43251.5,4500]]}}})";
+    MarketDataFrame frame{};
+
+    {
+        PerformanceTimer timer("Price Index Frame (DOM)", medium_iterations);
+        for (int i = 0; i < medium_iterations; i++) {
+            json parsed = json::parse(index_frame);
+            json data = parsed.value("params", json::object()).value("data", json::object());
+            ASSERT_EQ(data.value("price", 0.0), 43250.57);
+        }
+    }
+
+    {
+        PerformanceTimer timer("Price Index Frame (Decoder)", medium_iterations);
+        for (int i = 0; i < medium_iterations; i++) {
+            ASSERT_TRUE(market_data::decodeSubscription(index_frame, frame));
+            ASSERT_EQ(frame.index.price, 43250.57);
+        }
+    }
+
+    {
+        PerformanceTimer timer("Book Frame (DOM)", medium_iterations);
+        for (int i = 0; i < medium_iterations; i++) {
+            json parsed = json::parse(book_frame);
+            json data = parsed.value("params", json::object()).value("data", json::object());
+            ASSERT_EQ(data["bids"].size(), 3);
+        }
+    }
+
+    {
+        PerformanceTimer timer("Book Frame (Decoder)", medium_iterations);
+        for (int i = 0; i < medium_iterations; i++) {
+            ASSERT_TRUE(market_data::decodeSubscription(book_frame, frame));
+            ASSERT_EQ(frame.bids.size(), 3);
+        }
+    }
+}
+
+
 int main(int argc, char **argv) {
     std::cout << "===== Performance Tests =====" << std::endl;
     std::cout << "Running JSON, WebSocket, and Market API performance tests...\n" << std::endl;
@@ -5,7 +5,15 @@
 #include <iostream>
 #include <iomanip>
 #include "exchange_interface/market_api.h"
+#include "network/subscription_manager.h"
 #include "network/socket_client.h"
+#include "market_data/order_book.h"
+#include "market_data/market_data_manager.h"
+#include "performance/monitor.h"
+#include "performance/scoped_probe.h"
+#include "performance/cycle_clock.h"
+#include "performance/flight_recorder.h"
+#include <thread>
 
 using namespace std::chrono;
 
@@ -44,12 +52,12 @@ protected:
 
     void SetUp() override {
         
-        channelSubscriptions.clear();
+        getSubscriptionManager().clear();
     }
 
     void TearDown() override {
         
-        channelSubscriptions.clear();
+        getSubscriptionManager().clear();
     }
 };
 
@@ -170,3 +178,165 @@ TEST_F(MarketApiPerformanceTest, RequestProcessingPerformance) {
 }
 
 
+
+
+TEST_F(MarketApiPerformanceTest, OrderBookDeltaAndQueryPerformance) {
+    OrderBook book("BTC-PERPETUAL", InstrumentScale::from_double(0.5, 10));
+    BookUpdateHeader header{};
+    header.is_snapshot = true;
+    header.change_id = 1;
+    std::vector<BookLevelUpdate> bids;
+    std::vector<BookLevelUpdate> asks;
+    for (int i = 0; i < 500; i++) {
+        bids.push_back({BookAction::New, Decimal{500000 - i * 5, -1}, Decimal{100 + i, 1}});
+        asks.push_back({BookAction::New, Decimal{500005 + i * 5, -1}, Decimal{100 + i, 1}});
+    }
+    ASSERT_EQ(book.apply(header, bids, asks), OrderBook::SNAPSHOT_APPLIED);
+
+    header.is_snapshot = false;
+    {
+        PerformanceTimer timer("Order Book Delta (3 levels)", validation_iterations);
+        for (int i = 0; i < validation_iterations; i++) {
+            header.prev_change_id = header.change_id;
+            header.change_id++;
+            int64_t offset = (i % 20) * 5;
+            bids.assign({{BookAction::Change, Decimal{500000 - offset, -1}, Decimal{10 + i, 1}},
+                         {BookAction::Delete, Decimal{499900 - offset, -1}, Decimal{0, 0}},
+                         {BookAction::New, Decimal{499900 - offset, -1}, Decimal{5, 1}}});
+            asks.assign({{BookAction::Change, Decimal{500005 + offset, -1}, Decimal{10 + i, 1}}});
+            ASSERT_EQ(book.apply(header, bids, asks), OrderBook::APPLIED);
+        }
+    }
+
+    int64_t total = 0;
+    {
+        PerformanceTimer timer("Order Book Best Bid/Ask + Depth", validation_iterations);
+        OrderBook::Level bid;
+        OrderBook::Level ask;
+        for (int i = 0; i < validation_iterations; i++) {
+            book.best_bid(bid);
+            book.best_ask(ask);
+            total += ask.price.ticks - bid.price.ticks + book.bid(i % 10).amount.lots + book.bid_depth();
+        }
+    }
+    EXPECT_GT(total, 0);
+
+    char price_text[32];
+    char amount_text[32];
+    {
+        PerformanceTimer timer("Order Book Level Formatting", validation_iterations);
+        for (int i = 0; i < validation_iterations; i++) {
+            book.scale().format(book.bid(i % 10).price, price_text, sizeof(price_text));
+            book.scale().format(book.bid(i % 10).amount, amount_text, sizeof(amount_text));
+        }
+    }
+    EXPECT_STRNE(price_text, "");
+}
+
+
+TEST_F(MarketApiPerformanceTest, MarketDataManagerApplyPerformance) {
+    for (int instruments : {1, 64}) {
+        MarketDataManager manager;
+        std::vector<MarketEvent> events(instruments);
+        for (int i = 0; i < instruments; i++) {
+            events[i].kind = ChannelKind::PriceIndex;
+            events[i].index.index_name.assign("index_" + std::to_string(i) + "_usd");
+            events[i].index.symbol = getSymbolTable().intern("index_" + std::to_string(i) + "_usd");
+            events[i].index.price = 100.0 + i;
+        }
+        {
+            PerformanceTimer timer("Market Data Apply (" + std::to_string(instruments) + " instruments)",
+                                   validation_iterations * 10);
+            for (int i = 0; i < validation_iterations * 10; i++) {
+                MarketEvent& event = events[i % instruments];
+                event.index.price += 0.5;
+                manager.apply(event);
+            }
+        }
+        EXPECT_EQ(manager.size(), instruments);
+    }
+}
+
+
+TEST_F(MarketApiPerformanceTest, PerformanceMonitorRecordingPerformance) {
+    auto& monitor = getPerformanceMonitor();
+    monitor.reset();
+    CycleClock::calibration();
+    {
+        PerformanceTimer timer("Monitor Start/Stop (unkeyed)", validation_iterations * 10);
+        for (int i = 0; i < validation_iterations * 10; i++) {
+            monitor.start_measurement(PerformanceMonitor::TRADING_CYCLE_FULL);
+            monitor.stop_measurement(PerformanceMonitor::TRADING_CYCLE_FULL);
+        }
+    }
+    {
+        PerformanceTimer timer("Monitor Record (4 threads)", validation_iterations * 10);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&monitor, this] {
+                for (int i = 0; i < validation_iterations * 10 / 4; i++) {
+                    monitor.record(PerformanceMonitor::MARKET_DATA_HANDLING, nanoseconds(i));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    {
+        PerformanceTimer timer("Monitor Start/Stop (keyed)", validation_iterations * 10);
+        for (int i = 0; i < validation_iterations * 10; i++) {
+            monitor.start_measurement(PerformanceMonitor::WEBSOCKET_COMMUNICATION, "websocket_message_" + std::to_string(i % 4));
+            monitor.stop_measurement(PerformanceMonitor::WEBSOCKET_COMMUNICATION, "websocket_message_" + std::to_string(i % 4));
+        }
+    }
+    {
+        PerformanceTimer timer("Scoped Probe", validation_iterations * 10);
+        for (int i = 0; i < validation_iterations * 10; i++) {
+            DERIBIT_PROBE(FRAME_DECODE);
+        }
+    }
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::TRADING_CYCLE_FULL).count, validation_iterations * 10);
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::MARKET_DATA_HANDLING).count, validation_iterations * 10);
+    monitor.reset();
+}
+
+
+TEST_F(MarketApiPerformanceTest, ClockSourceReadPerformance) {
+    std::cout << "Clock source: " << CycleClock::describe() << std::endl;
+    uint64_t sink = 0;
+    {
+        PerformanceTimer timer("steady_clock::now", validation_iterations * 10);
+        for (int i = 0; i < validation_iterations * 10; i++) {
+            sink += steady_clock::now().time_since_epoch().count();
+        }
+    }
+    {
+        PerformanceTimer timer("CycleClock::now", validation_iterations * 10);
+        for (int i = 0; i < validation_iterations * 10; i++) {
+            sink += CycleClock::now();
+        }
+    }
+    EXPECT_NE(sink, 0u);
+}
+
+
+TEST_F(MarketApiPerformanceTest, FlightRecorderRecordPerformance) {
+    FlightRecorder recorder;
+    for (size_t i = 0; i < FlightRecorder::CAPACITY; i++) {
+        recorder.record(FlightRecorder::FRAME_DECODED, 0);
+    }
+    {
+        PerformanceTimer timer("FlightRecorder::record", validation_iterations * 10);
+        for (int i = 0; i < validation_iterations * 10; i++) {
+            recorder.record(FlightRecorder::FRAME_DECODED, 0, i, 512, 7);
+        }
+    }
+    {
+        PerformanceTimer timer("FlightRecorder::record (with payload)", validation_iterations * 10);
+        for (int i = 0; i < validation_iterations * 10; i++) {
+            recorder.record(FlightRecorder::REQUEST_SENT, 0, i, 512, FlightRecorder::NO_CHANNEL, "private/buy");
+        }
+    }
+    EXPECT_EQ(recorder.collect().size(), FlightRecorder::CAPACITY);
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include "performance/clock_sync.h"
+
+
+TEST(ClockSyncTest, SymmetricRoundTripRecoversOffset) {
+    ClockSync sync;
+    EXPECT_FALSE(sync.synchronized());
+
+    // Exchange runs 5 ms ahead; 400 us each way, 100 us inside the server.
+    int64_t sent = 1000000;
+    sync.add_sample(sent, sent + 5000 + 400, sent + 5000 + 500, sent + 900);
+    ASSERT_TRUE(sync.synchronized());
+    EXPECT_EQ(sync.offset_us(), 5000);
+    EXPECT_EQ(sync.rtt_us(), 800);
+    EXPECT_EQ(sync.exchange_to_local_us(10, 10000 - 5000 + 1200), 1200);
+}
+
+
+TEST(ClockSyncTest, FastestRoundTripWinsWithinWindow) {
+    ClockSync sync;
+    // A slow, asymmetric sample skews the offset; a later fast one replaces it.
+    sync.add_sample(0, 9000, 9000, 10000);
+    EXPECT_EQ(sync.offset_us(), 4000);
+    sync.add_sample(20000, 20100, 20100, 20200);
+    EXPECT_EQ(sync.offset_us(), 0);
+    EXPECT_EQ(sync.rtt_us(), 200);
+
+    // Once the fast sample ages out of the window the best remaining one is used.
+    for (size_t i = 0; i < ClockSync::WINDOW; i++) {
+        int64_t sent = 100000 + static_cast<int64_t>(i) * 10000;
+        sync.add_sample(sent, sent + 350, sent + 350, sent + 500 + static_cast<int64_t>(i));
+    }
+    EXPECT_EQ(sync.samples(), ClockSync::WINDOW);
+    EXPECT_EQ(sync.rtt_us(), 500);
+    EXPECT_EQ(sync.offset_us(), 100);
+
+    sync.add_sample(10, 0, 0, 5);
+    EXPECT_EQ(sync.rtt_us(), 500);
+    sync.reset();
+    EXPECT_FALSE(sync.synchronized());
+}
+
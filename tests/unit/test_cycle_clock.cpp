@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+#include "performance/cycle_clock.h"
+#include <chrono>
+#include <thread>
+
+
+TEST(CycleClockTest, CalibrationIsConsistentWithSource) {
+    const auto& clock = CycleClock::calibration();
+    if (clock.source == CycleClock::TSC) {
+        EXPECT_TRUE(CycleClock::has_invariant_tsc());
+        EXPECT_GT(clock.ticks_per_nanosecond, 0.1);
+        EXPECT_LT(clock.ticks_per_nanosecond, 10.0);
+        EXPECT_NE(CycleClock::describe().find("TSC"), std::string::npos);
+    } else {
+        EXPECT_EQ(CycleClock::to_nanos(123456789), 123456789u);
+        EXPECT_NE(CycleClock::describe().find("steady_clock"), std::string::npos);
+    }
+}
+
+
+TEST(CycleClockTest, ElapsedMatchesSteadyClock) {
+    auto wall_begin = std::chrono::steady_clock::now();
+    uint64_t begin = CycleClock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t end = CycleClock::now();
+    auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wall_begin);
+
+    double measured = static_cast<double>(CycleClock::elapsed_nanos(begin, end));
+    EXPECT_NEAR(measured, static_cast<double>(wall.count()), wall.count() * 0.05);
+    EXPECT_EQ(CycleClock::elapsed_nanos(end, begin), 0u);
+}
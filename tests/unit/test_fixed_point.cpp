@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "data_format/fixed_point.h"
+#include <string>
+
+
+static Decimal decimal(const char* text) {
+    Decimal value{0, 0};
+    EXPECT_TRUE(Decimal::parse(text, value)) << text;
+    return value;
+}
+
+static std::string format(const InstrumentScale& scale, Price price) {
+    char buffer[32];
+    size_t length = scale.format(price, buffer, sizeof(buffer));
+    return std::string(buffer, length);
+}
+
+
+TEST(FixedPointTest, ParsesDecimalTextExactly) {
+    Decimal value = decimal("43250.50");
+    EXPECT_EQ(value.mantissa, 432505);
+    EXPECT_EQ(value.exponent, -1);
+
+    value = decimal("-0.00012");
+    EXPECT_EQ(value.mantissa, -12);
+    EXPECT_EQ(value.exponent, -5);
+
+    value = decimal("1.5e3");
+    EXPECT_EQ(value.mantissa, 15);
+    EXPECT_EQ(value.exponent, 2);
+
+    value = decimal("0");
+    EXPECT_EQ(value.mantissa, 0);
+
+    Decimal rejected{0, 0};
+    EXPECT_FALSE(Decimal::parse("", rejected));
+    EXPECT_FALSE(Decimal::parse("12a", rejected));
+}
+
+TEST(FixedPointTest, ScalesToTicksAndLots) {
+    InstrumentScale scale(decimal("0.5"), decimal("10"));
+    EXPECT_EQ(scale.to_price(decimal("43250.5")).ticks, 86501);
+    EXPECT_EQ(scale.to_price(decimal("43250")).ticks, 86500);
+    EXPECT_EQ(scale.to_qty(decimal("1200")).lots, 120);
+    EXPECT_EQ(scale.to_price(43250.5).ticks, 86501);
+    EXPECT_DOUBLE_EQ(scale.to_double(Price{86501}), 43250.5);
+
+    InstrumentScale eth = InstrumentScale::from_double(0.05, 1);
+    EXPECT_EQ(eth.to_price(decimal("0.1")), eth.to_price(decimal("0.10")));
+    EXPECT_EQ(eth.to_price(decimal("2250.05")).ticks, 45001);
+}
+
+TEST(FixedPointTest, FormatsWithoutAllocating) {
+    InstrumentScale scale(decimal("0.5"), decimal("10"));
+    EXPECT_EQ(format(scale, Price{86501}), "43250.5");
+    EXPECT_EQ(format(scale, Price{86500}), "43250");
+
+    InstrumentScale fine;
+    EXPECT_EQ(format(fine, fine.to_price(decimal("0.00012"))), "0.00012");
+    EXPECT_EQ(format(fine, fine.to_price(decimal("-7.25"))), "-7.25");
+
+    char small[4];
+    EXPECT_EQ(scale.format(Price{86501}, small, sizeof(small)), 3);
+    EXPECT_STREQ(small, "432");
+}
+
+TEST(FixedPointTest, FormatsExtremeScalesWithinBuffer) {
+    char buffer[80];
+    InstrumentScale huge(decimal("999999999999999999e18"), decimal("1"));
+    size_t length = huge.format(Price{INT64_MAX}, buffer, sizeof(buffer));
+    EXPECT_EQ(std::string(buffer, length), "9223372036854775797776627963145224193000000000000000000");
+
+    InstrumentScale tiny(decimal("1e-18"), decimal("1"));
+    length = tiny.format(Price{-1}, buffer, sizeof(buffer));
+    EXPECT_EQ(std::string(buffer, length), "-0.000000000000000001");
+}
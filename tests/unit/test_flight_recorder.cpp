@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "performance/flight_recorder.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+TEST(FlightRecorderTest, KeepsTheLastEventsPerThreadInOrder) {
+    FlightRecorder recorder;
+    for (size_t i = 0; i < FlightRecorder::CAPACITY + 10; i++) {
+        recorder.record(FlightRecorder::FRAME_DECODED, 3, static_cast<int64_t>(i), i * 2);
+    }
+    recorder.record(FlightRecorder::REQUEST_SENT, 3, 99, 0, FlightRecorder::NO_CHANNEL,
+                    "private/buy-with-a-method-name-longer-than-the-payload");
+
+    std::vector<FlightRecorder::Record> records = recorder.collect();
+    ASSERT_EQ(records.size(), FlightRecorder::CAPACITY);
+    EXPECT_EQ(records.front().event.id, 11);
+    EXPECT_EQ(records.front().event.value, 22u);
+    EXPECT_EQ(records.front().event.connection, 3);
+    for (size_t i = 1; i < records.size(); i++) {
+        EXPECT_LE(records[i - 1].event.ticks, records[i].event.ticks);
+    }
+    const FlightRecorder::Event& last = records.back().event;
+    EXPECT_EQ(last.type, FlightRecorder::REQUEST_SENT);
+    EXPECT_EQ(last.text(), "private/buy-with-a-metho");
+}
+
+
+TEST(FlightRecorderTest, ThreadsRecordIntoTheirOwnRings) {
+    FlightRecorder recorder;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&recorder, t] {
+            for (int i = 0; i < 500; i++) {
+                recorder.record(FlightRecorder::FRAME_DECODED, t, i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<FlightRecorder::Record> records = recorder.collect();
+    EXPECT_EQ(records.size(), 2000);
+    std::vector<int> per_connection(4, 0);
+    for (const auto& record : records) {
+        per_connection[record.event.connection]++;
+    }
+    EXPECT_EQ(per_connection, std::vector<int>(4, 500));
+}
+
+
+TEST(FlightRecorderTest, TriggersFlagADumpThatFlushWrites) {
+    FlightRecorder recorder;
+    recorder.set_slow_callback(std::chrono::microseconds(100));
+    EXPECT_FALSE(recorder.is_slow(99999));
+    EXPECT_TRUE(recorder.is_slow(100000));
+    recorder.set_slow_callback(std::chrono::hours(24));
+    EXPECT_EQ(recorder.slow_callback_ns(),
+              static_cast<uint64_t>(std::chrono::nanoseconds(FlightRecorder::MAX_SLOW_CALLBACK).count()));
+    recorder.set_slow_callback(std::chrono::microseconds(100));
+
+    recorder.set_enabled(FlightRecorder::TRIGGER_RECONNECT, false);
+    EXPECT_FALSE(recorder.trigger(FlightRecorder::TRIGGER_RECONNECT));
+    EXPECT_FALSE(recorder.pending());
+    EXPECT_EQ(recorder.flush_pending(), "");
+
+    recorder.record(FlightRecorder::REQUEST_TIMEOUT, 1, 42, 0, FlightRecorder::NO_CHANNEL, "public/get_time");
+    EXPECT_TRUE(recorder.trigger(FlightRecorder::TRIGGER_TIMEOUT));
+    EXPECT_TRUE(recorder.pending());
+    std::string path = recorder.flush_pending();
+    ASSERT_FALSE(path.empty());
+    EXPECT_NE(path.find("timeout"), std::string::npos);
+    EXPECT_FALSE(recorder.pending());
+    EXPECT_EQ(recorder.dumps(), 1u);
+
+    std::ifstream in(path);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    EXPECT_NE(contents.str().find("reason=timeout events=1"), std::string::npos);
+    EXPECT_NE(contents.str().find("REQUEST_TIMEOUT"), std::string::npos);
+    EXPECT_NE(contents.str().find("id=42"), std::string::npos);
+    EXPECT_NE(contents.str().find("payload=\"public/get_time\""), std::string::npos);
+    std::remove(path.c_str());
+
+    // A second trigger inside the cooldown waits instead of dumping again.
+    recorder.trigger(FlightRecorder::TRIGGER_TIMEOUT);
+    EXPECT_EQ(recorder.flush_pending(), "");
+    EXPECT_TRUE(recorder.pending());
+}
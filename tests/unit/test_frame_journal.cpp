@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include "network/frame_journal.h"
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+
+
+class FrameJournalTest : public ::testing::Test {
+protected:
+    const std::string path = "frame_journal_test.bin";
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+
+    static long long fileSize(const std::string& file) {
+        struct stat info;
+        return stat(file.c_str(), &info) == 0 ? info.st_size : -1;
+    }
+};
+
+
+TEST_F(FrameJournalTest, RoundTripsFramesInOrder) {
+    {
+        FrameJournalWriter writer;
+        ASSERT_TRUE(writer.open(path, 4096));
+        writer.append(MessageHistory::SENT, 3, R"({"id":1,"method":"public/test"})", 1000);
+        writer.append(MessageHistory::RECEIVED, 3, R"({"id":1,"result":{}})", 2000);
+        writer.append(MessageHistory::RECEIVED, 4, "", 3000);
+        EXPECT_EQ(writer.frames_written(), 3);
+    }
+
+    FrameJournalReader reader;
+    ASSERT_TRUE(reader.open(path));
+    JournalFrame frame;
+
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.timestamp_ns, 1000);
+    EXPECT_EQ(frame.connection_id, 3);
+    EXPECT_EQ(frame.direction, MessageHistory::SENT);
+    EXPECT_EQ(frame.payload, R"({"id":1,"method":"public/test"})");
+
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.direction, MessageHistory::RECEIVED);
+    EXPECT_EQ(frame.payload, R"({"id":1,"result":{}})");
+
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.connection_id, 4);
+    EXPECT_TRUE(frame.payload.empty());
+
+    EXPECT_FALSE(reader.next(frame));
+
+    reader.rewind();
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.timestamp_ns, 1000);
+}
+
+
+TEST_F(FrameJournalTest, PreallocatesAndTrimsOnClose) {
+    FrameJournalWriter writer;
+    ASSERT_TRUE(writer.open(path, 1 << 20));
+    EXPECT_GE(fileSize(path), 1 << 20);
+
+    writer.append(MessageHistory::RECEIVED, 0, "payload", 1);
+    writer.close();
+    EXPECT_EQ(fileSize(path), static_cast<long long>(writer.bytes_written()));
+    EXPECT_LT(fileSize(path), 1 << 20);
+}
+
+
+TEST_F(FrameJournalTest, ReadsUnclosedJournalUpToLastFlush) {
+    FrameJournalWriter writer;
+    ASSERT_TRUE(writer.open(path, 1 << 16));
+    writer.append(MessageHistory::RECEIVED, 1, "first", 10);
+    writer.append(MessageHistory::RECEIVED, 1, "second", 20);
+    writer.flush();
+
+    FrameJournalReader reader;
+    ASSERT_TRUE(reader.open(path));
+    JournalFrame frame;
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.payload, "first");
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.payload, "second");
+    EXPECT_FALSE(reader.next(frame));
+}
+
+
+TEST_F(FrameJournalTest, AppendDefersFileWritesUntilFlush) {
+    FrameJournalWriter writer;
+    ASSERT_TRUE(writer.open(path, 1 << 16));
+    writer.append(MessageHistory::RECEIVED, 1, "buffered", 10);
+
+    FrameJournalReader reader;
+    JournalFrame frame;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_FALSE(reader.next(frame));
+
+    writer.flush();
+    ASSERT_TRUE(reader.open(path));
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.payload, "buffered");
+    EXPECT_EQ(writer.write_failures(), 0);
+}
+
+
+TEST_F(FrameJournalTest, CountsFramesItCannotRecord) {
+    FrameJournalWriter writer;
+    ASSERT_TRUE(writer.open(path, 4096));
+    writer.append(MessageHistory::RECEIVED, 65535, "last id", 1);
+    writer.append(MessageHistory::RECEIVED, 65536, "too wide", 2);
+    writer.append(MessageHistory::RECEIVED, -1, "replay", 3);
+    EXPECT_EQ(writer.frames_written(), 1);
+    EXPECT_EQ(writer.frames_dropped(), 2);
+    writer.close();
+
+    writer.append(MessageHistory::RECEIVED, 1, "after close", 4);
+    EXPECT_EQ(writer.frames_written(), 1);
+
+    FrameJournalReader reader;
+    JournalFrame frame;
+    ASSERT_TRUE(reader.open(path));
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.connection_id, 65535);
+    EXPECT_FALSE(reader.next(frame));
+}
+
+
+TEST_F(FrameJournalTest, GrowsPastPreallocationForLargeFrames) {
+    const std::string large(600 * 1024, 'x');
+    {
+        FrameJournalWriter writer;
+        ASSERT_TRUE(writer.open(path, 4096));
+        writer.append(MessageHistory::RECEIVED, 2, "small", 1);
+        writer.append(MessageHistory::RECEIVED, 2, large, 2);
+        writer.append(MessageHistory::SENT, 2, "tail", 3);
+    }
+
+    FrameJournalReader reader;
+    ASSERT_TRUE(reader.open(path));
+    JournalFrame frame;
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.payload, "small");
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.payload.size(), large.size());
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.payload, "tail");
+}
+
+
+TEST_F(FrameJournalTest, RejectsForeignFiles) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    std::fputs("this is not a frame journal at all", file);
+    std::fclose(file);
+
+    FrameJournalReader reader;
+    EXPECT_FALSE(reader.open(path));
+    EXPECT_FALSE(reader.open("missing_frame_journal.bin"));
+}
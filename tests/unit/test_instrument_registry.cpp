@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include "market_data/instrument_registry.h"
+#include "market_data/order_book.h"
+#include "exchange_interface/market_api.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+
+class InstrumentRegistryTest : public ::testing::Test {
+protected:
+    const std::string path = "instrument_registry_test.cache";
+    InstrumentRegistry registry;
+
+    json instruments() {
+        return json::parse(R"([
+            {"instrument_name":"BTC-PERPETUAL","base_currency":"BTC","kind":"future","tick_size":0.5,
+             "contract_size":10,"min_trade_amount":10,"expiration_timestamp":32503708800000},
+            {"instrument_name":"ETH-27DEC30-4000-C","base_currency":"ETH","kind":"option","tick_size":0.0005,
+             "contract_size":1,"min_trade_amount":1,"expiration_timestamp":1924588800000},
+            {"instrument_name":"BTC-29MAR24","base_currency":"BTC","kind":"future","tick_size":2.5,
+             "contract_size":10,"min_trade_amount":10,"expiration_timestamp":1711699200000}
+        ])");
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+        getInstrumentRegistry().clear();
+    }
+};
+
+
+TEST_F(InstrumentRegistryTest, LoadsInstrumentMetadata) {
+    EXPECT_EQ(registry.load(instruments()), 3);
+    EXPECT_EQ(registry.size(), 3);
+    EXPECT_TRUE(registry.contains("BTC-PERPETUAL"));
+    EXPECT_FALSE(registry.contains("SOL-PERPETUAL"));
+
+    InstrumentRegistry::InstrumentInfo info;
+    ASSERT_TRUE(registry.find("ETH-27DEC30-4000-C", info));
+    EXPECT_EQ(info.kind, InstrumentRegistry::OPTION);
+    EXPECT_DOUBLE_EQ(info.tick_size, 0.0005);
+    EXPECT_EQ(info.base_currency, "ETH");
+    EXPECT_TRUE(registry.is_currency("BTC"));
+    EXPECT_FALSE(registry.is_currency("XRP"));
+    EXPECT_EQ(registry.currencies().size(), 2);
+}
+
+TEST_F(InstrumentRegistryTest, FeedsTickSizesToOrderBooks) {
+    registry.load(instruments());
+    MarketDataFrame frame{};
+    ASSERT_TRUE(market_data::decodeSubscription(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.100ms","data":{"type":"snapshot","timestamp":1,"instrument_name":"BTC-PERPETUAL","change_id":1,"bids":[["new",43000.5,1200]],"asks":[]}}})",
+        frame));
+    getOrderBookManager().apply(frame);
+
+    OrderBook book;
+    ASSERT_TRUE(getOrderBookManager().snapshot("BTC-PERPETUAL", book));
+    EXPECT_EQ(book.bid(0).price.ticks, 86001);
+    EXPECT_EQ(book.bid(0).amount.lots, 120);
+    getOrderBookManager().clear();
+}
+
+TEST_F(InstrumentRegistryTest, CacheRoundTripDropsExpiredInstruments) {
+    registry.load(instruments());
+    ASSERT_TRUE(registry.save(path));
+
+    InstrumentRegistry restored;
+    EXPECT_EQ(restored.load_cache(path), 2);
+    EXPECT_TRUE(restored.contains("BTC-PERPETUAL"));
+    EXPECT_TRUE(restored.contains("ETH-27DEC30-4000-C"));
+    EXPECT_FALSE(restored.contains("BTC-29MAR24"));
+
+    InstrumentRegistry::InstrumentInfo info;
+    ASSERT_TRUE(restored.find("BTC-PERPETUAL", info));
+    EXPECT_DOUBLE_EQ(info.contract_size, 10);
+    EXPECT_EQ(info.kind, InstrumentRegistry::FUTURE);
+}
+
+TEST_F(InstrumentRegistryTest, CorruptCacheIsIgnored) {
+    registry.load(instruments());
+    ASSERT_TRUE(registry.save(path));
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-3, std::ios::end);
+        file.put('X');
+    }
+    InstrumentRegistry restored;
+    EXPECT_EQ(restored.load_cache(path), 0);
+    EXPECT_EQ(restored.load_cache("missing_instruments.cache"), 0);
+}
+
+TEST_F(InstrumentRegistryTest, ValidationFallsBackWhenRegistryMisses) {
+    EXPECT_TRUE(api::is_valid_instrument_name("SOL-PERPETUAL"));
+    EXPECT_FALSE(api::is_valid_instrument_name("ETH-27DEC30-4000-C"));
+    getInstrumentRegistry().load(instruments());
+    EXPECT_TRUE(api::is_valid_instrument_name("BTC-PERPETUAL"));
+    EXPECT_TRUE(api::is_valid_instrument_name("ETH-27DEC30-4000-C"));
+    // Loading one currency must not lock out the others.
+    EXPECT_TRUE(api::is_valid_instrument_name("SOL-PERPETUAL"));
+    EXPECT_FALSE(api::is_valid_instrument_name("BTC-PERP"));
+    EXPECT_TRUE(api::is_known_currency("ETH"));
+    EXPECT_TRUE(api::is_known_currency("SOL"));
+    EXPECT_FALSE(api::is_known_currency("DOGE"));
+}
+
+TEST_F(InstrumentRegistryTest, StaleCacheIsIgnored) {
+    registry.load(instruments());
+    ASSERT_TRUE(registry.save(path));
+    {
+        // saved_at follows the 8-byte magic, the version and the count.
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(16);
+        int64_t saved_at = 1700000000000LL;
+        file.write(reinterpret_cast<const char*>(&saved_at), sizeof(saved_at));
+    }
+    InstrumentRegistry restored;
+    EXPECT_EQ(restored.load_cache(path), 0);
+    EXPECT_EQ(restored.load_cache(path, std::chrono::hours(24 * 365 * 100)), 2);
+}
+
+TEST_F(InstrumentRegistryTest, ScheduledSaveIsWrittenOnFlush) {
+    registry.load(instruments());
+    std::string written;
+    EXPECT_EQ(registry.flush_pending_save(written), InstrumentRegistry::NOTHING_PENDING);
+    registry.schedule_save(path);
+    EXPECT_FALSE(std::ifstream(path).good());
+    EXPECT_EQ(registry.flush_pending_save(written), InstrumentRegistry::SAVED);
+    EXPECT_EQ(written, path);
+    EXPECT_EQ(InstrumentRegistry().load_cache(path), 2);
+    EXPECT_EQ(registry.flush_pending_save(written), InstrumentRegistry::NOTHING_PENDING);
+}
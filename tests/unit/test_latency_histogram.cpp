@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "performance/latency_histogram.h"
+#include <cstdint>
+#include <memory>
+
+
+TEST(LatencyHistogramTest, BucketsAreContiguousAndOrdered) {
+    for (uint64_t value = 0; value < 100000; value++) {
+        size_t bucket = LatencyHistogram::bucket_of(value);
+        ASSERT_LE(LatencyHistogram::bucket_floor(bucket), value);
+        ASSERT_GT(LatencyHistogram::bucket_floor(bucket) + LatencyHistogram::bucket_width(bucket), value);
+    }
+    EXPECT_EQ(LatencyHistogram::bucket_of(63), 63);
+    EXPECT_EQ(LatencyHistogram::bucket_of(64), 64);
+    EXPECT_LT(LatencyHistogram::bucket_of(UINT64_MAX), LatencyHistogram::BUCKETS);
+}
+
+
+TEST(LatencyHistogramTest, RelativeErrorIsBounded) {
+    for (uint64_t value = 64; value < (uint64_t(1) << 40); value = value * 3 + 7) {
+        size_t bucket = LatencyHistogram::bucket_of(value);
+        double width = static_cast<double>(LatencyHistogram::bucket_width(bucket));
+        EXPECT_LE(width / value, 1.0 / LatencyHistogram::SUB_BUCKETS) << value;
+    }
+}
+
+
+TEST(LatencyHistogramTest, PercentilesTrackUniformDistribution) {
+    auto histogram = std::make_unique<LatencyHistogram>();
+    for (uint64_t value = 1; value <= 100000; value++) {
+        histogram->record(value);
+    }
+    LatencyHistogram::Snapshot snapshot;
+    histogram->snapshot_into(snapshot);
+
+    EXPECT_EQ(snapshot.count, 100000);
+    EXPECT_EQ(snapshot.min, 1u);
+    EXPECT_EQ(snapshot.max, 100000u);
+    EXPECT_DOUBLE_EQ(snapshot.mean(), 50000.5);
+    EXPECT_NEAR(snapshot.percentile(0.5), 50000, 50000 * 0.03);
+    EXPECT_NEAR(snapshot.percentile(0.99), 99000, 99000 * 0.03);
+    EXPECT_NEAR(snapshot.percentile(0.999), 99900, 99900 * 0.03);
+    EXPECT_EQ(snapshot.percentile(1.0), 100000u);
+
+    histogram->reset();
+    LatencyHistogram::Snapshot empty;
+    histogram->snapshot_into(empty);
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.percentile(0.5), 0u);
+}
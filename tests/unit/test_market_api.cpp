@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include "exchange_interface/market_api.h"
+#include "network/subscription_manager.h"
+#include "market_data/order_book.h"
 #include <vector>
 #include <string>
 
@@ -8,12 +10,12 @@ class MarketApiTest : public ::testing::Test {
 protected:
     void SetUp() override {
         
-        channelSubscriptions.clear();
+        getSubscriptionManager().clear();
     }
 
     void TearDown() override {
         
-        channelSubscriptions.clear();
+        getSubscriptionManager().clear();
     }
 };
 
@@ -105,3 +107,37 @@ TEST_F(MarketApiTest, JsonrpcRequestCreation) {
     EXPECT_EQ(req2["method"], "test_method");
     EXPECT_TRUE(req2.contains("id"));
 }
+
+
+TEST_F(MarketApiTest, OrderbookServedFromSubscribedSyncedBook) {
+    getOrderBookManager().clear();
+    std::string request = api::processRequest("deribit 0 orderbook BTC-PERPETUAL 5");
+    EXPECT_FALSE(REQUEST_SERVED_LOCALLY);
+    EXPECT_NE(request.find("public/get_order_book"), std::string::npos);
+
+    MarketDataFrame frame{};
+    ASSERT_TRUE(market_data::decodeSubscription(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.100ms","data":{"type":"snapshot","timestamp":1700000000000,"instrument_name":"BTC-PERPETUAL","change_id":1,"bids":[["new",43000.5,100]],"asks":[["new",43001.0,50]]}}})",
+        frame));
+    getOrderBookManager().apply(frame);
+
+    request = api::processRequest("deribit 0 orderbook BTC-PERPETUAL 5");
+    EXPECT_FALSE(REQUEST_SERVED_LOCALLY);
+
+    std::vector<std::string> changed;
+    getSubscriptionManager().acquire(0, {"book.BTC-PERPETUAL.100ms"}, changed);
+    request = api::processRequest("deribit 0 orderbook BTC-PERPETUAL 5");
+    EXPECT_TRUE(REQUEST_SERVED_LOCALLY);
+    EXPECT_TRUE(request.empty());
+
+    request = api::processRequest("deribit 0 orderbook BTC-PERPETUAL 5 remote");
+    EXPECT_FALSE(REQUEST_SERVED_LOCALLY);
+    EXPECT_NE(request.find("public/get_order_book"), std::string::npos);
+
+    getOrderBookManager().unsync("BTC-PERPETUAL");
+    request = api::processRequest("deribit 0 orderbook BTC-PERPETUAL 5");
+    EXPECT_FALSE(REQUEST_SERVED_LOCALLY);
+
+    getSubscriptionManager().release({"book.BTC-PERPETUAL.100ms"}, changed);
+    getOrderBookManager().clear();
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include "data_format/market_data_decoder.h"
+#include <string>
+
+
+class MarketDataDecoderTest : public ::testing::Test {
+protected:
+    MarketDataFrame frame{};
+};
+
+
+TEST_F(MarketDataDecoderTest, PriceIndexFrame) {
+    const std::string payload = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"deribit_price_index.btc_usd","data":{"timestamp":1700000000123,"price":43250.57,"index_name":"btc_usd"}}})";
+
+    ASSERT_TRUE(market_data::decodeSubscription(payload, frame));
+    EXPECT_EQ(frame.kind, ChannelKind::PriceIndex);
+    EXPECT_EQ(frame.channel.view(), "deribit_price_index.btc_usd");
+    EXPECT_EQ(frame.index.index_name.view(), "btc_usd");
+    EXPECT_EQ(frame.index.timestamp, 1700000000123LL);
+    EXPECT_DOUBLE_EQ(frame.index.price, 43250.57);
+}
+
+
+TEST_F(MarketDataDecoderTest, TickerFrameWithNullsAndNestedStats) {
+    const std::string payload = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"ticker.BTC-PERPETUAL.100ms","data":{"stats":{"volume":12.5,"high":44000,"low":null},"timestamp":1700000000456,"last_price":null,"instrument_name":"BTC-PERPETUAL","best_bid_price":43250.5,"best_bid_amount":1200,"best_ask_price":43251.0,"best_ask_amount":300,"mark_price":43250.75,"index_price":43249.1}}})";
+
+    ASSERT_TRUE(market_data::decodeSubscription(payload, frame));
+    EXPECT_EQ(frame.kind, ChannelKind::Ticker);
+    EXPECT_EQ(frame.ticker.instrument_name.view(), "BTC-PERPETUAL");
+    EXPECT_EQ(frame.ticker.timestamp, 1700000000456LL);
+    EXPECT_DOUBLE_EQ(frame.ticker.best_bid_price, 43250.5);
+    EXPECT_DOUBLE_EQ(frame.ticker.best_ask_amount, 300);
+    EXPECT_DOUBLE_EQ(frame.ticker.last_price, 0.0);
+    EXPECT_DOUBLE_EQ(frame.ticker.index_price, 43249.1);
+}
+
+
+TEST_F(MarketDataDecoderTest, BookChangeFrame) {
+    const std::string payload = R"({"params":{"data":{"type":"change","timestamp":1700000000789,"prev_change_id":100,"instrument_name":"ETH-PERPETUAL","change_id":101,"bids":[["delete",2250.05,0],["new",2250.0,5000]],"asks":[["change",2251.5,1200.5]]},"channel":"book.ETH-PERPETUAL.100ms"},"method":"subscription","jsonrpc":"2.0"})";
+
+    ASSERT_TRUE(market_data::decodeSubscription(payload, frame));
+    EXPECT_EQ(frame.kind, ChannelKind::Book);
+    EXPECT_FALSE(frame.book.is_snapshot);
+    EXPECT_EQ(frame.book.instrument_name.view(), "ETH-PERPETUAL");
+    EXPECT_EQ(frame.book.change_id, 101);
+    EXPECT_EQ(frame.book.prev_change_id, 100);
+    ASSERT_EQ(frame.bids.size(), 2);
+    EXPECT_EQ(frame.bids[0].action, BookAction::Delete);
+    EXPECT_DOUBLE_EQ(frame.bids[1].price.to_double(), 2250.0);
+    EXPECT_DOUBLE_EQ(frame.bids[1].amount.to_double(), 5000);
+    ASSERT_EQ(frame.asks.size(), 1);
+    EXPECT_EQ(frame.asks[0].action, BookAction::Change);
+    EXPECT_DOUBLE_EQ(frame.asks[0].amount.to_double(), 1200.5);
+}
+
+
+TEST_F(MarketDataDecoderTest, GroupedBookLevelsWithoutActions) {
+    const std::string payload = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.none.10.100ms","data":{"timestamp":1,"instrument_name":"BTC-PERPETUAL","change_id":5,"bids":[[43250.5,10]],"asks":[]}}})";
+
+    ASSERT_TRUE(market_data::decodeSubscription(payload, frame));
+    EXPECT_EQ(frame.kind, ChannelKind::Book);
+    ASSERT_EQ(frame.bids.size(), 1);
+    EXPECT_EQ(frame.bids[0].action, BookAction::New);
+    EXPECT_DOUBLE_EQ(frame.bids[0].price.to_double(), 43250.5);
+    EXPECT_EQ(frame.bids[0].price.mantissa, 432505);
+    EXPECT_EQ(frame.bids[0].price.exponent, -1);
+    EXPECT_TRUE(frame.asks.empty());
+}
+
+
+TEST_F(MarketDataDecoderTest, RejectsNonSubscriptionFrames) {
+    EXPECT_FALSE(market_data::decodeSubscription(R"({"jsonrpc":"2.0","id":7,"result":{"bids":[]}})", frame));
+    EXPECT_FALSE(market_data::decodeSubscription(R"({"jsonrpc":"2.0","method":"heartbeat","params":{"type":"test_request"}})", frame));
+    EXPECT_FALSE(market_data::decodeSubscription("not json", frame));
+    EXPECT_FALSE(market_data::decodeSubscription(R"({"method":"subscription","params":{"channel":"ticker.X","data":{"timestamp":)", frame));
+}
+
+
+TEST_F(MarketDataDecoderTest, UnknownChannelIsStillRecognised) {
+    const std::string payload = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"estimated_expiration_price.btc_usd","data":{"seconds":120,"price":43000.5,"is_estimated":true}}})";
+    ASSERT_TRUE(market_data::decodeSubscription(payload, frame));
+    EXPECT_EQ(frame.kind, ChannelKind::Unknown);
+    EXPECT_EQ(frame.channel.view(), "estimated_expiration_price.btc_usd");
+}
+
+
+TEST_F(MarketDataDecoderTest, TradesFrame) {
+    const std::string payload = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"trades.BTC-PERPETUAL.100ms","data":[{"trade_seq":30289432,"trade_id":"48079254","timestamp":1700000000500,"tick_direction":0,"price":43251.5,"mark_price":43250.9,"instrument_name":"BTC-PERPETUAL","index_price":43249.1,"direction":"sell","amount":40},{"trade_id":"48079255","timestamp":1700000000501,"price":43252.0,"instrument_name":"BTC-PERPETUAL","direction":"buy","amount":10}]}})";
+
+    ASSERT_TRUE(market_data::decodeSubscription(payload, frame));
+    EXPECT_EQ(frame.kind, ChannelKind::Trades);
+    ASSERT_EQ(frame.trades.size(), 2u);
+    EXPECT_EQ(frame.trades[0].trade_id.view(), "48079254");
+    EXPECT_EQ(frame.trades[0].instrument_name.view(), "BTC-PERPETUAL");
+    EXPECT_EQ(frame.trades[0].symbol, getSymbolTable().find("BTC-PERPETUAL"));
+    EXPECT_EQ(frame.trades[0].direction, Side::Sell);
+    EXPECT_DOUBLE_EQ(frame.trades[0].price, 43251.5);
+    EXPECT_DOUBLE_EQ(frame.trades[0].amount, 40);
+    EXPECT_EQ(frame.trades[1].direction, Side::Buy);
+    EXPECT_EQ(frame.trades[1].timestamp, 1700000000501LL);
+}
+
+
+TEST_F(MarketDataDecoderTest, UserOrdersFrame) {
+    const std::string payload = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"user.orders.BTC-PERPETUAL.raw","data":{"time_in_force":"good_til_cancelled","price":"market_price","order_type":"market","order_state":"filled","order_id":"ETH-123456","last_update_timestamp":1700000000900,"instrument_name":"BTC-PERPETUAL","filled_amount":20,"direction":"buy","average_price":43250.5,"amount":20}}})";
+
+    ASSERT_TRUE(market_data::decodeSubscription(payload, frame));
+    EXPECT_EQ(frame.kind, ChannelKind::UserOrders);
+    ASSERT_EQ(frame.orders.size(), 1u);
+    EXPECT_EQ(frame.orders[0].order_id.view(), "ETH-123456");
+    EXPECT_EQ(frame.orders[0].order_state.view(), "filled");
+    EXPECT_DOUBLE_EQ(frame.orders[0].price, 0.0);
+    EXPECT_DOUBLE_EQ(frame.orders[0].average_price, 43250.5);
+    EXPECT_DOUBLE_EQ(frame.orders[0].filled_amount, 20);
+    EXPECT_EQ(frame.orders[0].timestamp, 1700000000900LL);
+}
+
+
+TEST_F(MarketDataDecoderTest, UserTradesFrame) {
+    const std::string payload = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"user.trades.future.BTC.100ms","data":[{"trade_id":"T-1","order_id":"O-9","instrument_name":"BTC-PERPETUAL","price":43000,"amount":10,"direction":"buy","fee":0.0001,"timestamp":1700000001000}]}})";
+
+    ASSERT_TRUE(market_data::decodeSubscription(payload, frame));
+    EXPECT_EQ(frame.kind, ChannelKind::UserTrades);
+    ASSERT_EQ(frame.trades.size(), 1u);
+    EXPECT_EQ(frame.trades[0].order_id.view(), "O-9");
+    EXPECT_DOUBLE_EQ(frame.trades[0].price, 43000);
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include "market_data/market_data_manager.h"
+
+
+static MarketEvent indexEvent(const char* name, double price, int64_t timestamp = 1700000000000) {
+    MarketEvent event{};
+    event.kind = ChannelKind::PriceIndex;
+    event.index.index_name.assign(name);
+    event.index.symbol = getSymbolTable().intern(name);
+    event.index.price = price;
+    event.index.timestamp = timestamp;
+    return event;
+}
+
+
+TEST(MarketDataManagerTest, EachInstrumentGetsItsOwnSlot) {
+    MarketDataManager manager;
+    EXPECT_TRUE(manager.apply(indexEvent("btc_usd", 100.0)));
+    EXPECT_TRUE(manager.apply(indexEvent("eth_usd", 10.0)));
+    EXPECT_TRUE(manager.apply(indexEvent("btc_usd", 90.0)));
+
+    ASSERT_EQ(manager.size(), 2);
+    EXPECT_EQ(manager.resolve(getSymbolTable().intern("btc_usd"), ChannelKind::PriceIndex), 0);
+    EXPECT_EQ(manager.resolve(getSymbolTable().intern("eth_usd"), ChannelKind::PriceIndex), 1);
+
+    const auto* btc = manager.find("btc_usd");
+    ASSERT_NE(btc, nullptr);
+    EXPECT_EQ(btc->update_count, 2);
+    EXPECT_DOUBLE_EQ(btc->open_price, 100.0);
+    EXPECT_DOUBLE_EQ(btc->low_price, 90.0);
+    EXPECT_DOUBLE_EQ(manager.slot(1).price, 10.0);
+    EXPECT_EQ(manager.find("sol_usd"), nullptr);
+    EXPECT_EQ(btc->name, "btc_usd");
+}
+
+TEST(MarketDataManagerTest, TickerEventsTrackTopOfBook) {
+    MarketDataManager manager;
+    MarketEvent event{};
+    event.kind = ChannelKind::Ticker;
+    event.ticker.instrument_name.assign("BTC-PERPETUAL");
+    event.ticker.symbol = getSymbolTable().intern("BTC-PERPETUAL");
+    event.ticker.mark_price = 43000.0;
+    event.ticker.best_bid_price = 42999.5;
+    event.ticker.best_ask_price = 43000.5;
+    ASSERT_TRUE(manager.apply(event));
+
+    const auto* btc = manager.find("BTC-PERPETUAL");
+    ASSERT_NE(btc, nullptr);
+    EXPECT_EQ(btc->kind, ChannelKind::Ticker);
+    EXPECT_DOUBLE_EQ(btc->price, 43000.0);
+    EXPECT_DOUBLE_EQ(btc->best_ask_price, 43000.5);
+
+    event.kind = ChannelKind::Book;
+    EXPECT_FALSE(manager.apply(event));
+}
+
+TEST(MarketDataManagerTest, PriceHistoryKeepsNewestEntries) {
+    MarketDataManager manager;
+    for (int i = 0; i < 45; i++) {
+        manager.apply(indexEvent("btc_usd", i));
+    }
+    const auto& history = manager.find("btc_usd")->price_history;
+    ASSERT_EQ(history.size(), MarketDataManager::HISTORY_LENGTH);
+    EXPECT_DOUBLE_EQ(history[0], 15.0);
+    EXPECT_DOUBLE_EQ(history[history.size() - 1], 44.0);
+}
+
+TEST(MarketDataManagerTest, TradesDrivePriceOnlyWithoutTicker) {
+    MarketDataManager manager;
+    MarketEvent event{};
+    event.kind = ChannelKind::Trades;
+    event.trade.symbol = getSymbolTable().intern("ETH-PERPETUAL");
+    event.trade.price = 2250.5;
+    event.trade.amount = 3;
+    ASSERT_TRUE(manager.apply(event));
+    event.trade.price = 2251.0;
+    ASSERT_TRUE(manager.apply(event));
+
+    const auto* eth = manager.find("ETH-PERPETUAL");
+    ASSERT_NE(eth, nullptr);
+    EXPECT_EQ(eth->kind, ChannelKind::Trades);
+    EXPECT_DOUBLE_EQ(eth->price, 2251.0);
+    EXPECT_DOUBLE_EQ(eth->traded_volume, 6);
+    EXPECT_EQ(eth->trade_count, 2);
+
+    MarketEvent ticker{};
+    ticker.kind = ChannelKind::Ticker;
+    ticker.ticker.symbol = getSymbolTable().intern("SOL-PERPETUAL");
+    ticker.ticker.mark_price = 100.0;
+    manager.apply(ticker);
+    event.trade.symbol = ticker.ticker.symbol;
+    event.trade.price = 101.0;
+    manager.apply(event);
+    const auto* sol = manager.find("SOL-PERPETUAL");
+    EXPECT_DOUBLE_EQ(sol->price, 100.0);
+    EXPECT_DOUBLE_EQ(sol->last_trade_price, 101.0);
+}
+
+TEST(MarketDataManagerTest, TickerTakesOverPriceLineAfterEarlyTrade) {
+    MarketDataManager manager;
+    MarketEvent trade{};
+    trade.kind = ChannelKind::Trades;
+    trade.trade.symbol = getSymbolTable().intern("XRP-PERPETUAL");
+    trade.trade.price = 0.75;
+    trade.trade.amount = 10;
+    ASSERT_TRUE(manager.apply(trade));
+
+    MarketEvent ticker{};
+    ticker.kind = ChannelKind::Ticker;
+    ticker.ticker.symbol = trade.trade.symbol;
+    ticker.ticker.mark_price = 0.5;
+    ASSERT_TRUE(manager.apply(ticker));
+    trade.trade.price = 0.9;
+    ASSERT_TRUE(manager.apply(trade));
+
+    const auto* xrp = manager.find("XRP-PERPETUAL");
+    ASSERT_NE(xrp, nullptr);
+    EXPECT_EQ(xrp->kind, ChannelKind::Ticker);
+    EXPECT_DOUBLE_EQ(xrp->price, 0.5);
+    EXPECT_DOUBLE_EQ(xrp->open_price, 0.5);
+    EXPECT_DOUBLE_EQ(xrp->high_price, 0.5);
+    EXPECT_DOUBLE_EQ(xrp->low_price, 0.5);
+    EXPECT_EQ(xrp->price_history.size(), 1u);
+    EXPECT_DOUBLE_EQ(xrp->last_trade_price, 0.9);
+    EXPECT_EQ(xrp->trade_count, 2u);
+}
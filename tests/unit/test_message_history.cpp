@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "network/message_history.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+
+TEST(MessageHistoryTest, KeepsNewestEntriesWithinCapacity) {
+    MessageHistory history(3);
+    history.record(MessageHistory::SENT, "one");
+    history.record(MessageHistory::RECEIVED, "two");
+    history.record(MessageHistory::SENT, "three");
+    history.record(MessageHistory::RECEIVED, "four");
+
+    EXPECT_EQ(history.size(), 3);
+    EXPECT_EQ(history.capacity(), 3);
+    EXPECT_EQ(history.evicted(), 1);
+
+    std::vector<std::string> messages = history.snapshot();
+    ASSERT_EQ(messages.size(), 3);
+    EXPECT_EQ(messages[0], "RECEIVED: two");
+    EXPECT_EQ(messages[1], "SENT: three");
+    EXPECT_EQ(messages[2], "RECEIVED: four");
+}
+
+
+TEST(MessageHistoryTest, ResizePreservesOrder) {
+    MessageHistory history(4);
+    for (int i = 0; i < 6; i++) {
+        history.record(MessageHistory::SENT, std::to_string(i));
+    }
+
+    history.resize(2);
+    std::vector<std::string> shrunk = history.snapshot();
+    ASSERT_EQ(shrunk.size(), 2);
+    EXPECT_EQ(shrunk[0], "SENT: 4");
+    EXPECT_EQ(shrunk[1], "SENT: 5");
+
+    history.resize(8);
+    history.record(MessageHistory::RECEIVED, "6");
+    std::vector<std::string> grown = history.snapshot();
+    ASSERT_EQ(grown.size(), 3);
+    EXPECT_EQ(grown[0], "SENT: 4");
+    EXPECT_EQ(grown[2], "RECEIVED: 6");
+}
+
+
+TEST(MessageHistoryTest, SpillsEvictedEntriesToFile) {
+    const std::string path = "message_history_spill_test.log";
+    std::remove(path.c_str());
+    {
+        MessageHistory history(1);
+        ASSERT_TRUE(history.spill_to(path));
+        EXPECT_EQ(history.spill_path(), path);
+        history.record(MessageHistory::SENT, "first");
+        history.record(MessageHistory::RECEIVED, "second");
+        history.record(MessageHistory::SENT, "third");
+    }
+
+    std::ifstream spilled(path);
+    std::string line;
+    ASSERT_TRUE(std::getline(spilled, line));
+    EXPECT_EQ(line, "SENT: first");
+    ASSERT_TRUE(std::getline(spilled, line));
+    EXPECT_EQ(line, "RECEIVED: second");
+    EXPECT_FALSE(std::getline(spilled, line));
+    std::remove(path.c_str());
+}
+
+
+TEST(MessageHistoryTest, SpillIsWrittenOnlyOnFlush) {
+    const std::string path = "message_history_flush_test.log";
+    std::remove(path.c_str());
+    MessageHistory history(1);
+    ASSERT_TRUE(history.spill_to(path));
+    history.record(MessageHistory::SENT, "first");
+    history.record(MessageHistory::RECEIVED, "second");
+
+    std::ifstream before(path);
+    std::string line;
+    EXPECT_FALSE(std::getline(before, line));
+
+    history.flush_spill();
+    std::ifstream after(path);
+    ASSERT_TRUE(std::getline(after, line));
+    EXPECT_EQ(line, "SENT: first");
+    EXPECT_EQ(history.spill_dropped(), 0u);
+    history.stop_spill();
+    std::remove(path.c_str());
+}
+
+
+TEST(MessageHistoryTest, MemoryIsBoundedByCapacity) {
+    MessageHistory history(16);
+    const std::string payload(512, 'x');
+    for (int i = 0; i < 1000; i++) {
+        history.record(MessageHistory::RECEIVED, payload);
+    }
+    EXPECT_EQ(history.size(), 16);
+    EXPECT_LT(history.memory_usage(), 16 * (sizeof(MessageHistory::Entry) + 1024));
+}
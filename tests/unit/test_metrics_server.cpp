@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include "network/metrics_server.h"
+#include "performance/monitor.h"
+#include <sstream>
+#include <string>
+
+
+class MetricsServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        getPerformanceMonitor().reset();
+    }
+
+    void TearDown() override {
+        getPerformanceMonitor().reset();
+    }
+};
+
+
+TEST_F(MetricsServerTest, HistogramBucketsAreCumulative) {
+    LatencyHistogram histogram;
+    histogram.record(1500);
+    histogram.record(3000000);
+    histogram.record(20000000000ULL);
+    LatencyHistogram::Snapshot snapshot;
+    histogram.snapshot_into(snapshot);
+
+    std::string out;
+    MetricsServer::append_histogram(out, "test_seconds", "stage=\"x\"", snapshot);
+    EXPECT_NE(out.find("test_seconds_bucket{stage=\"x\",le=\"1e-06\"} 0\n"), std::string::npos);
+    EXPECT_NE(out.find("test_seconds_bucket{stage=\"x\",le=\"2.5e-06\"} 1\n"), std::string::npos);
+    EXPECT_NE(out.find("test_seconds_bucket{stage=\"x\",le=\"0.005\"} 2\n"), std::string::npos);
+    EXPECT_NE(out.find("test_seconds_bucket{stage=\"x\",le=\"10\"} 2\n"), std::string::npos);
+    EXPECT_NE(out.find("test_seconds_bucket{stage=\"x\",le=\"+Inf\"} 3\n"), std::string::npos);
+    EXPECT_NE(out.find("test_seconds_count{stage=\"x\"} 3\n"), std::string::npos);
+    EXPECT_NE(out.find("test_seconds_sum{stage=\"x\"} 20.003001500\n"), std::string::npos);
+}
+
+
+TEST_F(MetricsServerTest, ScrapeIsValidExposition) {
+    SocketEndpoint endpoint;
+    MetricsServer server(endpoint);
+    getPerformanceMonitor().record(PerformanceMonitor::FRAME_DECODE, std::chrono::microseconds(4));
+
+    std::string body = server.scrape();
+    EXPECT_NE(body.find("# TYPE deribit_stage_latency_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(body.find("deribit_stage_latency_seconds_bucket{stage=\"frame_decode\",le=\"5e-06\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(body.find("# TYPE deribit_messages_received_total counter\n"), std::string::npos);
+
+    std::istringstream lines(body);
+    std::string line;
+    while (std::getline(lines, line)) {
+        ASSERT_FALSE(line.empty());
+        if (line[0] == '#') continue;
+        size_t space = line.rfind(' ');
+        ASSERT_NE(space, std::string::npos) << line;
+        EXPECT_EQ(line.compare(0, 7, "deribit"), 0) << line;
+        EXPECT_NO_THROW(std::stod(line.substr(space + 1))) << line;
+    }
+    EXPECT_FALSE(server.running());
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include "market_data/order_book.h"
+#include <vector>
+
+
+class OrderBookTest : public ::testing::Test {
+protected:
+    OrderBook book{"BTC-PERPETUAL"};
+
+    static BookUpdateHeader header(int64_t change_id, int64_t prev_change_id, bool snapshot = false) {
+        BookUpdateHeader update{};
+        update.symbol = getSymbolTable().intern("BTC-PERPETUAL");
+        update.instrument_name.assign("BTC-PERPETUAL");
+        update.timestamp = 1700000000000 + change_id;
+        update.change_id = change_id;
+        update.prev_change_id = prev_change_id;
+        update.is_snapshot = snapshot;
+        return update;
+    }
+
+    static BookLevelUpdate level(BookAction action, double price, double amount) {
+        return BookLevelUpdate{action, Decimal::from_double(price), Decimal::from_double(amount)};
+    }
+
+    double price(OrderBook::Level level) const { return book.scale().to_double(level.price); }
+    double amount(OrderBook::Level level) const { return book.scale().to_double(level.amount); }
+
+    void load_snapshot() {
+        std::vector<BookLevelUpdate> bids = {
+            level(BookAction::New, 100.0, 10), level(BookAction::New, 99.5, 20), level(BookAction::New, 99.0, 30)
+        };
+        std::vector<BookLevelUpdate> asks = {
+            level(BookAction::New, 100.5, 5), level(BookAction::New, 101.0, 15)
+        };
+        ASSERT_EQ(book.apply(header(10, 0, true), bids, asks), OrderBook::SNAPSHOT_APPLIED);
+    }
+};
+
+
+TEST_F(OrderBookTest, SnapshotBuildsSortedSides) {
+    load_snapshot();
+    OrderBook::Level best;
+    ASSERT_TRUE(book.best_bid(best));
+    EXPECT_DOUBLE_EQ(price(best), 100.0);
+    ASSERT_TRUE(book.best_ask(best));
+    EXPECT_DOUBLE_EQ(price(best), 100.5);
+    EXPECT_EQ(book.bid_depth(), 3);
+    EXPECT_EQ(book.ask_depth(), 2);
+    EXPECT_DOUBLE_EQ(price(book.bid(2)), 99.0);
+    EXPECT_DOUBLE_EQ(price(book.ask(1)), 101.0);
+    EXPECT_TRUE(book.is_synced());
+    EXPECT_EQ(book.change_id(), 10);
+}
+
+TEST_F(OrderBookTest, DeltasInsertChangeAndDelete) {
+    load_snapshot();
+    std::vector<BookLevelUpdate> bids = {
+        level(BookAction::New, 100.25, 7), level(BookAction::Change, 99.5, 25), level(BookAction::Delete, 99.0, 0)
+    };
+    std::vector<BookLevelUpdate> asks = {level(BookAction::Delete, 100.5, 0)};
+    EXPECT_EQ(book.apply(header(11, 10), bids, asks), OrderBook::APPLIED);
+
+    std::vector<OrderBook::Level> top_bids;
+    std::vector<OrderBook::Level> top_asks;
+    book.top_levels(10, top_bids, top_asks);
+    ASSERT_EQ(top_bids.size(), 3);
+    EXPECT_DOUBLE_EQ(price(top_bids[0]), 100.25);
+    EXPECT_DOUBLE_EQ(price(top_bids[1]), 100.0);
+    EXPECT_DOUBLE_EQ(amount(top_bids[2]), 25);
+    ASSERT_EQ(top_asks.size(), 1);
+    EXPECT_DOUBLE_EQ(price(top_asks[0]), 101.0);
+}
+
+TEST_F(OrderBookTest, GapUnsyncsUntilNextSnapshot) {
+    std::vector<BookLevelUpdate> none;
+    EXPECT_EQ(book.apply(header(5, 4), none, none), OrderBook::AWAITING_SNAPSHOT);
+
+    load_snapshot();
+    EXPECT_EQ(book.apply(header(13, 12), none, none), OrderBook::SEQUENCE_GAP);
+    EXPECT_FALSE(book.is_synced());
+    EXPECT_EQ(book.gaps_detected(), 1);
+    EXPECT_EQ(book.bid_depth(), 0);
+    EXPECT_EQ(book.apply(header(14, 13), none, none), OrderBook::AWAITING_SNAPSHOT);
+
+    load_snapshot();
+    EXPECT_TRUE(book.is_synced());
+}
+
+TEST_F(OrderBookTest, TickScaledLevelsMatchExactly) {
+    book = OrderBook("BTC-PERPETUAL", InstrumentScale::from_double(0.5, 10));
+    load_snapshot();
+    EXPECT_EQ(book.bid(0).price.ticks, 200);
+    EXPECT_EQ(book.bid(0).amount.lots, 1);
+
+    BookLevelUpdate change{BookAction::Change, Decimal{1000, -1}, Decimal{40, 0}};
+    std::vector<BookLevelUpdate> none;
+    EXPECT_EQ(book.apply(header(11, 10), {change}, none), OrderBook::APPLIED);
+    EXPECT_EQ(book.bid_depth(), 3);
+    EXPECT_EQ(book.bid(0).amount.lots, 4);
+}
+
+TEST(OrderBookManagerTest, AppliesDecodedFrames) {
+    getOrderBookManager().clear();
+    MarketDataFrame frame{};
+    ASSERT_TRUE(market_data::decodeSubscription(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.ETH-PERPETUAL.100ms","data":{"type":"snapshot","timestamp":1700000000000,"instrument_name":"ETH-PERPETUAL","change_id":7,"bids":[["new",2000.0,3]],"asks":[["new",2000.5,4]]}}})",
+        frame));
+    EXPECT_EQ(getOrderBookManager().apply(frame), OrderBook::SNAPSHOT_APPLIED);
+
+    OrderBook copy;
+    ASSERT_TRUE(getOrderBookManager().snapshot("ETH-PERPETUAL", copy));
+    OrderBook::Level best;
+    ASSERT_TRUE(copy.best_ask(best));
+    EXPECT_DOUBLE_EQ(copy.scale().to_double(best.price), 2000.5);
+
+    getOrderBookManager().set_scale("ETH-PERPETUAL", InstrumentScale::from_double(0.05, 1));
+    ASSERT_TRUE(getOrderBookManager().snapshot("ETH-PERPETUAL", copy));
+    EXPECT_TRUE(copy.is_synced());
+    EXPECT_EQ(copy.ask(0).price.ticks, 40010);
+    EXPECT_EQ(copy.ask(0).amount.lots, 4);
+
+    getOrderBookManager().remove("ETH-PERPETUAL");
+    EXPECT_FALSE(getOrderBookManager().snapshot("ETH-PERPETUAL", copy));
+}
+
+TEST(OrderBookManagerTest, TopLevelsCopyOnlyRequestedDepth) {
+    getOrderBookManager().clear();
+    MarketDataFrame frame{};
+    ASSERT_TRUE(market_data::decodeSubscription(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.ETH-PERPETUAL.100ms","data":{"type":"snapshot","timestamp":1700000000000,"instrument_name":"ETH-PERPETUAL","change_id":7,"bids":[["new",2000.0,3],["new",1999.5,6],["new",1999.0,9]],"asks":[["new",2000.5,4],["new",2001.0,8]]}}})",
+        frame));
+    ASSERT_EQ(getOrderBookManager().apply(frame), OrderBook::SNAPSHOT_APPLIED);
+
+    OrderBook::Level bid, ask;
+    ASSERT_TRUE(getOrderBookManager().best_bid("ETH-PERPETUAL", bid));
+    ASSERT_TRUE(getOrderBookManager().best_ask("ETH-PERPETUAL", ask));
+
+    OrderBookManager::TopOfBook top;
+    ASSERT_TRUE(getOrderBookManager().top_levels("ETH-PERPETUAL", 2, top));
+    EXPECT_EQ(top.instrument, "ETH-PERPETUAL");
+    EXPECT_TRUE(top.synced);
+    EXPECT_EQ(top.change_id, 7);
+    ASSERT_EQ(top.bids.size(), 2u);
+    ASSERT_EQ(top.asks.size(), 2u);
+    EXPECT_EQ(top.bids[0].price.ticks, bid.price.ticks);
+    EXPECT_EQ(top.asks[0].price.ticks, ask.price.ticks);
+    EXPECT_DOUBLE_EQ(top.scale.to_double(top.bids[1].price), 1999.5);
+
+    getOrderBookManager().remove("ETH-PERPETUAL");
+    EXPECT_FALSE(getOrderBookManager().best_bid("ETH-PERPETUAL", bid));
+    EXPECT_FALSE(getOrderBookManager().top_levels("ETH-PERPETUAL", 2, top));
+}
+
+TEST(OrderBookManagerTest, UnsyncWaitsForNextSnapshot) {
+    getOrderBookManager().clear();
+    MarketDataFrame frame{};
+    ASSERT_TRUE(market_data::decodeSubscription(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.ETH-PERPETUAL.100ms","data":{"type":"snapshot","timestamp":1700000000000,"instrument_name":"ETH-PERPETUAL","change_id":7,"bids":[["new",2000.0,3]],"asks":[["new",2000.5,4]]}}})",
+        frame));
+    ASSERT_EQ(getOrderBookManager().apply(frame), OrderBook::SNAPSHOT_APPLIED);
+
+    getOrderBookManager().unsync("ETH-PERPETUAL");
+    OrderBookManager::TopOfBook top;
+    ASSERT_TRUE(getOrderBookManager().top_levels("ETH-PERPETUAL", 10, top));
+    EXPECT_FALSE(top.synced);
+    EXPECT_TRUE(top.bids.empty());
+
+    ASSERT_TRUE(market_data::decodeSubscription(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.ETH-PERPETUAL.100ms","data":{"type":"change","timestamp":1700000000100,"instrument_name":"ETH-PERPETUAL","change_id":8,"prev_change_id":7,"bids":[["change",2000.0,5]],"asks":[]}}})",
+        frame));
+    EXPECT_EQ(getOrderBookManager().apply(frame), OrderBook::AWAITING_SNAPSHOT);
+    getOrderBookManager().remove("ETH-PERPETUAL");
+}
@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 #include "performance/monitor.h"
+#include "performance/scoped_probe.h"
+#include "data_format/symbol_table.h"
 #include <chrono>
 #include <thread>
+#include <vector>
 
 
 class PerformanceMonitorTest : public ::testing::Test {
@@ -31,16 +34,14 @@ TEST_F(PerformanceMonitorTest, BasicMeasurement) {
     monitor.stop_measurement(PerformanceMonitor::ORDER_EXECUTION);
     
     
-    auto metrics = monitor.get_raw_metrics();
+    auto metrics = monitor.snapshot(PerformanceMonitor::ORDER_EXECUTION);
     
     
-    EXPECT_EQ(metrics[PerformanceMonitor::ORDER_EXECUTION].size(), 1);
+    EXPECT_EQ(metrics.count, 1);
     
     
-    EXPECT_TRUE(metrics[PerformanceMonitor::ORDER_EXECUTION][0].is_complete);
-    
-    
-    EXPECT_GT(metrics[PerformanceMonitor::ORDER_EXECUTION][0].elapsed_time.count(), 0);
+    EXPECT_GE(metrics.min, 10000000u);
+    EXPECT_EQ(metrics.min, metrics.max);
 }
 
 
@@ -61,17 +62,10 @@ TEST_F(PerformanceMonitorTest, MultipleMeasurements) {
     monitor.stop_measurement(PerformanceMonitor::WEBSOCKET_COMMUNICATION);
     
     
-    auto metrics = monitor.get_raw_metrics();
-    
-    
-    EXPECT_EQ(metrics[PerformanceMonitor::ORDER_EXECUTION].size(), 1);
-    EXPECT_EQ(metrics[PerformanceMonitor::MARKET_DATA_HANDLING].size(), 1);
-    EXPECT_EQ(metrics[PerformanceMonitor::WEBSOCKET_COMMUNICATION].size(), 1);
-    
-    
-    EXPECT_TRUE(metrics[PerformanceMonitor::ORDER_EXECUTION][0].is_complete);
-    EXPECT_TRUE(metrics[PerformanceMonitor::MARKET_DATA_HANDLING][0].is_complete);
-    EXPECT_TRUE(metrics[PerformanceMonitor::WEBSOCKET_COMMUNICATION][0].is_complete);
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::ORDER_EXECUTION).count, 1);
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::MARKET_DATA_HANDLING).count, 1);
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::WEBSOCKET_COMMUNICATION).count, 1);
+    EXPECT_TRUE(monitor.snapshot(PerformanceMonitor::TRADING_CYCLE_FULL).empty());
 }
 
 
@@ -87,14 +81,11 @@ TEST_F(PerformanceMonitorTest, UniqueIdMeasurements) {
     monitor.stop_measurement(PerformanceMonitor::ORDER_EXECUTION, "order1");
     
     
-    auto metrics = monitor.get_raw_metrics();
-    
-    
-    EXPECT_EQ(metrics[PerformanceMonitor::ORDER_EXECUTION].size(), 2);
-    
-    
-    EXPECT_TRUE(metrics[PerformanceMonitor::ORDER_EXECUTION][0].is_complete);
-    EXPECT_TRUE(metrics[PerformanceMonitor::ORDER_EXECUTION][1].is_complete);
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::ORDER_EXECUTION).count, 2);
+
+
+    monitor.stop_measurement(PerformanceMonitor::ORDER_EXECUTION, "order1");
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::ORDER_EXECUTION).count, 2);
 }
 
 
@@ -106,15 +97,13 @@ TEST_F(PerformanceMonitorTest, ResetFunctionality) {
     monitor.stop_measurement(PerformanceMonitor::ORDER_EXECUTION);
     
     
-    auto metrics = monitor.get_raw_metrics();
-    EXPECT_EQ(metrics[PerformanceMonitor::ORDER_EXECUTION].size(), 1);
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::ORDER_EXECUTION).count, 1);
     
     
     monitor.reset();
     
     
-    metrics = monitor.get_raw_metrics();
-    EXPECT_EQ(metrics[PerformanceMonitor::ORDER_EXECUTION].size(), 0);
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::ORDER_EXECUTION).count, 0);
 }
 
 
@@ -140,3 +129,126 @@ TEST_F(PerformanceMonitorTest, ReportGeneration) {
     EXPECT_NE(report.find("Min:"), std::string::npos);
     EXPECT_NE(report.find("Max:"), std::string::npos);
 }
+
+
+TEST_F(PerformanceMonitorTest, UnkeyedStopsMatchOldestStart) {
+    auto& monitor = getPerformanceMonitor();
+    monitor.start_measurement(PerformanceMonitor::TRADING_CYCLE_FULL);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    monitor.start_measurement(PerformanceMonitor::TRADING_CYCLE_FULL);
+    monitor.stop_measurement(PerformanceMonitor::TRADING_CYCLE_FULL);
+    monitor.stop_measurement(PerformanceMonitor::TRADING_CYCLE_FULL);
+    monitor.stop_measurement(PerformanceMonitor::TRADING_CYCLE_FULL);
+
+    auto metrics = monitor.snapshot(PerformanceMonitor::TRADING_CYCLE_FULL);
+    EXPECT_EQ(metrics.count, 2);
+    EXPECT_GE(metrics.max, 5000000u);
+    EXPECT_LT(metrics.min, 5000000u);
+}
+
+
+TEST_F(PerformanceMonitorTest, ThreadsRecordIndependentlyAndMerge) {
+    auto& monitor = getPerformanceMonitor();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&monitor, t] {
+            for (int i = 0; i < 1000; i++) {
+                monitor.record(PerformanceMonitor::MARKET_DATA_HANDLING, std::chrono::nanoseconds(1000 * (t + 1)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto metrics = monitor.snapshot(PerformanceMonitor::MARKET_DATA_HANDLING);
+    EXPECT_EQ(metrics.count, 4000);
+    EXPECT_EQ(metrics.min, 1000u);
+    EXPECT_EQ(metrics.max, 4000u);
+    EXPECT_DOUBLE_EQ(metrics.mean(), 2500.0);
+}
+
+
+TEST_F(PerformanceMonitorTest, RollingWindowsCoverRecentSamples) {
+    auto& monitor = getPerformanceMonitor();
+    for (int i = 1; i <= 100; i++) {
+        monitor.record(PerformanceMonitor::ORDER_EXECUTION, std::chrono::nanoseconds(i * 1000));
+    }
+
+    for (auto window : {PerformanceMonitor::LAST_1S, PerformanceMonitor::LAST_10S, PerformanceMonitor::LAST_60S}) {
+        auto metrics = monitor.snapshot(PerformanceMonitor::ORDER_EXECUTION, window);
+        EXPECT_EQ(metrics.count, 100);
+        EXPECT_EQ(metrics.max, 100000u);
+    }
+    EXPECT_TRUE(monitor.snapshot(PerformanceMonitor::BOOK_UPDATE, PerformanceMonitor::LAST_60S).empty());
+    EXPECT_NE(monitor.generate_window_report().find("Order Execution"), std::string::npos);
+
+    monitor.reset();
+    EXPECT_TRUE(monitor.snapshot(PerformanceMonitor::ORDER_EXECUTION, PerformanceMonitor::LAST_10S).empty());
+    monitor.record(PerformanceMonitor::ORDER_EXECUTION, std::chrono::nanoseconds(500));
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::ORDER_EXECUTION, PerformanceMonitor::LAST_1S).count, 1);
+}
+
+
+TEST_F(PerformanceMonitorTest, ExchangeLatencyIsKeptPerChannel) {
+    auto& monitor = getPerformanceMonitor();
+    uint32_t ticker = getSymbolTable().intern("ticker.BTC-PERPETUAL.raw");
+    uint32_t book = getSymbolTable().intern("book.BTC-PERPETUAL.raw");
+    monitor.record_channel(ticker, std::chrono::microseconds(1500));
+    monitor.record_channel(ticker, std::chrono::microseconds(2500));
+    monitor.record_channel(book, std::chrono::microseconds(-20));
+
+    EXPECT_EQ(monitor.channel_snapshot(ticker).count, 2);
+    EXPECT_EQ(monitor.channel_snapshot(ticker).max, 2500000u);
+    EXPECT_EQ(monitor.channel_snapshot(book).max, 0u);
+    std::string report = monitor.generate_report();
+    EXPECT_NE(report.find("Exchange → Client"), std::string::npos);
+    EXPECT_NE(report.find("ticker.BTC-PERPETUAL.raw"), std::string::npos);
+
+    monitor.reset();
+    EXPECT_TRUE(monitor.channel_snapshot(ticker).empty());
+}
+
+
+TEST_F(PerformanceMonitorTest, PipelineStagesAreKeptPerChannelKind) {
+    auto& monitor = getPerformanceMonitor();
+    uint64_t received = CycleClock::now();
+    uint64_t decoded = received + 1000;
+    monitor.record_stage(PerformanceMonitor::STAGE_DECODE, ChannelKind::Ticker, received, decoded);
+    monitor.record_stage(PerformanceMonitor::STAGE_TOTAL, ChannelKind::Ticker, received, decoded + 1000);
+    monitor.record_stage(PerformanceMonitor::STAGE_DECODE, ChannelKind::Book, 0, decoded);
+
+    auto decode = monitor.stage_snapshot(PerformanceMonitor::STAGE_DECODE, ChannelKind::Ticker);
+    EXPECT_EQ(decode.count, 1);
+    EXPECT_EQ(decode.max, CycleClock::elapsed_nanos(received, decoded));
+    EXPECT_TRUE(monitor.stage_snapshot(PerformanceMonitor::STAGE_DECODE, ChannelKind::Book).empty());
+    EXPECT_TRUE(monitor.stage_snapshot(PerformanceMonitor::STAGE_RENDER, ChannelKind::Ticker).empty());
+
+    std::string report = monitor.generate_report();
+    EXPECT_NE(report.find("Pipeline Breakdown"), std::string::npos);
+    EXPECT_NE(report.find("Ticker"), std::string::npos);
+
+    monitor.reset();
+    EXPECT_TRUE(monitor.stage_snapshot(PerformanceMonitor::STAGE_TOTAL, ChannelKind::Ticker).empty());
+}
+
+
+#if DERIBIT_INSTRUMENTATION
+TEST_F(PerformanceMonitorTest, ScopedProbeRecordsItsStage) {
+    auto& monitor = getPerformanceMonitor();
+    {
+        DERIBIT_PROBE(FRAME_DECODE);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    {
+        DERIBIT_PROBE(FRAME_DECODE);
+        DERIBIT_PROBE(BOOK_UPDATE);
+    }
+
+    auto decode = monitor.snapshot(PerformanceMonitor::FRAME_DECODE);
+    EXPECT_EQ(decode.count, 2);
+    EXPECT_GE(decode.max, 2000000u);
+    EXPECT_EQ(monitor.snapshot(PerformanceMonitor::BOOK_UPDATE).count, 1);
+    EXPECT_NE(monitor.generate_report().find("Frame Decode"), std::string::npos);
+}
+#endif
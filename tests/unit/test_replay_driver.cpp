@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include "network/replay_driver.h"
+#include "market_data/order_book.h"
+#include "performance/monitor.h"
+#include "performance/flight_recorder.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+
+class ReplayDriverTest : public ::testing::Test {
+protected:
+    const std::string path = "replay_driver_test.bin";
+
+    void SetUp() override {
+        FrameJournalWriter writer;
+        ASSERT_TRUE(writer.open(path, 4096));
+        const int64_t base = 1700000000000000000LL;
+        writer.append(MessageHistory::SENT, 0, R"({"jsonrpc":"2.0","id":5,"method":"public/test","params":{}})", base);
+        writer.append(MessageHistory::RECEIVED, 0, R"({"jsonrpc":"2.0","id":5,"result":{"version":"1.2.26"}})", base + 10000000);
+        for (int i = 0; i < 3; i++) {
+            writer.append(MessageHistory::RECEIVED, 0,
+                R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"deribit_price_index.btc_usd","data":{"timestamp":1700000000000,"price":)" +
+                std::to_string(43000 + i) + R"(,"index_name":"btc_usd"}}})",
+                base + 20000000 + i * 10000000);
+        }
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+};
+
+
+TEST_F(ReplayDriverTest, MaxSpeedFeedsInboundFramesThroughHandler) {
+    OrderBookManager books;
+    PerformanceMonitor monitor;
+    ConnectionDetails target(-1, "replay://test", nullptr, &books, &monitor);
+    ReplayDriver driver(target);
+    ASSERT_TRUE(driver.open(path));
+    uint64_t live = getPerformanceMonitor().stage_snapshot(PerformanceMonitor::STAGE_DECODE, ChannelKind::PriceIndex).count;
+
+    ReplayDriver::Stats stats = driver.run(ReplayDriver::MAX_SPEED);
+    EXPECT_EQ(stats.frames_replayed, 4);
+    EXPECT_EQ(stats.frames_skipped, 1);
+    EXPECT_GT(stats.bytes_replayed, 0);
+    EXPECT_EQ(stats.recorded_span, std::chrono::milliseconds(30));
+    EXPECT_LT(stats.elapsed, std::chrono::milliseconds(30));
+    EXPECT_GT(stats.frames_per_second(), 0.0);
+
+    EXPECT_EQ(target.history().size(), 4);
+    EXPECT_NE(target.history().snapshot()[0].find("1.2.26"), std::string::npos);
+#if DERIBIT_INSTRUMENTATION
+    EXPECT_EQ(monitor.stage_snapshot(PerformanceMonitor::STAGE_DECODE, ChannelKind::PriceIndex).count, 3);
+#endif
+    EXPECT_EQ(getPerformanceMonitor().stage_snapshot(PerformanceMonitor::STAGE_DECODE, ChannelKind::PriceIndex).count,
+              live);
+}
+
+
+TEST_F(ReplayDriverTest, ReplayedBooksStayOutOfLiveManager) {
+    {
+        FrameJournalWriter writer;
+        ASSERT_TRUE(writer.open(path, 4096));
+        writer.append(MessageHistory::RECEIVED, 0,
+            R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.SOL-PERPETUAL.100ms","data":{"type":"snapshot","timestamp":1700000000000,"instrument_name":"SOL-PERPETUAL","change_id":1,"bids":[["new",150.5,10]],"asks":[["new",151.0,20]]}}})",
+            1700000000000000000LL);
+    }
+    OrderBookManager books;
+    PerformanceMonitor monitor;
+    ConnectionDetails target(-1, "replay://test", nullptr, &books, &monitor);
+    ReplayDriver driver(target);
+    ASSERT_TRUE(driver.open(path));
+    EXPECT_EQ(driver.run(ReplayDriver::MAX_SPEED).frames_replayed, 1);
+
+    OrderBook book;
+    EXPECT_TRUE(books.snapshot("SOL-PERPETUAL", book));
+    EXPECT_FALSE(getOrderBookManager().snapshot("SOL-PERPETUAL", book));
+}
+
+
+TEST_F(ReplayDriverTest, ReplayedGapsStayOutOfLiveFlightRecorder) {
+    {
+        FrameJournalWriter writer;
+        ASSERT_TRUE(writer.open(path, 4096));
+        writer.append(MessageHistory::RECEIVED, 0,
+            R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.ADA-PERPETUAL.100ms","data":{"type":"snapshot","timestamp":1700000000000,"instrument_name":"ADA-PERPETUAL","change_id":1,"bids":[["new",0.5,10]],"asks":[["new",0.6,20]]}}})",
+            1700000000000000000LL);
+        writer.append(MessageHistory::RECEIVED, 0,
+            R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.ADA-PERPETUAL.100ms","data":{"type":"change","timestamp":1700000000100,"instrument_name":"ADA-PERPETUAL","change_id":9,"prev_change_id":8,"bids":[],"asks":[]}}})",
+            1700000000100000000LL);
+    }
+    auto gaps = [](const FlightRecorder& recorder) {
+        auto records = recorder.collect();
+        return std::count_if(records.begin(), records.end(), [](const FlightRecorder::Record& record) {
+            return record.event.type == FlightRecorder::SEQUENCE_GAP && record.event.connection == -1;
+        });
+    };
+    auto live_gaps = gaps(getFlightRecorder());
+
+    OrderBookManager books;
+    PerformanceMonitor monitor;
+    FlightRecorder flight;
+    ConnectionDetails target(-1, "replay://test", nullptr, &books, &monitor, &flight);
+    ReplayDriver driver(target);
+    ASSERT_TRUE(driver.open(path));
+    EXPECT_EQ(driver.run(ReplayDriver::MAX_SPEED).frames_replayed, 2);
+
+    EXPECT_EQ(gaps(flight), 1);
+    EXPECT_EQ(gaps(getFlightRecorder()), live_gaps);
+    EXPECT_EQ(target.book_resyncs(), 0u);
+}
+
+
+TEST_F(ReplayDriverTest, RealtimePacingHonoursRecordedGaps) {
+    ConnectionDetails target(-1, "replay://test");
+    ReplayDriver driver(target);
+    ASSERT_TRUE(driver.open(path));
+
+    target.set_streaming(true);
+    ReplayDriver::Stats stats = driver.run(ReplayDriver::REALTIME);
+    EXPECT_EQ(stats.frames_replayed, 4);
+    EXPECT_GE(stats.elapsed, std::chrono::milliseconds(30));
+
+    MarketEvent event;
+    int events = 0;
+    while (target.market_events().try_pop(event)) {
+        EXPECT_EQ(event.index.index_name.view(), "btc_usd");
+        events++;
+    }
+    EXPECT_EQ(events, 3);
+}
+
+
+TEST_F(ReplayDriverTest, StreamingReplayLeavesLiveConnectionsAlone) {
+    ConnectionDetails live(1, "wss://test.deribit.com/ws/api/v2");
+    ConnectionDetails target(-1, "replay://test");
+    ReplayDriver driver(target);
+    ASSERT_TRUE(driver.open(path));
+
+    target.set_streaming(true);
+    driver.run(ReplayDriver::MAX_SPEED);
+    live.handle_message(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"deribit_price_index.eth_usd","data":{"timestamp":1700000000000,"price":2250.5,"index_name":"eth_usd"}}})");
+
+    MarketEvent event;
+    EXPECT_FALSE(live.market_events().try_pop(event));
+    EXPECT_EQ(live.history().snapshot().size(), 1u);
+    EXPECT_TRUE(target.market_events().try_pop(event));
+}
+
+TEST_F(ReplayDriverTest, MissingJournalReplaysNothing) {
+    ConnectionDetails target(-1, "replay://test");
+    ReplayDriver driver(target);
+    EXPECT_FALSE(driver.open("missing_replay_journal.bin"));
+    EXPECT_EQ(driver.run(ReplayDriver::MAX_SPEED).frames_replayed, 0);
+}
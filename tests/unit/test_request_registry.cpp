@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "network/request_registry.h"
+#include "exchange_interface/market_api.h"
+#include <string>
+#include <vector>
+
+
+class RequestRegistryTest : public ::testing::Test {
+protected:
+    RequestRegistry registry;
+};
+
+
+TEST_F(RequestRegistryTest, CompletesRegisteredRequest) {
+    bool handled = false;
+    registry.register_request(7, "public/get_order_book", [&](const json& response) {
+        handled = response["result"]["ok"].get<bool>();
+    });
+    EXPECT_EQ(registry.pending_count(), 1);
+
+    
+    RequestRegistry::PendingRequest request;
+    ASSERT_TRUE(registry.complete(7, request));
+    EXPECT_EQ(request.method, "public/get_order_book");
+    EXPECT_EQ(registry.pending_count(), 0);
+
+    
+    request.on_complete(json{{"result", {{"ok", true}}}});
+    EXPECT_TRUE(handled);
+
+    
+    EXPECT_FALSE(registry.complete(7, request));
+}
+
+
+TEST_F(RequestRegistryTest, InterleavedResponsesRouteById) {
+    std::string routed;
+    registry.register_request(1, "private/buy", [&](const json&) { routed += "buy;"; });
+    registry.register_request(2, "private/cancel", [&](const json&) { routed += "cancel;"; });
+
+    
+    RequestRegistry::PendingRequest request;
+    ASSERT_TRUE(registry.complete(2, request));
+    request.on_complete(json::object());
+    ASSERT_TRUE(registry.complete(1, request));
+    request.on_complete(json::object());
+
+    EXPECT_EQ(routed, "cancel;buy;");
+}
+
+
+TEST_F(RequestRegistryTest, UnknownIdIsIgnored) {
+    RequestRegistry::PendingRequest request;
+    EXPECT_FALSE(registry.complete(42, request));
+
+    
+    registry.register_request(3, "public/get_time", nullptr);
+    registry.clear();
+    EXPECT_EQ(registry.pending_count(), 0);
+}
+
+
+TEST_F(RequestRegistryTest, JsonrpcRequestIdsAreUnique) {
+    jsonrpc_request first("public/get_time");
+    jsonrpc_request second("public/get_time");
+    EXPECT_NE(first["id"].get<long>(), second["id"].get<long>());
+}
+
+
+TEST_F(RequestRegistryTest, ExpiresOverdueRequests) {
+    std::string timed_out;
+    registry.register_request(10, "public/get_order_book", nullptr, std::chrono::milliseconds(0),
+                              [&](const std::string& method) { timed_out = method; });
+    registry.register_request(11, "private/buy", nullptr, std::chrono::seconds(60),
+                              [&](const std::string&) { timed_out = "unexpected"; });
+
+    
+    EXPECT_EQ(registry.expire(std::chrono::steady_clock::now()), 1);
+    EXPECT_EQ(timed_out, "public/get_order_book");
+    EXPECT_EQ(registry.pending_count(), 1);
+
+    
+    RequestRegistry::PendingRequest request;
+    EXPECT_FALSE(registry.complete(10, request));
+    EXPECT_TRUE(registry.complete(11, request));
+}
+
+
+TEST_F(RequestRegistryTest, FailAllHandsErrorToEveryWaiter) {
+    std::vector<std::string> failures;
+    auto on_failure = [&](const std::exception_ptr& error) {
+        try {
+            std::rethrow_exception(error);
+        } catch (const ConnectionClosed& e) {
+            failures.push_back(e.what());
+        }
+    };
+    registry.register_request(20, "public/test", nullptr, std::chrono::seconds(60), nullptr, on_failure);
+    registry.register_request(21, "private/buy", nullptr, std::chrono::seconds(60), nullptr, on_failure);
+    registry.register_request(22, "public/get_time", nullptr, std::chrono::seconds(60));
+
+    EXPECT_EQ(registry.fail_all(std::make_exception_ptr(ConnectionClosed("going away"))), 3);
+    EXPECT_EQ(failures, std::vector<std::string>(2, "Connection closed: going away"));
+    EXPECT_EQ(registry.pending_count(), 0);
+    EXPECT_EQ(registry.expire(std::chrono::steady_clock::now() + std::chrono::hours(1)), 0);
+}
@@ -48,14 +48,17 @@ TEST_F(SocketClientTest, ConnectionDetailsBasics) {
     EXPECT_EQ(connection.get_id(), test_id);
     EXPECT_EQ(connection.get_uri(), test_uri);
     EXPECT_EQ(connection.get_status(), "Connecting");
+    EXPECT_EQ(connection.state(), ConnectionDetails::CONNECTING);
+    EXPECT_FALSE(connection.connected());
+    EXPECT_STREQ(ConnectionDetails::state_name(ConnectionDetails::CONNECTION_ERROR), "Error");
     EXPECT_EQ(connection.get_server(), "N/A");
     EXPECT_TRUE(connection.get_error_reason().empty());
 
     
-    EXPECT_TRUE(connection.m_received_data.empty());
+    EXPECT_EQ(connection.history().size(), 0);
     connection.record_sent_message("test message");
-    EXPECT_EQ(connection.m_received_data.size(), 1);
-    EXPECT_EQ(connection.m_received_data[0], "SENT: test message");
+    EXPECT_EQ(connection.history().size(), 1);
+    EXPECT_EQ(connection.history().snapshot()[0], "SENT: test message");
 }
 
 
@@ -72,6 +75,20 @@ TEST_F(SocketClientTest, SocketEndpointBasics) {
     
     int result = endpoint.send(999, "test message");
     EXPECT_EQ(result, -1); 
+
+    
+    auto response = endpoint.send_async(999, R"({"jsonrpc":"2.0","id":1,"method":"public/test"})");
+    EXPECT_THROW(response.get(), std::runtime_error);
+}
+
+
+TEST_F(SocketClientTest, OpenPoolRejectsOutOfRangeSizes) {
+    SocketEndpoint endpoint;
+
+    EXPECT_TRUE(endpoint.open_pool("wss://test.example.com/ws", 0).empty());
+    EXPECT_TRUE(endpoint.open_pool("wss://test.example.com/ws", SocketEndpoint::MAX_POOL_SIZE + 1).empty());
+    EXPECT_TRUE(endpoint.open_pool("wss://test.example.com/ws", static_cast<size_t>(-1)).empty());
+    EXPECT_TRUE(endpoint.pool().empty());
 }
 
 
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include "helpers/spsc_ring.h"
+#include "helpers/stream_renderer.h"
+#include "performance/monitor.h"
+#include <memory>
+#include <thread>
+
+
+TEST(SpscRingTest, RoundsCapacityAndRejectsWhenFull) {
+    SpscRing<int> ring(5);
+    EXPECT_EQ(ring.capacity(), 8);
+
+    for (int i = 0; i < 8; i++) {
+        ASSERT_TRUE(ring.try_push(i));
+    }
+    EXPECT_FALSE(ring.try_push(8));
+    EXPECT_EQ(ring.size(), 8);
+
+    int value = -1;
+    ASSERT_TRUE(ring.try_pop(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(ring.try_push(8));
+}
+
+
+TEST(SpscRingTest, PreservesOrderAcrossThreads) {
+    SpscRing<int> ring(64);
+    const int total = 20000;
+
+    std::thread producer([&] {
+        for (int i = 0; i < total; i++) {
+            while (!ring.try_push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    while (expected < total) {
+        int value;
+        if (ring.try_pop(value)) {
+            ASSERT_EQ(value, expected);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(ring.empty());
+}
+
+
+TEST(StreamRendererTest, DrainKeepsPerInstrumentState) {
+    auto connection = std::make_shared<ConnectionDetails>(1, "wss://test.deribit.com/ws/api/v2");
+    StreamRenderer renderer({connection});
+
+    MarketEvent event{};
+    event.kind = ChannelKind::PriceIndex;
+    event.connection_id = 1;
+    for (double price : {100.0, 105.0, 95.0}) {
+        event.index.index_name.assign("btc_usd");
+        event.index.symbol = getSymbolTable().intern("btc_usd");
+        event.index.price = price;
+        ASSERT_TRUE(connection->market_events().try_push(event));
+        event.index.index_name.assign("eth_usd");
+        event.index.symbol = getSymbolTable().intern("eth_usd");
+        event.index.price = price / 10;
+        ASSERT_TRUE(connection->market_events().try_push(event));
+    }
+
+    EXPECT_EQ(renderer.drain(), 6);
+    EXPECT_TRUE(connection->market_events().empty());
+    EXPECT_EQ(renderer.instrument_count(), 2);
+
+    const auto* btc = renderer.stats("btc_usd");
+    ASSERT_NE(btc, nullptr);
+    EXPECT_EQ(btc->update_count, 3);
+    EXPECT_DOUBLE_EQ(btc->open_price, 100.0);
+    EXPECT_DOUBLE_EQ(btc->high_price, 105.0);
+    EXPECT_DOUBLE_EQ(btc->low_price, 95.0);
+    EXPECT_DOUBLE_EQ(btc->previous_price, 105.0);
+    EXPECT_DOUBLE_EQ(btc->price, 95.0);
+
+    const auto* eth = renderer.stats("eth_usd");
+    ASSERT_NE(eth, nullptr);
+    EXPECT_DOUBLE_EQ(eth->open_price, 10.0);
+    EXPECT_EQ(renderer.stats("sol_usd"), nullptr);
+}
+
+
+TEST(StreamRendererTest, DrainTimesTheNotifyStage) {
+    auto connection = std::make_shared<ConnectionDetails>(1, "wss://test.deribit.com/ws/api/v2");
+    StreamRenderer renderer({connection});
+    auto& monitor = getPerformanceMonitor();
+    uint64_t before = monitor.stage_snapshot(PerformanceMonitor::STAGE_NOTIFY, ChannelKind::PriceIndex).count;
+
+    MarketEvent event{};
+    event.kind = ChannelKind::PriceIndex;
+    event.index.index_name.assign("btc_usd");
+    event.index.symbol = getSymbolTable().intern("btc_usd");
+    event.index.price = 100.0;
+    ASSERT_TRUE(connection->market_events().try_push(event));
+    event.trace.received = CycleClock::now();
+    event.trace.decoded = event.trace.received;
+    event.trace.published = event.trace.received;
+    ASSERT_TRUE(connection->market_events().try_push(event));
+
+    EXPECT_EQ(renderer.drain(), 2);
+    EXPECT_EQ(monitor.stage_snapshot(PerformanceMonitor::STAGE_NOTIFY, ChannelKind::PriceIndex).count, before + 1);
+}
+
+
+TEST(StreamRendererTest, DiffOnlyRewritesChangedLines) {
+    std::vector<std::string> previous = {"header", "btc 100", "eth 10", "footer"};
+    std::vector<std::string> next = {"header", "btc 101", "eth 10"};
+
+    std::string out = StreamRenderer::diff(previous, next);
+    EXPECT_EQ(out, "\033[2;1Hbtc 101\033[K\033[4;1H\033[K");
+    EXPECT_TRUE(StreamRenderer::diff(next, next).empty());
+}
+
+
+TEST(StreamRendererTest, ComposeListsEveryInstrument) {
+    auto connection = std::make_shared<ConnectionDetails>(1, "wss://test.deribit.com/ws/api/v2");
+    StreamRenderer renderer({connection}, 10);
+
+    EXPECT_EQ(renderer.compose(80).size(), 4);
+
+    MarketEvent event{};
+    event.kind = ChannelKind::PriceIndex;
+    event.index.index_name.assign("btc_usd");
+    event.index.symbol = getSymbolTable().intern("btc_usd");
+    event.index.price = 100.0;
+    ASSERT_TRUE(connection->market_events().try_push(event));
+    event.index.index_name.assign("eth_usd");
+    event.index.symbol = getSymbolTable().intern("eth_usd");
+    ASSERT_TRUE(connection->market_events().try_push(event));
+    renderer.drain();
+
+    std::vector<std::string> frame = renderer.compose(80);
+    EXPECT_EQ(frame.size(), 2 + 2 * 5 + 1);
+    EXPECT_NE(frame.back().find("10 Hz"), std::string::npos);
+}
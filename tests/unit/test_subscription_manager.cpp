@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include "network/subscription_manager.h"
+#include "exchange_interface/market_api.h"
+#include <string>
+#include <vector>
+
+
+class SubscriptionManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        getSubscriptionManager().clear();
+    }
+
+    void TearDown() override {
+        getSubscriptionManager().clear();
+    }
+
+    SubscriptionManager manager;
+    std::vector<std::string> diff;
+};
+
+
+TEST_F(SubscriptionManagerTest, OnlyFirstAcquireIsSent) {
+    manager.acquire(0, {"ticker.BTC-PERPETUAL.100ms", "trades.BTC-PERPETUAL.100ms"}, diff);
+    EXPECT_EQ(diff, (std::vector<std::string>{"ticker.BTC-PERPETUAL.100ms", "trades.BTC-PERPETUAL.100ms"}));
+
+    manager.acquire(0, {"trades.BTC-PERPETUAL.100ms", "book.BTC-PERPETUAL.100ms"}, diff);
+    EXPECT_EQ(diff, (std::vector<std::string>{"book.BTC-PERPETUAL.100ms"}));
+    EXPECT_EQ(manager.ref_count("trades.BTC-PERPETUAL.100ms"), 2);
+    EXPECT_EQ(manager.size(), 3);
+
+    auto subscriptions = manager.subscriptions();
+    EXPECT_EQ(subscriptions[0].kind, ChannelKind::Ticker);
+    EXPECT_EQ(subscriptions[1].kind, ChannelKind::Trades);
+    EXPECT_EQ(subscriptions[2].kind, ChannelKind::Book);
+}
+
+
+TEST_F(SubscriptionManagerTest, LastReleaseIsSent) {
+    manager.acquire(0, {"trades.ETH-PERPETUAL.100ms"}, diff);
+    manager.acquire(0, {"trades.ETH-PERPETUAL.100ms"}, diff);
+
+    EXPECT_EQ(manager.release({"trades.ETH-PERPETUAL.100ms"}, diff), 1);
+    EXPECT_TRUE(diff.empty());
+    EXPECT_TRUE(manager.contains("trades.ETH-PERPETUAL.100ms"));
+
+    EXPECT_EQ(manager.release({"trades.ETH-PERPETUAL.100ms", "ticker.ETH-PERPETUAL.100ms"}, diff), 1);
+    EXPECT_EQ(diff, (std::vector<std::string>{"trades.ETH-PERPETUAL.100ms"}));
+    EXPECT_FALSE(manager.contains("trades.ETH-PERPETUAL.100ms"));
+    EXPECT_EQ(manager.size(), 0);
+}
+
+
+TEST_F(SubscriptionManagerTest, ReleaseAllIsScopedToConnection) {
+    manager.acquire(0, {"deribit_price_index.btc_usd"}, diff);
+    manager.acquire(1, {"deribit_price_index.eth_usd"}, diff);
+    manager.acquire(1, {"deribit_price_index.eth_usd"}, diff);
+
+    manager.release_all(1, diff);
+    EXPECT_EQ(diff, (std::vector<std::string>{"deribit_price_index.eth_usd"}));
+    EXPECT_EQ(manager.channels(), (std::vector<std::string>{"deribit_price_index.btc_usd"}));
+    EXPECT_EQ(manager.channels_for(0), (std::vector<std::string>{"deribit_price_index.btc_usd"}));
+    EXPECT_TRUE(manager.channels_for(1).empty());
+}
+
+
+TEST_F(SubscriptionManagerTest, RouterAssignsOwnersUntilUnsubscribeIsRouted) {
+    manager.set_router([](const std::string&, const std::vector<SubscriptionManager::Subscription>& current) {
+        return static_cast<int>(10 + current.size() % 2);
+    });
+    manager.acquire(0, {"deribit_price_index.btc_usd", "deribit_price_index.eth_usd"}, diff);
+    EXPECT_EQ(manager.owner_of("deribit_price_index.btc_usd"), 10);
+    EXPECT_EQ(manager.owner_of("deribit_price_index.eth_usd"), 11);
+    EXPECT_EQ(manager.owner_of("deribit_price_index.sol_usd"), SubscriptionManager::ANY_CONNECTION);
+
+    manager.release({"deribit_price_index.eth_usd"}, diff);
+    EXPECT_EQ(manager.owner_of("deribit_price_index.eth_usd"), SubscriptionManager::ANY_CONNECTION);
+    EXPECT_EQ(manager.take_released_owner("deribit_price_index.eth_usd"), 11);
+    EXPECT_EQ(manager.take_released_owner("deribit_price_index.eth_usd"), SubscriptionManager::ANY_CONNECTION);
+
+    manager.release_all(SubscriptionManager::ANY_CONNECTION, diff);
+    EXPECT_EQ(manager.take_released_owner("deribit_price_index.btc_usd"), 10);
+    manager.set_router(nullptr);
+}
+
+
+TEST_F(SubscriptionManagerTest, UnconfirmedChangesAreUndone) {
+    manager.acquire(0, {"ticker.BTC-PERPETUAL.100ms", "user.orders.any.any.raw"}, diff);
+    manager.acquire(0, {"user.orders.any.any.raw"}, diff);
+    manager.settle(false, 0, {"ticker.BTC-PERPETUAL.100ms", "user.orders.any.any.raw"}, {"ticker.BTC-PERPETUAL.100ms"});
+    EXPECT_TRUE(manager.contains("ticker.BTC-PERPETUAL.100ms"));
+    EXPECT_FALSE(manager.contains("user.orders.any.any.raw"));
+
+    manager.acquire(0, {"user.orders.any.any.raw"}, diff);
+    EXPECT_EQ(diff, std::vector<std::string>{"user.orders.any.any.raw"});
+
+    manager.release({"ticker.BTC-PERPETUAL.100ms"}, diff);
+    manager.settle(true, 2, {"ticker.BTC-PERPETUAL.100ms"}, {});
+    EXPECT_EQ(manager.owner_of("ticker.BTC-PERPETUAL.100ms"), 2);
+    EXPECT_EQ(manager.ref_count("ticker.BTC-PERPETUAL.100ms"), 1);
+
+    manager.release({"ticker.BTC-PERPETUAL.100ms"}, diff);
+    manager.settle(true, 2, {"ticker.BTC-PERPETUAL.100ms"}, {"ticker.BTC-PERPETUAL.100ms"});
+    EXPECT_FALSE(manager.contains("ticker.BTC-PERPETUAL.100ms"));
+}
+
+TEST_F(SubscriptionManagerTest, OneBookIntervalPerInstrument) {
+    std::vector<std::string> rejected;
+    manager.acquire(0, {"book.BTC-PERPETUAL.100ms"}, diff, &rejected);
+    EXPECT_TRUE(rejected.empty());
+    manager.acquire(0, {"book.BTC-PERPETUAL.raw", "book.ETH-PERPETUAL.raw"}, diff, &rejected);
+    EXPECT_EQ(diff, std::vector<std::string>{"book.ETH-PERPETUAL.raw"});
+    EXPECT_EQ(rejected, std::vector<std::string>{"book.BTC-PERPETUAL.raw"});
+    EXPECT_EQ(manager.book_channel("BTC-PERPETUAL"), "book.BTC-PERPETUAL.100ms");
+
+    manager.release({"book.BTC-PERPETUAL.100ms"}, diff);
+    EXPECT_EQ(manager.book_channel("BTC-PERPETUAL"), "");
+    manager.acquire(0, {"book.BTC-PERPETUAL.raw"}, diff, &rejected);
+    EXPECT_TRUE(rejected.empty());
+}
+
+TEST_F(SubscriptionManagerTest, RequestMethodFollowsChannelPrivacy) {
+    EXPECT_TRUE(SubscriptionManager::is_private("user.orders.any.any.raw"));
+    EXPECT_TRUE(SubscriptionManager::is_private("book.BTC-PERPETUAL.raw"));
+    EXPECT_FALSE(SubscriptionManager::is_private("book.BTC-PERPETUAL.100ms"));
+
+    json request = json::parse(SubscriptionManager::subscribe_request({"ticker.BTC-PERPETUAL.100ms"}));
+    EXPECT_EQ(request["method"], "public/subscribe");
+    EXPECT_EQ(request["params"]["channels"], json::array({"ticker.BTC-PERPETUAL.100ms"}));
+
+    request = json::parse(SubscriptionManager::unsubscribe_request({"ticker.BTC-PERPETUAL.100ms", "user.trades.any.any.raw"}));
+    EXPECT_EQ(request["method"], "private/unsubscribe");
+}
+
+
+TEST_F(SubscriptionManagerTest, CommandsSendOnlyTheDiff) {
+    json request = json::parse(api::processRequest("deribit 0 subscribe btc_usd trades.BTC-PERPETUAL.100ms"));
+    EXPECT_EQ(request["params"]["channels"],
+              json::array({"deribit_price_index.btc_usd", "trades.BTC-PERPETUAL.100ms"}));
+
+    request = json::parse(api::processRequest("deribit 0 subscribe trades.BTC-PERPETUAL.100ms ticker.BTC-PERPETUAL.100ms"));
+    EXPECT_EQ(request["params"]["channels"], json::array({"ticker.BTC-PERPETUAL.100ms"}));
+
+    EXPECT_EQ(api::processRequest("deribit 0 unsubscribe trades.BTC-PERPETUAL.100ms"), "");
+    EXPECT_TRUE(REQUEST_SERVED_LOCALLY);
+
+    request = json::parse(api::processRequest("deribit 0 unsubscribe trades.BTC-PERPETUAL.100ms"));
+    EXPECT_EQ(request["method"], "public/unsubscribe");
+    EXPECT_EQ(request["params"]["channels"], json::array({"trades.BTC-PERPETUAL.100ms"}));
+
+    request = json::parse(api::processRequest("deribit 0 unsubscribe_all"));
+    EXPECT_EQ(request["params"]["channels"],
+              json::array({"deribit_price_index.btc_usd", "ticker.BTC-PERPETUAL.100ms"}));
+    EXPECT_EQ(getSubscriptionManager().size(), 0);
+}
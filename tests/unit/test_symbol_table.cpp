@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "data_format/symbol_table.h"
+#include "data_format/market_data_decoder.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+
+TEST(SymbolTableTest, InternReturnsStableDenseIds) {
+    SymbolTable table;
+    uint32_t btc = table.intern("BTC-PERPETUAL");
+    uint32_t eth = table.intern("ETH-PERPETUAL");
+    EXPECT_EQ(btc, 0);
+    EXPECT_EQ(eth, 1);
+    EXPECT_EQ(table.intern(std::string("BTC-") + "PERPETUAL"), btc);
+    EXPECT_EQ(table.find("ETH-PERPETUAL"), eth);
+    EXPECT_EQ(table.find("SOL-PERPETUAL"), SymbolTable::INVALID);
+    EXPECT_EQ(table.name(btc), "BTC-PERPETUAL");
+    EXPECT_TRUE(table.name(99).empty());
+    EXPECT_EQ(table.size(), 2);
+}
+
+TEST(SymbolTableTest, ConcurrentInternAgreesOnIds) {
+    SymbolTable table;
+    std::vector<std::vector<uint32_t>> seen(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&table, &seen, t] {
+            for (int i = 0; i < 500; i++) {
+                seen[t].push_back(table.intern("symbol_" + std::to_string(i)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(table.size(), 500);
+    for (int t = 1; t < 4; t++) {
+        EXPECT_EQ(seen[t], seen[0]);
+    }
+}
+
+TEST(SymbolTableTest, DecoderResolvesIds) {
+    MarketDataFrame frame{};
+    ASSERT_TRUE(market_data::decodeSubscription(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"deribit_price_index.btc_usd","data":{"timestamp":1,"price":1.5,"index_name":"btc_usd"}}})",
+        frame));
+    EXPECT_EQ(frame.index.symbol, getSymbolTable().find("btc_usd"));
+    EXPECT_EQ(getSymbolTable().name(frame.channel_id), "deribit_price_index.btc_usd");
+}